@@ -29,6 +29,7 @@
 #include "bookmark.h"
 #endif
 #include "command.h"
+#include "ext-proxy.h"
 #include "history.h"
 #include "util.h"
 #include "main.h"
@@ -40,6 +41,7 @@ typedef struct {
     PostEditFunc func;
 } EditorData;
 
+static ExtSearchFlags get_search_flags(Client *c);
 static void resume_editor(GPid pid, int status, gpointer edata);
 
 /**
@@ -55,12 +57,18 @@ gboolean command_search(Client *c, const Arg *arg, bool commit)
     const char *query;
     guint count;
     int direction;
+    ExtSearchFlags flags;
 
     g_assert(c);
     g_assert(arg);
 
     if (arg->i == 0) {
         webkit_find_controller_search_finish(c->finder);
+        if (c->state.search.flags) {
+            /* Remove the selected match. */
+            ext_proxy_search(c, "", 0, 0);
+        }
+        c->state.search.flags = 0;
 
         /* Clear the input only if the search is active and commit flag is
          * set. This allows us to stop searching with and without cleaning
@@ -72,7 +80,7 @@ gboolean command_search(Client *c, const Arg *arg, bool commit)
         c->state.search.active  = FALSE;
         c->state.search.matches = 0;
 
-        vb_statusbar_update(c);
+        vb_statusbar_invalidate(c, STATUS_DIRTY(STATUS_SEARCH));
 
         return TRUE;
     }
@@ -100,13 +108,15 @@ gboolean command_search(Client *c, const Arg *arg, bool commit)
         }
     }
 
-    /* Hand the query string to webkit's find controller. */
+    /* Hand the query string to webkit's find controller or for patterns and
+     * words to the web extension. */
     if (query) {
+        flags = get_search_flags(c);
         /* Force a fresh start in order to have webkit select the first match
          * on the page. Without this workaround the first selected match
          * depends on the most recent selection or caret position (even when
          * caret browsing is disabled). */
-        if (commit) {
+        if (commit && !flags) {
             webkit_find_controller_search(c->finder, "", WEBKIT_FIND_OPTIONS_NONE, G_MAXUINT);
         }
 
@@ -117,26 +127,40 @@ gboolean command_search(Client *c, const Arg *arg, bool commit)
             c->state.search.last_query = g_strdup(query);
         }
 
-        webkit_find_controller_count_matches(c->finder, query,
-                WEBKIT_FIND_OPTIONS_CASE_INSENSITIVE |
-                WEBKIT_FIND_OPTIONS_WRAP_AROUND,
-                G_MAXUINT);
-        webkit_find_controller_search(c->finder, query,
-                WEBKIT_FIND_OPTIONS_CASE_INSENSITIVE |
-                WEBKIT_FIND_OPTIONS_WRAP_AROUND |
-                (direction > 0 ?  WEBKIT_FIND_OPTIONS_NONE : WEBKIT_FIND_OPTIONS_BACKWARDS),
-                G_MAXUINT);
+        if (flags) {
+            /* The web extension selects the match itself, which includes the
+             * steps of arg->i. */
+            webkit_find_controller_search_finish(c->finder);
+            ext_proxy_search(c, query, flags, arg->i);
+            count = 0;
+        } else {
+            /* The find controller counts the matches in the page and its
+             * frames while it highlights them, see on_found_text(). */
+            webkit_find_controller_search(c->finder, query,
+                    WEBKIT_FIND_OPTIONS_CASE_INSENSITIVE |
+                    WEBKIT_FIND_OPTIONS_WRAP_AROUND |
+                    (direction > 0 ?  WEBKIT_FIND_OPTIONS_NONE : WEBKIT_FIND_OPTIONS_BACKWARDS),
+                    G_MAXUINT);
+
+            /* Skip first search because the first match is already
+             * highlighted on search start. */
+            count -= 1;
+        }
 
         c->state.search.active    = TRUE;
         c->state.search.direction = direction;
-
-        /* Skip first search because the first match is already
-         * highlighted on search start. */
-        count -= 1;
+        c->state.search.flags     = flags;
     }
 
     /* Step through searchs result focus according to arg->i. */
-    if (c->state.search.active) {
+    if (c->state.search.active && c->state.search.flags) {
+        /* Like the find controller the next match of a backward search is
+         * the one before in the page. */
+        if (count) {
+            ext_proxy_search(c, c->state.search.last_query, c->state.search.flags,
+                    arg->i * c->state.search.direction > 0 ? (int)count : -(int)count);
+        }
+    } else if (c->state.search.active) {
         if (arg->i * c->state.search.direction > 0) {
             while (count--) {
                 webkit_find_controller_search_next(c->finder);
@@ -295,7 +319,7 @@ gboolean command_spawn_editor(Client *c, const Arg *arg,
     GError *error = NULL;
 
     /* get the editor command */
-    editor_command = GET_CHAR(c, "editor-command");
+    editor_command = GET_CHAR(c, SID_EDITOR_COMMAND);
     if (!editor_command || !*editor_command) {
         vb_echo(c, MSG_ERROR, TRUE, "No editor-command configured");
         return FALSE;
@@ -343,6 +367,19 @@ gboolean command_spawn_editor(Client *c, const Arg *arg,
     return result;
 }
 
+static ExtSearchFlags get_search_flags(Client *c)
+{
+    const char *mode = GET_CHAR(c, SID_SEARCH_MODE);
+
+    if (!strcmp(mode, "regex")) {
+        return EXT_SEARCH_REGEX;
+    }
+    if (!strcmp(mode, "word")) {
+        return EXT_SEARCH_WORD;
+    }
+    return 0;
+}
+
 static void resume_editor(GPid pid, int status, gpointer edata)
 {
     char *text = NULL;
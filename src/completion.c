@@ -27,6 +27,7 @@ typedef struct {
     CompletionSelectFunc    selfunc;
 } Completion;
 
+static void set_height(Client *c);
 static gboolean tree_selection_func(GtkTreeSelection *selection,
     GtkTreeModel *model, GtkTreePath *path, gboolean selected, gpointer data);
 
@@ -69,10 +70,9 @@ gboolean completion_create(Client *c, GtkTreeModel *model,
     GtkCellRenderer *renderer;
     GtkTreeSelection *selection;
     GtkTreeViewColumn *column;
-    GtkRequisition size;
     GtkTreePath *path;
     GtkTreeIter iter;
-    int height, width;
+    int width;
     Completion *comp = (Completion*)c->comp;
 
     /* if there is only one match - don't build the tree view */
@@ -117,7 +117,7 @@ gboolean completion_create(Client *c, GtkTreeModel *model,
     gtk_tree_selection_set_select_function(selection, tree_selection_func, c, NULL);
 
     /* get window dimension */
-    gtk_window_get_size(GTK_WINDOW(c->window), &width, &height);
+    gtk_window_get_size(GTK_WINDOW(c->window), &width, NULL);
 
     /* prepare first column */
     column = gtk_tree_view_column_new();
@@ -157,13 +157,7 @@ gboolean completion_create(Client *c, GtkTreeModel *model,
         gtk_main_iteration();
     }
 
-    /* use max 1/3 of window height for the completion */
-    gtk_widget_get_preferred_size(comp->tree, NULL, &size);
-    height /= 3;
-    gtk_scrolled_window_set_min_content_height(
-        GTK_SCROLLED_WINDOW(comp->win),
-        size.height > height ? height : size.height
-    );
+    set_height(c);
 
     c->mode->flags |= FLAG_COMPLETION;
 
@@ -176,6 +170,16 @@ gboolean completion_create(Client *c, GtkTreeModel *model,
     return TRUE;
 }
 
+/**
+ * Adjusts the completion to items added to its model after it was created.
+ */
+void completion_update(Client *c)
+{
+    if (((Completion*)c->comp)->win) {
+        set_height(c);
+    }
+}
+
 /**
  * Initialize the completion system for given client.
  */
@@ -253,3 +257,19 @@ static gboolean tree_selection_func(GtkTreeSelection *selection,
 
     return TRUE;
 }
+
+static void set_height(Client *c)
+{
+    GtkRequisition size;
+    int height;
+    Completion *comp = (Completion*)c->comp;
+
+    /* use max 1/3 of window height for the completion */
+    gtk_window_get_size(GTK_WINDOW(c->window), NULL, &height);
+    gtk_widget_get_preferred_size(comp->tree, NULL, &size);
+    height /= 3;
+    gtk_scrolled_window_set_min_content_height(
+        GTK_SCROLLED_WINDOW(comp->win),
+        size.height > height ? height : size.height
+    );
+}
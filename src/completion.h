@@ -39,6 +39,7 @@ void completion_clean(Client *c);
 void completion_cleanup(Client *c);
 gboolean completion_create(Client *c, GtkTreeModel *model,
         CompletionSelectFunc selfunc, gboolean back);
+void completion_update(Client *c);
 void completion_init(Client *c);
 gboolean completion_next(Client *c, gboolean back);
 
@@ -26,6 +26,8 @@
 #define FEATURE_TITLE_IN_COMPLETION
 /* enable the read it later queue */
 #define FEATURE_QUEUE
+/* enable the remote control socket to open uris in a running instance */
+#define FEATURE_REMOTE
 /* disable X window embedding */
 /* #define FEATURE_NO_XEMBED */
 
@@ -57,6 +59,12 @@
 #define SETTING_COOKIE_ACCEPT                 "always"
 #define SETTING_HINT_KEYS                     "0123456789"
 #define SETTING_DOWNLOAD_COMMAND              "/bin/sh -c \"curl -sLJOC - -e '$VIMB_URI' %s\""
+/* number of parallel requests of the built-in download engine, 0 leaves the
+ * downloads to webkit */
+#define SETTING_DOWNLOAD_SEGMENTS             0
+/* seconds after that an unfocused window frees its web process, 0 to never
+ * suspend windows */
+#define SETTING_SUSPEND_TIMEOUT               0
 #define SETTING_COMPLETION_CSS                "color:#fff;background-color:#656565;font:" SETTING_GUI_FONT_NORMAL
 #define SETTING_COMPLETION_HOVER_CSS          "background-color:#777;"
 #define SETTING_COMPLETION_SELECTED_CSS       "color:#f6f3e8;background-color:#888;"
@@ -71,31 +79,86 @@
 #define WIN_WIDTH                  800
 #define WIN_HEIGHT                 600
 
+/* seconds to wait for a running instance to answer --remote */
+#define REMOTE_TIMEOUT              5
+
+/* built-in download engine used if download-segments is set */
+#define DOWNLOAD_SEGMENTS_MAX       16
+/* files are only split into segments of at least this size */
+#define DOWNLOAD_SEGMENT_MIN_SIZE   (1024 * 1024)
+/* number of retries of a failed segment before the download fails */
+#define DOWNLOAD_RETRIES            3
+/* seconds between the saves of the resume state of a download */
+#define DOWNLOAD_RESUME_INTERVAL    2
+
+/* milliseconds over that the speed of a download is measured */
+#define DOWNLOAD_SPEED_INTERVAL     500
+/* weight of the latest measured speed in the smoothed download speed */
+#define DOWNLOAD_SPEED_SMOOTHING    0.3
+
+/* milliseconds after that the title and url of a window are updated if the
+ * window draws no frame, because it is not mapped or iconified */
+#define PRESENT_TIMEOUT             100
+
+/* seconds to collect changes of the windows before the session is saved */
+#define SESSION_SAVE_DELAY          5
+/* memory pressure trigger of /proc/pressure/memory that suspends the longest
+ * unfocused window if suspend-timeout is set, "" to not watch the pressure */
+#define SUSPEND_PRESSURE_TRIGGER    "some 150000 2000000"
+
+/* number of directories whose entries are kept for the filename completion,
+ * a directory is read again once it was modified */
+#define FILE_COMPLETION_CACHE_SIZE  16
+/* number of directory entries read at once by the filename completion, the
+ * matching ones are shown after each batch */
+#define FILE_COMPLETION_BATCH_SIZE  256
+
+/* defaults of the gui theme that can be changed in the preferencerc file */
+#define PREFERENCE_COLOR_BACKGROUND "#000000"
+#define PREFERENCE_COLOR_FOREGROUND "#ffffff"
+#define PREFERENCE_COLOR_CURSOR     "#ffffff"
+#define PREFERENCE_COLOR_BOLD       "#ffffff"
+#define PREFERENCE_COLOR_PALETTE    "#000000;#cd0000;#00cd00;#cdcd00;#0000ee;#cd00cd;#00cdcd;#e5e5e5;" \
+                                    "#7f7f7f;#ff0000;#00ff00;#ffff00;#5c5cff;#ff00ff;#00ffff;#ffffff"
+#define PREFERENCE_OPACITY          1.0
+#define PREFERENCE_FONT_FAMILY      "monospace"
+#define PREFERENCE_FONT_SIZE        "10pt"
+/* time in milliseconds to wait for further changes of the preferencerc file
+ * before it's read again - editors write a file in several steps */
+#define PREFERENCE_DEBOUNCE_MS      200
+
+/* number of webviews prepared in idle time to speed up opening of new
+ * windows, 0 disables the pool */
+#define WEBVIEW_POOL_SIZE          1
+
 /* if set to 1 vimb will check if the webextension could be found. */
 #define CHECK_WEBEXTENSION_ON_STARTUP 1
+/* maximum number of calls to the webextension queued per window until the
+ * webextension of the page is connected, further calls are dropped */
+#define EXT_PROXY_QUEUE_SIZE       32
 
 /* This status indicator is only shown if "status-bar-show-settings" is
  * enabled.
  * The CHAR_MAP(value, internalValue, outputValue, valueIfNotMapped) is a
  * little workaround to translate internal used string value like for
- * GET_CHAR(c, "cookie-accept") which is one of "always", "origin" or "never"
+ * GET_CHAR(c, SID_COOKIE_ACCEPT) which is one of "always", "origin" or "never"
  * to those values that should be shown on statusbar.
  * The STATUS_VARAIBLE_SHOW is used as argument for a printf like function. So
  * the first argument is the output pattern. */
 /*
 #define STATUS_VARAIBLE_SHOW "js: %s, cookies: %s, hint-timeout: %d", \
-    GET_BOOL(c, "scripts") ? "on" : "off", \
-    GET_CHAR(c, "cookie-accept"), \
-    GET_INT(c, "hint-timeout")
+    GET_BOOL(c, SID_SCRIPTS) ? "on" : "off", \
+    GET_CHAR(c, SID_COOKIE_ACCEPT), \
+    GET_INT(c, SID_HINT_TIMEOUT)
 */
-#define COOKIE GET_CHAR(c, "cookie-accept")
+#define COOKIE GET_CHAR(c, SID_COOKIE_ACCEPT)
 #define CHAR_MAP(v, i, m, d) (strcmp(v, i) == 0 ? m : (d))
 #define STATUS_VARAIBLE_SHOW "%c%c%c%c%c%c%c%c", \
     CHAR_MAP(COOKIE, "always", 'A', CHAR_MAP(COOKIE, "origin", '@', 'a')), \
-    GET_BOOL(c, "dark-mode") ? 'D' : 'd', \
+    GET_BOOL(c, SID_DARK_MODE) ? 'D' : 'd', \
     vb.incognito ? 'E' : 'e', \
-    GET_BOOL(c, "images") ? 'I' : 'i', \
-    GET_BOOL(c, "html5-local-storage") ? 'L' : 'l', \
-    GET_BOOL(c, "stylesheet") ? 'M' : 'm', \
-    GET_BOOL(c, "scripts") ? 'S' : 's', \
-    GET_BOOL(c, "strict-ssl") ? 'T' : 't'
+    GET_BOOL(c, SID_IMAGES) ? 'I' : 'i', \
+    GET_BOOL(c, SID_HTML5_LOCAL_STORAGE) ? 'L' : 'l', \
+    GET_BOOL(c, SID_STYLESHEET) ? 'M' : 'm', \
+    GET_BOOL(c, SID_SCRIPTS) ? 'S' : 's', \
+    GET_BOOL(c, SID_STRICT_SSL) ? 'T' : 't'
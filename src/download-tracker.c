@@ -0,0 +1,164 @@
+/**
+ * vimb - a webkit based vim like browser.
+ *
+ * Copyright (C) 2012-2018 Daniel Carl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+#include "config.h"
+#include "download-tracker.h"
+
+static void stat_attach(DownloadStat *s);
+static void stat_detach(DownloadStat *s);
+static goffset stat_remaining(const DownloadStat *s);
+
+
+/**
+ * Starts tracking of a download with given size, -1 if the size is not
+ * known yet, and the bytes that are already there.
+ */
+void download_tracker_add(DownloadTracker *t, DownloadStat *s, goffset size,
+        goffset received, gint64 now)
+{
+    s->tracker = t;
+    s->size    = -1;
+    s->speed   = 0;
+    t->active++;
+    download_tracker_reset(s, size, received, now);
+}
+
+/**
+ * Sets new size and received bytes of a tracked download. This is used once
+ * the size becomes known or if the download starts over. The speed is
+ * measured again from now on.
+ */
+void download_tracker_reset(DownloadStat *s, goffset size, goffset received,
+        gint64 now)
+{
+    stat_detach(s);
+    s->size         = size > 0 ? size : -1;
+    s->received     = received;
+    s->speed        = 0;
+    s->sample_time  = now;
+    s->sample_bytes = 0;
+    stat_attach(s);
+}
+
+/**
+ * Accounts len new received bytes of the download. Returns TRUE if the
+ * statusbar of the client should be updated, this happens at most once a
+ * second for all downloads of a client.
+ */
+gboolean download_tracker_update(DownloadStat *s, gsize len, gint64 now)
+{
+    DownloadTracker *t = s->tracker;
+    gint64 elapsed;
+    gdouble rate;
+
+    t->remaining    -= stat_remaining(s);
+    s->received     += len;
+    s->sample_bytes += len;
+    t->remaining    += stat_remaining(s);
+
+    /* Measure the speed over some time to not be fooled by the size of the
+     * single chunks and smooth it to get a steady ETA. */
+    elapsed = now - s->sample_time;
+    if (elapsed >= DOWNLOAD_SPEED_INTERVAL * 1000) {
+        rate = (gdouble)s->sample_bytes * G_USEC_PER_SEC / elapsed;
+
+        stat_detach(s);
+        s->speed = s->speed > 0
+            ? s->speed + DOWNLOAD_SPEED_SMOOTHING * (rate - s->speed)
+            : rate;
+        stat_attach(s);
+
+        s->sample_time  = now;
+        s->sample_bytes = 0;
+    }
+
+    if (now >= t->notify_next) {
+        t->notify_next = now + G_USEC_PER_SEC;
+        return TRUE;
+    }
+    return FALSE;
+}
+
+/**
+ * Stops the tracking of the download.
+ */
+void download_tracker_remove(DownloadStat *s)
+{
+    DownloadTracker *t = s->tracker;
+
+    if (!t) {
+        return;
+    }
+    stat_detach(s);
+    s->tracker = NULL;
+
+    /* Start from scratch to not carry rounding errors of the speed sums
+     * along. */
+    if (!--t->active) {
+        t->speed       = 0;
+        t->sized_speed = 0;
+        t->remaining   = 0;
+    }
+}
+
+/**
+ * Returns the estimated time in seconds until all downloads with known size
+ * are finished or 0 if this is not known.
+ */
+guint download_tracker_get_eta(const DownloadTracker *t)
+{
+    gdouble eta;
+
+    if (t->remaining <= 0 || t->sized_speed < 1) {
+        return 0;
+    }
+    eta = t->remaining / t->sized_speed;
+
+    return eta < G_MAXUINT ? (guint)eta : G_MAXUINT;
+}
+
+/**
+ * Adds the values of the download to the sums of the tracker.
+ */
+static void stat_attach(DownloadStat *s)
+{
+    DownloadTracker *t = s->tracker;
+
+    t->speed += s->speed;
+    if (s->size > 0) {
+        t->sized_speed += s->speed;
+        t->remaining   += stat_remaining(s);
+    }
+}
+
+static void stat_detach(DownloadStat *s)
+{
+    DownloadTracker *t = s->tracker;
+
+    t->speed = MAX(t->speed - s->speed, 0);
+    if (s->size > 0) {
+        t->sized_speed = MAX(t->sized_speed - s->speed, 0);
+        t->remaining  -= stat_remaining(s);
+    }
+}
+
+static goffset stat_remaining(const DownloadStat *s)
+{
+    return s->size > 0 ? MAX(s->size - s->received, 0) : 0;
+}
@@ -0,0 +1,54 @@
+/**
+ * vimb - a webkit based vim like browser.
+ *
+ * Copyright (C) 2012-2018 Daniel Carl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+#ifndef _DOWNLOAD_TRACKER_H
+#define _DOWNLOAD_TRACKER_H
+
+#include <glib.h>
+
+/* Aggregated progress of all running downloads of a client. The sums are
+ * kept up to date by the updates of the single downloads, so reading them
+ * doesn't depend on the number of downloads. */
+typedef struct {
+    guint   active;         /* number of running downloads */
+    gdouble speed;          /* sum of the smoothed speeds in bytes/s */
+    gdouble sized_speed;    /* speed of the downloads with known size */
+    goffset remaining;      /* bytes left of the downloads with known size */
+    gint64  notify_next;    /* time the next statusbar update is allowed */
+} DownloadTracker;
+
+/* Progress of a single download. */
+typedef struct {
+    DownloadTracker *tracker;
+    goffset         size;           /* total size or -1 if unknown */
+    goffset         received;
+    gdouble         speed;          /* smoothed speed in bytes/s */
+    gint64          sample_time;    /* start of the current speed sample */
+    goffset         sample_bytes;   /* bytes received in current sample */
+} DownloadStat;
+
+void download_tracker_add(DownloadTracker *t, DownloadStat *s, goffset size,
+        goffset received, gint64 now);
+void download_tracker_reset(DownloadStat *s, goffset size, goffset received,
+        gint64 now);
+gboolean download_tracker_update(DownloadStat *s, gsize len, gint64 now);
+void download_tracker_remove(DownloadStat *s);
+guint download_tracker_get_eta(const DownloadTracker *t);
+
+#endif /* end of include guard: _DOWNLOAD_TRACKER_H */
@@ -0,0 +1,776 @@
+/**
+ * vimb - a webkit based vim like browser.
+ *
+ * Copyright (C) 2012-2018 Daniel Carl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+/* Built-in download engine used if 'download-segments' is set. Large files
+ * are split into segments that are fetched by parallel range requests and
+ * written by positional writes into the preallocated FILE.part. The progress
+ * of the segments is saved in FILE.resume so that a failed or aborted
+ * download of the same uri into the same file continues where it stopped. */
+
+#include "config.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <glib/gstdio.h>
+#include <libsoup/soup.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "autocmd.h"
+#include "download.h"
+#include "main.h"
+
+#define BUF_SIZE 65536
+
+typedef struct Download Download;
+
+typedef struct {
+    Download     *dl;           /* NULL if the download was removed */
+    goffset      start;         /* first byte of the segment */
+    goffset      end;           /* last byte of the segment or -1 if unknown */
+    goffset      offset;        /* next byte to be written */
+    SoupMessage  *msg;
+    GInputStream *stream;
+    GCancellable *cancellable;
+    gboolean     busy;          /* indicates a pending async operation */
+    gboolean     done;
+    guint        retries;
+    guint        retry_id;
+    char         buf[BUF_SIZE];
+} Segment;
+
+struct Download {
+    Client    *c;
+    char      *uri;
+    char      *referer;
+    char      *user_agent;
+    char      *cookies;         /* Cookie header for the requests */
+    GCancellable *cancellable;  /* for the lookup of the cookies */
+    char      *path;            /* destination of the finished download */
+    char      *part;            /* file written while downloading */
+    char      *resume;          /* state of the segments to resume */
+    int       fd;
+    goffset   size;             /* total size or -1 if unknown */
+    gboolean  ranges;           /* server accepts range requests */
+    GPtrArray *segments;
+    DownloadStat stat;          /* progress shown in the statusbar */
+    gint64    saved;            /* time the resume state was saved last */
+};
+
+static SoupSession *get_session(void);
+static void on_cookies_got(GObject *source, GAsyncResult *res, gpointer data);
+static void create_segments(Download *dl, guint count);
+static Segment *segment_new(Download *dl, goffset start, goffset end, goffset offset);
+static void segment_request(Segment *seg);
+static void on_segment_sent(GObject *source, GAsyncResult *res, gpointer data);
+static void segment_read(Segment *seg);
+static void on_segment_read(GObject *source, GAsyncResult *res, gpointer data);
+static void segment_error(Segment *seg, const char *message);
+static gboolean on_segment_retry(gpointer data);
+static void segment_detach(Segment *seg);
+static void segment_free(Segment *seg);
+static void restart_single(Download *dl);
+static void download_progress(Download *dl, gsize len);
+static void download_finished(Download *dl);
+static void download_failed(Download *dl, const char *message);
+static void download_free(Download *dl);
+static goffset get_received(Download *dl);
+static gboolean write_all(int fd, const char *buf, gsize len, goffset offset);
+static void save_state(Download *dl);
+static gboolean load_state(Download *dl);
+
+extern struct Vimb vb;
+
+static struct {
+    SoupSession *session;
+    GList       *downloads;
+} engine;
+
+
+/**
+ * Starts the download of uri into the file path. The size and ranges are
+ * taken from the response already received by webkit. Returns FALSE if the
+ * download could not be started, the caller may use another way to download
+ * the uri in this case.
+ */
+gboolean download_start(Client *c, const char *uri, const char *referer,
+        const char *path, goffset size, gboolean ranges)
+{
+    Download *dl;
+    Segment *seg;
+    SoupURI *suri;
+    WebKitCookieManager *cm;
+    char *basename;
+    goffset resumed = 0;
+    gboolean pending = FALSE;
+    int res;
+    guint i;
+
+    /* Leave other schemes than http(s) to webkit. */
+    suri = soup_uri_new(uri);
+    if (!suri || !SOUP_URI_VALID_FOR_HTTP(suri)) {
+        if (suri) {
+            soup_uri_free(suri);
+        }
+        return FALSE;
+    }
+    soup_uri_free(suri);
+
+    dl             = g_slice_new0(Download);
+    dl->c          = c;
+    dl->uri        = g_strdup(uri);
+    dl->referer    = g_strdup(referer);
+    dl->user_agent = g_strdup(GET_CHAR(c, SID_USER_AGENT));
+    dl->path       = g_strdup(path);
+    dl->part       = g_strconcat(path, ".part", NULL);
+    dl->resume     = g_strconcat(path, ".resume", NULL);
+    dl->size       = size > 0 ? size : -1;
+    dl->ranges     = ranges;
+    dl->segments   = g_ptr_array_new();
+
+    dl->fd = g_open(dl->part, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (dl->fd == -1) {
+        g_warning("Could not open '%s': %s", dl->part, g_strerror(errno));
+        download_free(dl);
+
+        return FALSE;
+    }
+
+    if (load_state(dl)) {
+        for (i = 0; i < dl->segments->len; i++) {
+            seg      = g_ptr_array_index(dl->segments, i);
+            resumed += seg->offset - seg->start;
+        }
+    } else {
+        /* Drop the content of a part file we know nothing about. */
+        if (ftruncate(dl->fd, 0) == -1) {
+            g_warning("Could not truncate '%s': %s", dl->part, g_strerror(errno));
+        }
+        if (dl->size > 0) {
+            /* Reserve the space at once to fail early if the disk is full
+             * and to avoid fragmentation by the parallel writes. */
+            res = posix_fallocate(dl->fd, 0, dl->size);
+            if (res && res != EINVAL && res != EOPNOTSUPP) {
+                basename = g_path_get_basename(path);
+                vb_echo(c, MSG_ERROR, FALSE, "Download of %s failed (%s)",
+                        basename, g_strerror(res));
+                g_free(basename);
+                g_unlink(dl->part);
+                download_free(dl);
+
+                return TRUE;
+            }
+        }
+        create_segments(dl, MAX(1, GET_INT(c, SID_DOWNLOAD_SEGMENTS)));
+    }
+
+    engine.downloads = g_list_append(engine.downloads, dl);
+    download_tracker_add(&c->state.downloads, &dl->stat, dl->size, resumed,
+            g_get_monotonic_time());
+
+    for (i = 0; i < dl->segments->len && !pending; i++) {
+        pending = !((Segment*)g_ptr_array_index(dl->segments, i))->done;
+    }
+
+    /* An earlier run got all data but could not finish. */
+    if (!pending) {
+        download_finished(dl);
+        return TRUE;
+    }
+
+    /* Take the cookies from webkit to download from pages that require a
+     * login. The segments are requested once the cookies are known. */
+    cm              = webkit_web_context_get_cookie_manager(webkit_web_view_get_context(c->webview));
+    dl->cancellable = g_cancellable_new();
+    webkit_cookie_manager_get_cookies(cm, dl->uri, dl->cancellable, on_cookies_got, dl);
+
+    /* to reflect the correct download count */
+    vb_statusbar_invalidate(c, STATUS_DIRTY(STATUS_DOWNLOADS));
+
+    return TRUE;
+}
+
+/**
+ * Aborts the downloads of a client that is closed by force. The transfered
+ * data is kept to resume the downloads later.
+ */
+void download_client_closed(Client *c)
+{
+    GList *l, *next;
+    Download *dl;
+
+    for (l = engine.downloads; l; l = next) {
+        next = l->next;
+        dl   = (Download*)l->data;
+        if (dl->c == c) {
+            save_state(dl);
+            download_free(dl);
+        }
+    }
+}
+
+void download_cleanup(void)
+{
+    while (engine.downloads) {
+        save_state(engine.downloads->data);
+        download_free(engine.downloads->data);
+    }
+    g_clear_object(&engine.session);
+}
+
+static SoupSession *get_session(void)
+{
+    if (engine.session) {
+        return engine.session;
+    }
+
+    /* Allow all segments of a download to run in parallel, by default
+     * libsoup uses only 2 connections per host. */
+    engine.session = soup_session_new_with_options(
+            SOUP_SESSION_MAX_CONNS, DOWNLOAD_SEGMENTS_MAX * 2,
+            SOUP_SESSION_MAX_CONNS_PER_HOST, DOWNLOAD_SEGMENTS_MAX,
+            NULL);
+
+    return engine.session;
+}
+
+static void on_cookies_got(GObject *source, GAsyncResult *res, gpointer data)
+{
+    Download *dl = (Download*)data;
+    Segment *seg;
+    GList *cookies, *l;
+    GString *header;
+    GError *error = NULL;
+    char *value;
+    guint i;
+
+    cookies = webkit_cookie_manager_get_cookies_finish(WEBKIT_COOKIE_MANAGER(source), res, &error);
+    if (g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+        /* The download was removed in the meantime. */
+        g_error_free(error);
+        return;
+    }
+    /* Try without cookies if they could not be read. */
+    g_clear_error(&error);
+    if (cookies) {
+        header = g_string_new(NULL);
+        for (l = cookies; l; l = l->next) {
+            value = soup_cookie_to_cookie_header((SoupCookie*)l->data);
+            g_string_append_printf(header, "%s%s", header->len ? "; " : "", value);
+            g_free(value);
+        }
+        dl->cookies = g_string_free(header, FALSE);
+        g_list_free_full(cookies, (GDestroyNotify)soup_cookie_free);
+    }
+
+    for (i = 0; i < dl->segments->len; i++) {
+        seg = g_ptr_array_index(dl->segments, i);
+        if (!seg->done) {
+            segment_request(seg);
+        }
+    }
+}
+
+static void create_segments(Download *dl, guint count)
+{
+    goffset len, start;
+    guint i;
+
+    if (dl->size <= 0) {
+        g_ptr_array_add(dl->segments, segment_new(dl, 0, -1, 0));
+        return;
+    }
+
+    if (!dl->ranges) {
+        count = 1;
+    } else {
+        /* Don't split small files - the requests cost more than they gain. */
+        count = CLAMP(dl->size / DOWNLOAD_SEGMENT_MIN_SIZE, 1, MIN(count, DOWNLOAD_SEGMENTS_MAX));
+    }
+
+    len = dl->size / count;
+    for (i = 0; i < count; i++) {
+        start = i * len;
+        g_ptr_array_add(dl->segments, segment_new(dl, start,
+                    i == count - 1 ? dl->size - 1 : start + len - 1, start));
+    }
+}
+
+static Segment *segment_new(Download *dl, goffset start, goffset end, goffset offset)
+{
+    Segment *seg = g_new0(Segment, 1);
+
+    seg->dl     = dl;
+    seg->start  = start;
+    seg->end    = end;
+    seg->offset = offset;
+    seg->done   = end >= 0 && offset > end;
+
+    return seg;
+}
+
+static void segment_request(Segment *seg)
+{
+    Download *dl = seg->dl;
+
+    g_clear_object(&seg->msg);
+    g_clear_object(&seg->stream);
+    g_clear_object(&seg->cancellable);
+
+    seg->msg = soup_message_new("GET", dl->uri);
+    if (!seg->msg) {
+        download_failed(dl, "invalid uri");
+        return;
+    }
+    if (!dl->ranges && seg->offset > seg->start) {
+        /* Without ranges a retry gets the whole file again, so the data
+         * written so far is overwritten from the start. */
+        seg->offset = seg->start;
+        download_tracker_reset(&dl->stat, dl->size, 0, g_get_monotonic_time());
+    }
+    if (dl->ranges && (seg->offset > 0 || dl->segments->len > 1)) {
+        soup_message_headers_set_range(seg->msg->request_headers, seg->offset, seg->end);
+    }
+    if (dl->referer) {
+        soup_message_headers_replace(seg->msg->request_headers, "Referer", dl->referer);
+    }
+    if (dl->user_agent) {
+        soup_message_headers_replace(seg->msg->request_headers, "User-Agent", dl->user_agent);
+    }
+    if (dl->cookies) {
+        soup_message_headers_replace(seg->msg->request_headers, "Cookie", dl->cookies);
+    }
+
+    seg->cancellable = g_cancellable_new();
+    seg->busy        = TRUE;
+    soup_session_send_async(get_session(), seg->msg, seg->cancellable,
+            on_segment_sent, seg);
+}
+
+static void on_segment_sent(GObject *source, GAsyncResult *res, gpointer data)
+{
+    Segment *seg = (Segment*)data;
+    GInputStream *stream;
+    GError *error = NULL;
+    goffset start, end;
+    guint status;
+
+    seg->busy = FALSE;
+    stream    = soup_session_send_finish(SOUP_SESSION(source), res, &error);
+    if (!seg->dl) {
+        /* The download was removed in the meantime. */
+        g_clear_object(&stream);
+        g_clear_error(&error);
+        segment_free(seg);
+        return;
+    }
+    if (!stream) {
+        segment_error(seg, error->message);
+        g_error_free(error);
+        return;
+    }
+
+    seg->stream = stream;
+    status      = seg->msg->status_code;
+    if (status == SOUP_STATUS_PARTIAL_CONTENT
+        && (!soup_message_headers_get_content_range(seg->msg->response_headers, &start, &end, NULL)
+            || start != seg->offset)) {
+        /* The server sends another range than requested. Appending it at
+         * the offset would corrupt the file, so fetch the file as a whole. */
+        restart_single(seg->dl);
+        return;
+    } else if (status == SOUP_STATUS_OK
+        && (seg->offset > seg->start
+            || soup_message_headers_get_one(seg->msg->request_headers, "Range"))) {
+        /* The server ignored the range and sends the whole file. This is
+         * fine for a single segment but not for parallel ones. */
+        if (seg->dl->segments->len > 1) {
+            restart_single(seg->dl);
+            return;
+        }
+        seg->offset = seg->start;
+        download_tracker_reset(&seg->dl->stat, seg->dl->size, 0,
+                g_get_monotonic_time());
+    } else if (!SOUP_STATUS_IS_SUCCESSFUL(status)) {
+        segment_error(seg, seg->msg->reason_phrase);
+        return;
+    }
+
+    segment_read(seg);
+}
+
+static void segment_read(Segment *seg)
+{
+    seg->busy = TRUE;
+    g_input_stream_read_async(seg->stream, seg->buf, sizeof(seg->buf),
+            G_PRIORITY_DEFAULT, seg->cancellable, on_segment_read, seg);
+}
+
+static void on_segment_read(GObject *source, GAsyncResult *res, gpointer data)
+{
+    Segment *seg = (Segment*)data;
+    Download *dl;
+    GError *error = NULL;
+    gssize len;
+    guint i;
+
+    seg->busy = FALSE;
+    len       = g_input_stream_read_finish(G_INPUT_STREAM(source), res, &error);
+    if (!(dl = seg->dl)) {
+        g_clear_error(&error);
+        segment_free(seg);
+        return;
+    }
+    if (len < 0) {
+        segment_error(seg, error->message);
+        g_error_free(error);
+        return;
+    }
+    if (len == 0) {
+        /* Connection closed before the end of the segment. */
+        if (seg->end >= 0 && seg->offset <= seg->end) {
+            segment_error(seg, "connection closed");
+            return;
+        }
+        seg->done = TRUE;
+    } else {
+        /* Don't write beyond the segment if the server sends more. */
+        if (seg->end >= 0 && seg->offset + len > seg->end + 1) {
+            len = seg->end + 1 - seg->offset;
+        }
+        if (!write_all(dl->fd, seg->buf, len, seg->offset)) {
+            download_failed(dl, g_strerror(errno));
+            return;
+        }
+        seg->offset  += len;
+        seg->retries  = 0;
+        seg->done     = seg->end >= 0 && seg->offset > seg->end;
+    }
+
+    if (!seg->done) {
+        segment_read(seg);
+        download_progress(dl, len);
+        return;
+    }
+
+    g_clear_object(&seg->stream);
+    for (i = 0; i < dl->segments->len; i++) {
+        if (!((Segment*)g_ptr_array_index(dl->segments, i))->done) {
+            download_progress(dl, len);
+            return;
+        }
+    }
+    download_finished(dl);
+}
+
+/**
+ * Retries the segment from its current offset or fails the download if the
+ * segment failed too often.
+ */
+static void segment_error(Segment *seg, const char *message)
+{
+    if (seg->retries >= DOWNLOAD_RETRIES) {
+        download_failed(seg->dl, message);
+        return;
+    }
+    seg->retries++;
+    seg->retry_id = g_timeout_add_seconds(seg->retries, on_segment_retry, seg);
+}
+
+static gboolean on_segment_retry(gpointer data)
+{
+    Segment *seg = (Segment*)data;
+
+    seg->retry_id = 0;
+    segment_request(seg);
+
+    return G_SOURCE_REMOVE;
+}
+
+/**
+ * Removes the segment from its download. Segments with pending operations
+ * are freed in the callback of the cancelled operation.
+ */
+static void segment_detach(Segment *seg)
+{
+    if (seg->retry_id) {
+        g_source_remove(seg->retry_id);
+        seg->retry_id = 0;
+    }
+    seg->dl = NULL;
+    if (seg->busy) {
+        g_cancellable_cancel(seg->cancellable);
+    } else {
+        segment_free(seg);
+    }
+}
+
+static void segment_free(Segment *seg)
+{
+    g_clear_object(&seg->msg);
+    g_clear_object(&seg->stream);
+    g_clear_object(&seg->cancellable);
+    g_free(seg);
+}
+
+/**
+ * Starts the download again as single request from the beginning.
+ */
+static void restart_single(Download *dl)
+{
+    guint i;
+
+    for (i = 0; i < dl->segments->len; i++) {
+        segment_detach(g_ptr_array_index(dl->segments, i));
+    }
+    g_ptr_array_set_size(dl->segments, 0);
+
+    dl->ranges = FALSE;
+    download_tracker_reset(&dl->stat, dl->size, 0, g_get_monotonic_time());
+    create_segments(dl, 1);
+    segment_request(g_ptr_array_index(dl->segments, 0));
+}
+
+static void download_progress(Download *dl, gsize len)
+{
+    gint64 now = g_get_monotonic_time();
+
+    /* the tracker rate limits the statusbar updates per client */
+    if (download_tracker_update(&dl->stat, len, now)) {
+        vb_statusbar_invalidate(dl->c, STATUS_DIRTY(STATUS_DOWNLOADS));
+    }
+    if (now - dl->saved > DOWNLOAD_RESUME_INTERVAL * G_USEC_PER_SEC) {
+        save_state(dl);
+    }
+}
+
+static void download_finished(Download *dl)
+{
+    Client *c = dl->c;
+    char *basename;
+
+    /* The size of a file with unknown length is given by the written data. */
+    if (dl->size < 0 && ftruncate(dl->fd, get_received(dl)) == -1) {
+        download_failed(dl, g_strerror(errno));
+        return;
+    }
+    close(dl->fd);
+    dl->fd = -1;
+    if (g_rename(dl->part, dl->path) == -1) {
+        download_failed(dl, g_strerror(errno));
+        return;
+    }
+    g_unlink(dl->resume);
+
+#ifdef FEATURE_AUTOCMD
+    autocmd_run(c, AU_DOWNLOAD_FINISHED, dl->uri, NULL);
+#endif
+    basename = g_path_get_basename(dl->path);
+    vb_echo(c, MSG_NORMAL, FALSE, "Download of %s finished", basename);
+    g_free(basename);
+
+    download_free(dl);
+    vb_statusbar_invalidate(c, STATUS_DIRTY(STATUS_DOWNLOADS));
+}
+
+/**
+ * Stops the download and reports the error. The data is kept so that a
+ * later download of the same uri into this file resumes.
+ */
+static void download_failed(Download *dl, const char *message)
+{
+    Client *c = dl->c;
+    char *basename;
+
+    save_state(dl);
+
+#ifdef FEATURE_AUTOCMD
+    autocmd_run(c, AU_DOWNLOAD_FAILED, dl->uri, NULL);
+#endif
+    basename = g_path_get_basename(dl->path);
+    vb_echo(c, MSG_ERROR, FALSE, "Download of %s failed (%s)", basename,
+            message ? message : "unknown error");
+    g_free(basename);
+
+    download_free(dl);
+    vb_statusbar_invalidate(c, STATUS_DIRTY(STATUS_DOWNLOADS));
+}
+
+static void download_free(Download *dl)
+{
+    guint i;
+
+    for (i = 0; i < dl->segments->len; i++) {
+        segment_detach(g_ptr_array_index(dl->segments, i));
+    }
+    g_ptr_array_free(dl->segments, TRUE);
+    if (dl->fd != -1) {
+        close(dl->fd);
+    }
+    if (dl->cancellable) {
+        g_cancellable_cancel(dl->cancellable);
+        g_object_unref(dl->cancellable);
+    }
+    download_tracker_remove(&dl->stat);
+    engine.downloads = g_list_remove(engine.downloads, dl);
+
+    g_free(dl->uri);
+    g_free(dl->referer);
+    g_free(dl->user_agent);
+    g_free(dl->cookies);
+    g_free(dl->path);
+    g_free(dl->part);
+    g_free(dl->resume);
+    g_slice_free(Download, dl);
+}
+
+static goffset get_received(Download *dl)
+{
+    Segment *seg;
+    goffset received = 0;
+    guint i;
+
+    for (i = 0; i < dl->segments->len; i++) {
+        seg       = g_ptr_array_index(dl->segments, i);
+        received += seg->offset - seg->start;
+    }
+
+    return received;
+}
+
+static gboolean write_all(int fd, const char *buf, gsize len, goffset offset)
+{
+    gssize n;
+
+    while (len) {
+        n = pwrite(fd, buf, len, offset);
+        if (n == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return FALSE;
+        }
+        buf    += n;
+        len    -= n;
+        offset += n;
+    }
+
+    return TRUE;
+}
+
+/**
+ * Writes the offsets of the segments into the resume file. Downloads of
+ * unknown size can't be resumed.
+ */
+static void save_state(Download *dl)
+{
+    GKeyFile *kf;
+    Segment *seg;
+    char **segments;
+    guint i;
+
+    dl->saved = g_get_monotonic_time();
+    if (dl->size <= 0 || dl->fd == -1) {
+        return;
+    }
+
+    /* The saved offsets must not be ahead of the data on disk. */
+    fdatasync(dl->fd);
+
+    segments = g_new0(char*, dl->segments->len + 1);
+    for (i = 0; i < dl->segments->len; i++) {
+        seg         = g_ptr_array_index(dl->segments, i);
+        segments[i] = g_strdup_printf("%" G_GINT64_FORMAT ":%" G_GINT64_FORMAT ":%" G_GINT64_FORMAT,
+                seg->start, seg->end, seg->offset);
+    }
+
+    kf = g_key_file_new();
+    g_key_file_set_string(kf, "download", "uri", dl->uri);
+    g_key_file_set_int64(kf, "download", "size", dl->size);
+    g_key_file_set_boolean(kf, "download", "ranges", dl->ranges);
+    g_key_file_set_string_list(kf, "download", "segments",
+            (const char * const *)segments, dl->segments->len);
+    g_key_file_save_to_file(kf, dl->resume, NULL);
+
+    g_key_file_free(kf);
+    g_strfreev(segments);
+}
+
+/**
+ * Restores the segments from the resume file if it belongs to the same uri
+ * and size. Returns TRUE if the segments were restored.
+ */
+static gboolean load_state(Download *dl)
+{
+    GKeyFile *kf;
+    GStatBuf st;
+    char **segments = NULL, *uri = NULL;
+    gint64 start, end, offset;
+    gsize len = 0, i;
+    gboolean ok = FALSE;
+
+    if (dl->size <= 0 || g_stat(dl->part, &st) == -1 || st.st_size != dl->size) {
+        return FALSE;
+    }
+
+    kf = g_key_file_new();
+    if (!g_key_file_load_from_file(kf, dl->resume, G_KEY_FILE_NONE, NULL)) {
+        goto out;
+    }
+    uri = g_key_file_get_string(kf, "download", "uri", NULL);
+    if (g_strcmp0(uri, dl->uri)
+        || g_key_file_get_int64(kf, "download", "size", NULL) != dl->size) {
+        goto out;
+    }
+    /* Parallel segments can only continue if the server still accepts
+     * ranges. */
+    if (g_key_file_get_boolean(kf, "download", "ranges", NULL) && !dl->ranges) {
+        goto out;
+    }
+    segments = g_key_file_get_string_list(kf, "download", "segments", &len, NULL);
+    if (!segments || !len || (len > 1 && !dl->ranges)) {
+        goto out;
+    }
+    for (i = 0; i < len; i++) {
+        if (sscanf(segments[i], "%" G_GINT64_FORMAT ":%" G_GINT64_FORMAT ":%" G_GINT64_FORMAT,
+                    &start, &end, &offset) != 3
+            || start < 0 || end >= dl->size || offset < start || offset > end + 1) {
+            goto out;
+        }
+        /* Without ranges a single segment must start from the beginning. */
+        if (!dl->ranges) {
+            offset = start;
+        }
+        g_ptr_array_add(dl->segments, segment_new(dl, start, end, offset));
+    }
+    ok = TRUE;
+
+out:
+    if (!ok) {
+        for (i = 0; i < dl->segments->len; i++) {
+            segment_free(g_ptr_array_index(dl->segments, i));
+        }
+        g_ptr_array_set_size(dl->segments, 0);
+    }
+    g_strfreev(segments);
+    g_free(uri);
+    g_key_file_free(kf);
+
+    return ok;
+}
@@ -0,0 +1,31 @@
+/**
+ * vimb - a webkit based vim like browser.
+ *
+ * Copyright (C) 2012-2018 Daniel Carl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+#ifndef _DOWNLOAD_H
+#define _DOWNLOAD_H
+
+#include <glib.h>
+#include "main.h"
+
+gboolean download_start(Client *c, const char *uri, const char *referer,
+        const char *path, goffset size, gboolean ranges);
+void download_client_closed(Client *c);
+void download_cleanup(void);
+
+#endif /* end of include guard: _DOWNLOAD_H */
@@ -24,6 +24,7 @@
 
 #include <JavaScriptCore/JavaScript.h>
 #include <string.h>
+#include <sys/stat.h>
 #include <sys/wait.h>
 
 #include "ascii.h"
@@ -32,6 +33,7 @@
 #include "completion.h"
 #include "config.h"
 #include "ex.h"
+#include "file-completion.h"
 #include "handler.h"
 #include "hints.h"
 #include "history.h"
@@ -39,6 +41,7 @@
 #include "map.h"
 #include "setting.h"
 #include "shortcut.h"
+#include "suspend.h"
 #include "util.h"
 #include "ext-proxy.h"
 #include "autocmd.h"
@@ -52,6 +55,7 @@ typedef enum {
     EX_BMA,
     EX_BMR,
     EX_EVAL,
+    EX_EXTENSION,
     EX_HARDCOPY,
     EX_CLEARDATA,
     EX_CMAP,
@@ -81,7 +85,9 @@ typedef enum {
     EX_SCR,
     EX_SET,
     EX_SHELLCMD,
+    EX_SITE,
     EX_SOURCE,
+    EX_SUSPENDED,
     EX_TABOPEN,
 } ExCode;
 
@@ -117,11 +123,34 @@ typedef struct {
 } ExInfo;
 
 static struct {
-    char reg;    /* char for the yank register */
-    Phase phase; /* current parsing phase */
-} info = {'\0', PHASE_START};
+    char reg;            /* char for the yank register */
+    Phase phase;         /* current parsing phase */
+    gboolean nosettings; /* skip :set and :site while running the config */
+} info = {'\0', PHASE_START, FALSE};
+
+/* Command of a file parsed once to be replayed for every client. */
+typedef struct {
+    guint      lineno;  /* line number of the command for error messages */
+    char       *line;   /* the line the command was parsed from */
+    ExArg      *arg;    /* the parsed command or NULL if the line is invalid */
+    SettingCmd *set;    /* resolved setting and converted value of :set */
+} CompiledCmd;
+
+/* File like the config compiled into the commands to run. It is reused for
+ * every new client as long as the file is not changed. */
+typedef struct {
+    dev_t     dev;
+    ino_t     ino;
+    time_t    mtime;
+    off_t     size;
+    GPtrArray *cmds;    /* the CompiledCmd of the file in order */
+} CompiledFile;
 
 static void input_activate(Client *c);
+static CompiledFile *compile_file(Client *c, const char *filename);
+static void compile_line(Client *c, GPtrArray *cmds, const char *line, guint lineno);
+static void compiled_cmd_free(CompiledCmd *cc);
+static void compiled_file_free(CompiledFile *cf);
 static gboolean parse(Client *c, const char **input, ExArg *arg, gboolean *nohist);
 static gboolean parse_count(const char **input, ExArg *arg);
 static gboolean parse_command_name(Client *c, const char **input, ExArg *arg);
@@ -156,6 +185,9 @@ static VbCmdResult ex_set(Client *c, const ExArg *arg);
 static VbCmdResult ex_shellcmd(Client *c, const ExArg *arg);
 static VbCmdResult ex_shortcut(Client *c, const ExArg *arg);
 static VbCmdResult ex_source(Client *c, const ExArg *arg);
+static VbCmdResult ex_site(Client *c, const ExArg *arg);
+static VbCmdResult ex_suspended(Client *c, const ExArg *arg);
+static VbCmdResult ex_extension(Client *c, const ExArg *arg);
 static VbCmdResult ex_handlers(Client *c, const ExArg *arg);
 
 static gboolean complete(Client *c, short direction);
@@ -185,6 +217,7 @@ static ExInfo commands[] = {
     {"handler-add",      EX_HANDADD,     ex_handlers,   EX_FLAG_RHS},
     {"handler-remove",   EX_HANDREM,     ex_handlers,   EX_FLAG_RHS},
     {"eval",             EX_EVAL,        ex_eval,       EX_FLAG_CMD|EX_FLAG_BANG},
+    {"extension",        EX_EXTENSION,   ex_extension,  EX_FLAG_NONE},
     {"imap",             EX_IMAP,        ex_map,        EX_FLAG_LHS|EX_FLAG_CMD},
     {"inoremap",         EX_INOREMAP,    ex_map,        EX_FLAG_LHS|EX_FLAG_CMD},
     {"iunmap",           EX_IUNMAP,      ex_unmap,      EX_FLAG_LHS},
@@ -207,7 +240,9 @@ static ExInfo commands[] = {
     {"shortcut-add",     EX_SCA,         ex_shortcut,   EX_FLAG_RHS},
     {"shortcut-default", EX_SCD,         ex_shortcut,   EX_FLAG_RHS},
     {"shortcut-remove",  EX_SCR,         ex_shortcut,   EX_FLAG_RHS},
+    {"site",             EX_SITE,        ex_site,       EX_FLAG_LHS|EX_FLAG_RHS},
     {"source",           EX_SOURCE,      ex_source,     EX_FLAG_RHS|EX_FLAG_EXP},
+    {"suspended",        EX_SUSPENDED,   ex_suspended,  EX_FLAG_NONE},
     {"tabopen",          EX_TABOPEN,     ex_open,       EX_FLAG_CMD},
 };
 
@@ -224,6 +259,8 @@ static struct {
     GList *active;
 } exhist;
 
+static GHashTable *compiled_files = NULL;
+
 extern struct Vimb vb;
 
 /**
@@ -243,6 +280,7 @@ void ex_enter(Client *c)
 void ex_leave(Client *c)
 {
     completion_clean(c);
+    file_completion_cancel(c);
     hints_clear(c);
     if (c->config.incsearch) {
         command_search(c, &((Arg){0, NULL}), FALSE);
@@ -463,33 +501,86 @@ gboolean ex_fill_completion(GtkListStore *store, const char *input)
     return found;
 }
 
+/**
+ * Runs the config file for a new client. If settings is FALSE the :set and
+ * :site commands of the file and the files it sources are skipped, because
+ * their result is already in the defaults the client was created with.
+ */
+VbCmdResult ex_run_config(Client *c, const char *filename, gboolean settings)
+{
+    VbCmdResult res;
+
+    info.nosettings = !settings;
+    res = ex_run_file(c, filename);
+    info.nosettings = FALSE;
+
+    return res;
+}
+
 /**
  * Run all ex commands from a file.
  */
 VbCmdResult ex_run_file(Client *c, const char *filename)
 {
-    int length, i;
-    char *line, **lines;
-    VbCmdResult res = CMD_SUCCESS;
-
-    lines = util_get_lines(filename);
-    if (!lines) {
+    guint i, failed = 0;
+    CompiledFile *cf;
+    CompiledCmd *cc;
+    GPtrArray *cmds;
+    ExArg *arg;
+    VbCmdResult res = CMD_SUCCESS, cmdres;
+
+    cf = compile_file(c, filename);
+    if (!cf) {
         return res;
     }
 
-    length = g_strv_length(lines);
-    for (i = 0; i < length; i++) {
-        line = lines[i];
-        /* skip commented or empty lines */
-        if (*line == '#' || !*line) {
+    /* Keep the commands alive in case the file is sourced again and
+     * recompiled by one of its own commands. */
+    cmds = g_ptr_array_ref(cf->cmds);
+    arg  = g_slice_new0(ExArg);
+    arg->lhs = g_string_new("");
+    arg->rhs = g_string_new("");
+
+    /* Apply the settings in one batch to run expensive side effects like
+     * the regeneration of the gui style only once. */
+    setting_batch_begin();
+    for (i = 0; i < cmds->len; i++) {
+        cc = g_ptr_array_index(cmds, i);
+        /* like ex_run_string() skip the rest of a line after an error */
+        if (cc->lineno == failed) {
             continue;
         }
-        if ((ex_run_string(c, line, FALSE) & ~CMD_KEEPINPUT) == CMD_ERROR) {
-            res = CMD_ERROR | CMD_KEEPINPUT;
-            g_warning("Invalid command in %s line #%u : '%s'", filename, i+1, line);
+        if (info.nosettings && cc->arg
+                && (cc->arg->code == EX_SET || cc->arg->code == EX_SITE)) {
+            continue;
+        }
+        if (!cc->arg) {
+            cmdres = CMD_ERROR;
+        } else if (cc->arg->code == EX_SET) {
+            cmdres = cc->set ? setting_cmd_run(c, cc->set) : CMD_ERROR;
+        } else {
+            /* work on a copy, because some commands modify their arguments */
+            arg->count = cc->arg->count;
+            arg->idx   = cc->arg->idx;
+            arg->name  = cc->arg->name;
+            arg->code  = cc->arg->code;
+            arg->bang  = cc->arg->bang;
+            arg->flags = cc->arg->flags;
+            g_string_assign(arg->lhs, cc->arg->lhs->str);
+            g_string_assign(arg->rhs, cc->arg->rhs->str);
+            cmdres = execute(c, arg);
+        }
+        if ((cmdres & ~CMD_KEEPINPUT) == CMD_ERROR) {
+            res    = CMD_ERROR | CMD_KEEPINPUT;
+            failed = cc->lineno;
+            g_warning("Invalid command in %s line #%u : '%s'", filename,
+                    cc->lineno, cc->line);
         }
     }
-    g_strfreev(lines);
+    setting_batch_end(c);
+
+    free_cmdarg(arg);
+    g_ptr_array_unref(cmds);
 
     return res;
 }
@@ -559,6 +650,123 @@ static void input_activate(Client *c)
     g_free(text);
 }
 
+/**
+ * Returns the compiled commands of given file. The file is only read and
+ * parsed again if its inode, size or modification time changed since the last
+ * call. Returns NULL if the file could not be read.
+ */
+static CompiledFile *compile_file(Client *c, const char *filename)
+{
+    CompiledFile *cf;
+    struct stat st;
+    char **lines;
+    guint i;
+
+    if (!compiled_files) {
+        compiled_files = g_hash_table_new_full(g_str_hash, g_str_equal,
+                g_free, (GDestroyNotify)compiled_file_free);
+    }
+
+    if (!filename || stat(filename, &st) == -1) {
+        if (filename) {
+            g_hash_table_remove(compiled_files, filename);
+        }
+        return NULL;
+    }
+
+    cf = g_hash_table_lookup(compiled_files, filename);
+    if (cf && cf->dev == st.st_dev && cf->ino == st.st_ino
+            && cf->mtime == st.st_mtime && cf->size == st.st_size) {
+        return cf;
+    }
+
+    lines = util_get_lines(filename);
+    if (!lines) {
+        g_hash_table_remove(compiled_files, filename);
+        return NULL;
+    }
+
+    cf        = g_slice_new0(CompiledFile);
+    cf->dev   = st.st_dev;
+    cf->ino   = st.st_ino;
+    cf->mtime = st.st_mtime;
+    cf->size  = st.st_size;
+    cf->cmds  = g_ptr_array_new_with_free_func((GDestroyNotify)compiled_cmd_free);
+
+    for (i = 0; lines[i]; i++) {
+        /* skip commented or empty lines */
+        if (*lines[i] == '#' || !*lines[i]) {
+            continue;
+        }
+        compile_line(c, cf->cmds, lines[i], i + 1);
+    }
+    g_strfreev(lines);
+
+    g_hash_table_replace(compiled_files, g_strdup(filename), cf);
+
+    return cf;
+}
+
+/**
+ * Parses the commands of a single line and appends them to cmds. The value of
+ * a :set is converted here already so that replaying the command only has to
+ * apply it.
+ */
+static void compile_line(Client *c, GPtrArray *cmds, const char *line, guint lineno)
+{
+    const char *in = line;
+    gboolean nohist = FALSE;
+    CompiledCmd *cc;
+    ExArg *arg;
+    char *name, *param;
+
+    while (in && *in) {
+        cc         = g_slice_new0(CompiledCmd);
+        cc->lineno = lineno;
+        cc->line   = g_strdup(line);
+        g_ptr_array_add(cmds, cc);
+
+        arg      = g_slice_new0(ExArg);
+        arg->lhs = g_string_new("");
+        arg->rhs = g_string_new("");
+        if (!parse(c, &in, arg, &nohist)) {
+            free_cmdarg(arg);
+            break;
+        }
+        cc->arg = arg;
+
+        if (arg->code == EX_SET && arg->rhs->len) {
+            /* split the input string into parameter and value part */
+            name = g_strdup(arg->rhs->str);
+            if ((param = strchr(name, '='))) {
+                *param++ = '\0';
+                g_strstrip(param);
+            }
+            g_strstrip(name);
+            cc->set = setting_cmd_new(c, name, param);
+            g_free(name);
+        }
+    }
+}
+
+static void compiled_cmd_free(CompiledCmd *cc)
+{
+    if (cc->arg) {
+        free_cmdarg(cc->arg);
+    }
+    if (cc->set) {
+        setting_cmd_free(cc->set);
+    }
+    g_free(cc->line);
+    g_slice_free(CompiledCmd, cc);
+}
+
+static void compiled_file_free(CompiledFile *cf)
+{
+    g_ptr_array_unref(cf->cmds);
+    g_slice_free(CompiledFile, cf);
+}
+
 /**
  * Parses given input string into given ExArg pointer.
  */
@@ -1102,6 +1310,28 @@ static VbCmdResult ex_set(Client *c, const ExArg *arg)
     return setting_run(c, arg->rhs->str, NULL);
 }
 
+/**
+ * Adds a setting that is used for the pages of the hosts matched by the lhs
+ * like ':site example.com scripts=off'.
+ */
+static VbCmdResult ex_site(Client *c, const ExArg *arg)
+{
+    char *param = NULL;
+
+    if (!arg->lhs->len || !arg->rhs->len) {
+        return CMD_ERROR;
+    }
+
+    /* split the input string into parameter and value part */
+    if ((param = strchr(arg->rhs->str, '='))) {
+        *param++ = '\0';
+        g_strstrip(arg->rhs->str);
+        g_strstrip(param);
+    }
+
+    return setting_site_add(c, arg->lhs->str, arg->rhs->str, param);
+}
+
 static VbCmdResult ex_shellcmd(Client *c, const ExArg *arg)
 {
     int status;
@@ -1220,6 +1450,30 @@ static VbCmdResult ex_source(Client *c, const ExArg *arg)
     return ex_run_file(c, arg->rhs->str);
 }
 
+/**
+ * Shows the windows waiting to load their page and the memory freed by
+ * suspending windows.
+ */
+static VbCmdResult ex_suspended(Client *c, const ExArg *arg)
+{
+    char *status = suspend_get_status();
+
+    vb_echo(c, MSG_NORMAL, FALSE, "%s", status);
+    g_free(status);
+
+    return CMD_SUCCESS | CMD_KEEPINPUT;
+}
+
+static VbCmdResult ex_extension(Client *c, const ExArg *arg)
+{
+    char *status = ext_proxy_get_status();
+
+    vb_echo(c, MSG_NORMAL, FALSE, "%s", status);
+    g_free(status);
+
+    return CMD_SUCCESS | CMD_KEEPINPUT;
+}
+
 /**
  * Manage the generation and stepping through completions.
  * This function prepared some prefix and suffix string that are required to
@@ -1253,6 +1507,9 @@ static gboolean complete(Client *c, short direction)
         completion_clean(c);
     }
 
+    /* A file completion for a former input is not needed anymore. */
+    file_completion_cancel(c);
+
     store = gtk_list_store_new(COMPLETION_STORE_NUM, G_TYPE_STRING, G_TYPE_STRING);
 
     in = (const char*)input;
@@ -1333,7 +1590,9 @@ static gboolean complete(Client *c, short direction)
 
                 case EX_SAVE: /* Fallthrough */
                 case EX_SOURCE:
-                    found = util_filename_fill_completion(store, token);
+                    /* The directory is read in the background and the
+                     * completion is shown once matches are found. */
+                    file_completion_start(c, token, completion_select, direction < 0);
                     break;
 
 #ifdef FEATURE_AUTOCMD
@@ -18,10 +18,14 @@
  */
 
 #include <gio/gio.h>
+#include <gio/gunixfdlist.h>
 #include <glib.h>
 
+#include "config.h"
 #include "ext-proxy.h"
 #include "main.h"
+#include "session.h"
+#include "trace.h"
 #include "webextension/ext-main.h"
 
 static gboolean on_authorize_authenticated_peer(GDBusAuthObserver *observer,
@@ -44,12 +48,34 @@ static void on_web_extension_page_created(GDBusConnection *connection,
         const char *sender_name, const char *object_path,
         const char *interface_name, const char *signal_name,
         GVariant *parameters, gpointer data);
+static void set_client_proxy(Client *c, GDBusProxy *proxy);
+static void on_search(GDBusProxy *proxy, GAsyncResult *result, Client *c);
+static void pending_call_free(gpointer data);
+
+/* Method call made before the web extension of the client's page was
+ * connected. */
+typedef struct {
+    char                *method;
+    GVariant            *param;
+    GAsyncReadyCallback callback;
+} PendingCall;
 
 /* TODO we need potentially multiple proxies. Because a single instance of
  * vimb may hold multiple clients which may use more than one webprocess and
  * therefore multiple webextension instances. */
 extern struct Vimb vb;
 static GDBusServer *dbusserver;
+/* Proxies of pages created for webviews not yet bound to a client like those
+ * of the webview pool, keyed by the page id. */
+static GHashTable *pending_proxies;
+/* Time the clients waited for the web extension of their page. */
+static struct {
+    guint   count;      /* number of connected clients */
+    gint64  total;      /* summed up waiting time in microseconds */
+    gint64  max;
+    guint   queued;     /* calls queued before the connection */
+    guint   dropped;    /* calls dropped because the queue was full */
+} metrics;
 
 
 /**
@@ -169,6 +195,12 @@ static void on_proxy_created(GDBusProxy *new_proxy, GAsyncResult *result,
             VB_WEBEXTENSION_OBJECT_PATH, NULL, G_DBUS_SIGNAL_FLAGS_NONE,
             (GDBusSignalCallback)on_web_extension_page_created, proxy,
             NULL);
+    /* One subscription per connection serves all pages of the web process,
+     * the signals are dispatched by their page id. */
+    g_dbus_connection_signal_subscribe(connection, NULL,
+            VB_WEBEXTENSION_INTERFACE, "VerticalScroll",
+            VB_WEBEXTENSION_OBJECT_PATH, NULL, G_DBUS_SIGNAL_FLAGS_NONE,
+            (GDBusSignalCallback)on_vertical_scroll, NULL, NULL);
 }
 
 /**
@@ -191,9 +223,9 @@ static void on_vertical_scroll(GDBusConnection *connection,
         c->state.scroll_max     = max;
         c->state.scroll_percent = percent;
         c->state.scroll_top     = top;
+        vb_statusbar_invalidate(c, STATUS_DIRTY(STATUS_SCROLL));
+        session_schedule();
     }
-
-    vb_statusbar_update(c);
 }
 
 void ext_proxy_eval_script(Client *c, char *js, GAsyncReadyCallback callback)
@@ -210,6 +242,53 @@ GVariant *ext_proxy_eval_script_sync(Client *c, char *js)
     return dbus_call_sync(c, "EvalJs", g_variant_new("(ts)", c->page_id, js));
 }
 
+/**
+ * Calls the script function registered in the web extension with the values
+ * of the args tuple as arguments. If args is NULL the function is called
+ * without arguments. A floating args reference is consumed.
+ */
+void ext_proxy_call_js(Client *c, ExtJsFunction func, GVariant *args,
+        GAsyncReadyCallback callback)
+{
+    if (!args) {
+        args = g_variant_new("()");
+    }
+    if (callback) {
+        dbus_call(c, "CallJs", g_variant_new("(tuv)", c->page_id, func, args), callback);
+    } else {
+        dbus_call(c, "CallJsNoResult", g_variant_new("(tuv)", c->page_id, func, args), NULL);
+    }
+}
+
+GVariant *ext_proxy_call_js_sync(Client *c, ExtJsFunction func, GVariant *args)
+{
+    if (!args) {
+        args = g_variant_new("()");
+    }
+    return dbus_call_sync(c, "CallJs", g_variant_new("(tuv)", c->page_id, func, args));
+}
+
+/**
+ * Returns the pid of the web process of the client or 0 if it's not known.
+ */
+pid_t ext_proxy_get_pid(Client *c)
+{
+    GCredentials *credentials;
+    pid_t pid;
+
+    if (!c->dbusproxy) {
+        return 0;
+    }
+    credentials = g_dbus_connection_get_peer_credentials(
+            g_dbus_proxy_get_connection(c->dbusproxy));
+    if (!credentials) {
+        return 0;
+    }
+    pid = g_credentials_get_unix_pid(credentials, NULL);
+
+    return pid > 0 ? pid : 0;
+}
+
 /**
  * Request the web extension to focus first editable element.
  * Returns whether an focusable element was found or not.
@@ -219,6 +298,26 @@ void ext_proxy_focus_input(Client *c)
     dbus_call(c, "FocusInput", g_variant_new("(t)", c->page_id), NULL);
 }
 
+/**
+ * Request the web extension to scroll the page like the normal mode command
+ * given by mode.
+ */
+void ext_proxy_scroll(Client *c, char mode, int step, int count)
+{
+    dbus_call(c, "Scroll", g_variant_new("(tyii)", c->page_id, (guchar)mode, step, count), NULL);
+}
+
+/**
+ * Searches the query in the page and shows the number of matches in the
+ * statusbar. If step is not 0 the match step matches away from the selected
+ * one is selected. An empty query ends the search.
+ */
+void ext_proxy_search(Client *c, const char *query, ExtSearchFlags flags, int step)
+{
+    dbus_call(c, "Search", g_variant_new("(tsui)", c->page_id, query, flags, step),
+            (GAsyncReadyCallback)on_search);
+}
+
 /**
  * Send the headers string to the webextension.
  */
@@ -227,14 +326,80 @@ void ext_proxy_set_header(Client *c, const char *headers)
     dbus_call(c, "SetHeaderSetting", g_variant_new("(s)", headers), NULL);
 }
 
-void ext_proxy_lock_input(Client *c, const char *element_id)
+/**
+ * Requests the value of the focused editable element. The element is disabled
+ * until ext_proxy_set_editable_value() is called.
+ */
+void ext_proxy_get_editable_state(Client *c, GAsyncReadyCallback callback,
+        gpointer data)
 {
-    dbus_call(c, "LockInput", g_variant_new("(ts)", c->page_id, element_id), NULL);
+    if (!c->dbusproxy) {
+        return;
+    }
+    g_dbus_proxy_call_with_unix_fd_list(c->dbusproxy, "GetEditableState",
+            g_variant_new("(t)", c->page_id), G_DBUS_CALL_FLAGS_NONE, -1, NULL,
+            c->cancellable, callback, data);
 }
 
-void ext_proxy_unlock_input(Client *c, const char *element_id)
+/**
+ * Finishes ext_proxy_get_editable_state() with the proxy the callback got as
+ * source object. On success the key of the element and a file descriptor to
+ * read its value from are returned. The caller has to close the file
+ * descriptor. If the value could not be passed, fd is -1 and the element has
+ * to be unlocked by ext_proxy_set_editable_value() with the key. FALSE is
+ * returned if the call failed or the client was destroyed.
+ */
+gboolean ext_proxy_get_editable_state_finish(GDBusProxy *proxy, GAsyncResult *result,
+        guint *key, int *fd)
 {
-    dbus_call(c, "UnlockInput", g_variant_new("(ts)", c->page_id, element_id), NULL);
+    GVariant *value;
+    GUnixFDList *fdlist = NULL;
+    GError *error = NULL;
+    gint32 handle;
+
+    value = g_dbus_proxy_call_with_unix_fd_list_finish(proxy, &fdlist,
+            result, &error);
+    if (!value) {
+        if (!g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+            g_warning("Failed dbus method GetEditableState: %s", error->message);
+        }
+        g_error_free(error);
+        return FALSE;
+    }
+    g_variant_get(value, "(uh)", key, &handle);
+    g_variant_unref(value);
+
+    *fd = fdlist && handle != -1 ? g_unix_fd_list_get(fdlist, handle, NULL) : -1;
+    if (fdlist) {
+        g_object_unref(fdlist);
+    }
+
+    return TRUE;
+}
+
+/**
+ * Passes the file descriptor to read the new value of the editable element
+ * from and enables the element again. If fd is -1, the value is kept. The fd
+ * is not closed by this function.
+ */
+void ext_proxy_set_editable_value(Client *c, guint key, int fd)
+{
+    GUnixFDList *fdlist = NULL;
+    gint32 handle = -1;
+
+    if (!c->dbusproxy) {
+        return;
+    }
+    if (fd != -1) {
+        fdlist = g_unix_fd_list_new();
+        handle = g_unix_fd_list_append(fdlist, fd, NULL);
+    }
+    g_dbus_proxy_call_with_unix_fd_list(c->dbusproxy, "SetEditableValue",
+            g_variant_new("(uh)", key, handle), G_DBUS_CALL_FLAGS_NONE, -1,
+            fdlist, NULL, NULL, NULL);
+    if (fdlist) {
+        g_object_unref(fdlist);
+    }
 }
 
 /**
@@ -268,12 +433,29 @@ char *ext_proxy_get_current_selection(Client *c)
 static void dbus_call(Client *c, const char *method, GVariant *param,
         GAsyncReadyCallback callback)
 {
-    /* TODO add function to queue calls until the proxy connection is
-     * established */
-    if (!c->dbusproxy) {
+    PendingCall *call;
+
+    if (c->dbusproxy) {
+        g_dbus_proxy_call(c->dbusproxy, method, param, G_DBUS_CALL_FLAGS_NONE, -1, NULL, callback, c);
+        return;
+    }
+
+    /* Keep the call until the page of the client is connected. */
+    if (!c->dbuscalls) {
+        c->dbuscalls = g_queue_new();
+    }
+    if (g_queue_get_length(c->dbuscalls) >= EXT_PROXY_QUEUE_SIZE) {
+        g_warning("Dropped dbus method %s: web extension not connected", method);
+        g_variant_unref(g_variant_ref_sink(param));
+        metrics.dropped++;
         return;
     }
-    g_dbus_proxy_call(c->dbusproxy, method, param, G_DBUS_CALL_FLAGS_NONE, -1, NULL, callback, c);
+    call           = g_slice_new(PendingCall);
+    call->method   = g_strdup(method);
+    call->param    = g_variant_ref_sink(param);
+    call->callback = callback;
+    g_queue_push_tail(c->dbuscalls, call);
+    metrics.queued++;
 }
 
 /**
@@ -314,18 +496,144 @@ static void on_web_extension_page_created(GDBusConnection *connection,
     guint64 pageid;
 
     g_variant_get(parameters, "(t)", &pageid);
+    trace_instant("web_extension_page_created");
 
     /* Search for the client with the same page id as returned by the
      * webextension. */
     c = vb_get_client_for_page_id(pageid);
     if (c) {
-        /* Set the dbus proxy on the right client based on page id. */
-        c->dbusproxy = (GDBusProxy*)data;
-
-        /* Subscribe to dbus signals here. */
-        g_dbus_connection_signal_subscribe(connection, NULL,
-                VB_WEBEXTENSION_INTERFACE, "VerticalScroll",
-                VB_WEBEXTENSION_OBJECT_PATH, NULL, G_DBUS_SIGNAL_FLAGS_NONE,
-                (GDBusSignalCallback)on_vertical_scroll, NULL, NULL);
+        set_client_proxy(c, (GDBusProxy*)data);
+    } else {
+        /* Keep the proxy until a client takes the prepared webview. */
+        if (!pending_proxies) {
+            pending_proxies = g_hash_table_new_full(g_int64_hash,
+                    g_int64_equal, g_free, NULL);
+        }
+        g_hash_table_insert(pending_proxies, g_memdup(&pageid, sizeof(guint64)), data);
+    }
+}
+
+/**
+ * Drops the calls of the client that wait for the web extension.
+ */
+void ext_proxy_client_cleanup(Client *c)
+{
+    if (c->dbuscalls) {
+        g_queue_free_full(c->dbuscalls, pending_call_free);
+        c->dbuscalls = NULL;
+    }
+    /* The page may have been announced after the client was unregistered. */
+    ext_proxy_page_destroyed(c->page_id);
+}
+
+/**
+ * Forgets the web extension of the client after its web process has gone.
+ * Calls made in the meantime are queued until the page of the new web
+ * process is connected.
+ */
+void ext_proxy_client_disconnect(Client *c)
+{
+    c->dbusproxy = NULL;
+    c->dbuswait  = g_get_monotonic_time();
+}
+
+/**
+ * Returns newly allocated text of the time windows waited for the web
+ * extension of their page and of the calls made in the meantime.
+ */
+char *ext_proxy_get_status(void)
+{
+    return g_strdup_printf("-- Web extension --\n"
+            "connected %u windows in %.1f ms on average, %.1f ms at most\n"
+            "queued %u calls before the connection, dropped %u calls",
+            metrics.count,
+            metrics.count ? metrics.total / 1000.0 / metrics.count : 0.0,
+            metrics.max / 1000.0,
+            metrics.queued, metrics.dropped);
+}
+
+/**
+ * Connects the client to the web extension if the page of its webview was
+ * already created before the webview was bound to the client.
+ */
+void ext_proxy_connect_client(Client *c)
+{
+    GDBusProxy *proxy;
+
+    c->dbuswait = g_get_monotonic_time();
+    if (!pending_proxies) {
+        return;
+    }
+    proxy = g_hash_table_lookup(pending_proxies, &c->page_id);
+    if (proxy) {
+        set_client_proxy(c, proxy);
+        g_hash_table_remove(pending_proxies, &c->page_id);
+    }
+}
+
+/**
+ * Drops the proxy kept for the page of a webview that is destroyed before a
+ * client took it.
+ */
+void ext_proxy_page_destroyed(guint64 page_id)
+{
+    if (pending_proxies) {
+        g_hash_table_remove(pending_proxies, &page_id);
+    }
+}
+
+/**
+ * Set the dbus proxy on the client and send the calls made before.
+ */
+static void set_client_proxy(Client *c, GDBusProxy *proxy)
+{
+    PendingCall *call;
+    gint64 now, wait;
+
+    c->dbusproxy = proxy;
+
+    if (c->dbuswait) {
+        now  = g_get_monotonic_time();
+        wait = now - c->dbuswait;
+        trace_add("web_extension_handshake", c->dbuswait, now);
+        metrics.count++;
+        metrics.total += wait;
+        metrics.max    = MAX(metrics.max, wait);
+        c->dbuswait    = 0;
+    }
+
+    /* Send the calls made so far in their order. */
+    while (c->dbuscalls && (call = g_queue_pop_head(c->dbuscalls))) {
+        g_dbus_proxy_call(proxy, call->method, call->param,
+                G_DBUS_CALL_FLAGS_NONE, -1, NULL, call->callback, c);
+        pending_call_free(call);
+    }
+}
+
+static void pending_call_free(gpointer data)
+{
+    PendingCall *call = (PendingCall*)data;
+
+    g_free(call->method);
+    g_variant_unref(call->param);
+    g_slice_free(PendingCall, call);
+}
+
+static void on_search(GDBusProxy *proxy, GAsyncResult *result, Client *c)
+{
+    GVariant *return_value;
+    guint count;
+
+    return_value = g_dbus_proxy_call_finish(proxy, result, NULL);
+    if (!return_value) {
+        return;
+    }
+    g_variant_get(return_value, "(u)", &count);
+    g_variant_unref(return_value);
+
+    /* The search may have been stopped while the page was searched. */
+    if (c->state.search.active) {
+        c->state.search.matches = count;
+        vb_statusbar_invalidate(c, STATUS_DIRTY(STATUS_SEARCH));
     }
 }
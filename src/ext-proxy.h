@@ -21,14 +21,29 @@
 #define _EXT_PROXY_H
 
 #include "main.h"
+#include "webextension/ext-main.h"
 
 const char *ext_proxy_init(void);
+void ext_proxy_connect_client(Client *c);
+void ext_proxy_page_destroyed(guint64 page_id);
+void ext_proxy_client_cleanup(Client *c);
+void ext_proxy_client_disconnect(Client *c);
+char *ext_proxy_get_status(void);
 void ext_proxy_eval_script(Client *c, char *js, GAsyncReadyCallback callback);
 GVariant *ext_proxy_eval_script_sync(Client *c, char *js);
+void ext_proxy_call_js(Client *c, ExtJsFunction func, GVariant *args,
+        GAsyncReadyCallback callback);
+GVariant *ext_proxy_call_js_sync(Client *c, ExtJsFunction func, GVariant *args);
+pid_t ext_proxy_get_pid(Client *c);
 void ext_proxy_focus_input(Client *c);
+void ext_proxy_scroll(Client *c, char mode, int step, int count);
+void ext_proxy_search(Client *c, const char *query, ExtSearchFlags flags, int step);
 void ext_proxy_set_header(Client *c, const char *headers);
-void ext_proxy_lock_input(Client *c, const char *element_id);
-void ext_proxy_unlock_input(Client *c, const char *element_id);
+void ext_proxy_get_editable_state(Client *c, GAsyncReadyCallback callback,
+        gpointer data);
+gboolean ext_proxy_get_editable_state_finish(GDBusProxy *proxy, GAsyncResult *result,
+        guint *key, int *fd);
+void ext_proxy_set_editable_value(Client *c, guint key, int fd);
 char *ext_proxy_get_current_selection(Client *c);
 
 #endif /* end of include guard: _EXT_PROXY_H */
@@ -0,0 +1,355 @@
+/**
+ * vimb - a webkit based vim like browser.
+ *
+ * Copyright (C) 2012-2018 Daniel Carl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+#include <gio/gio.h>
+#include <string.h>
+
+#include "completion.h"
+#include "config.h"
+#include "file-completion.h"
+#include "main.h"
+#include "util.h"
+
+/* Entries of a directory, those of subdirectories end in '/'. */
+typedef struct {
+    GPtrArray   *names;
+    guint64     mtime;      /* modification time in microseconds */
+    gint64      used;       /* monotonic time of the last use */
+} DirListing;
+
+/* A completion of the files of a directory that is in progress. */
+typedef struct {
+    Client                  *c;
+    GCancellable            *cancellable;
+    GtkListStore            *store;
+    CompletionSelectFunc    selfunc;
+    gboolean                back;
+    gboolean                shown;      /* the completion was created */
+    char                    *input;     /* inputbox content it was started for */
+    GFile                   *dir;
+    char                    *path;      /* expanded directory path */
+    char                    *prefix;    /* directory part of the input */
+    char                    *basename;  /* file part of the input to match */
+    DirListing              *listing;   /* listing that is read */
+} FileCompletion;
+
+static void on_dir_info(GObject *source, GAsyncResult *result, gpointer data);
+static void on_enumerate(GObject *source, GAsyncResult *result, gpointer data);
+static void on_next_files(GObject *source, GAsyncResult *result, gpointer data);
+static void add_matches(FileCompletion *fc, DirListing *listing, guint from);
+static void show(FileCompletion *fc, gboolean last);
+static void cache_listing(FileCompletion *fc);
+static void finish(FileCompletion *fc);
+static void dir_listing_free(gpointer data);
+
+static struct {
+    GHashTable  *jobs;      /* FileCompletion by client */
+    GHashTable  *cache;     /* DirListing by expanded directory path */
+} filecomp;
+
+
+/**
+ * Starts to complete the file path in input. The entries of the directory
+ * are read asynchronously and given to the completion in batches, so that
+ * large directories or slow mounts don't block the browser. Listings of
+ * directories are cached as long as the directories are not modified.
+ */
+void file_completion_start(Client *c, const char *input,
+        CompletionSelectFunc selfunc, gboolean back)
+{
+    FileCompletion *fc;
+    const char *last_slash, *basename;
+
+    file_completion_cancel(c);
+
+    if (!filecomp.jobs) {
+        filecomp.jobs  = g_hash_table_new(g_direct_hash, g_direct_equal);
+        filecomp.cache = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+                dir_listing_free);
+    }
+
+    last_slash = strrchr(input, '/');
+    basename   = last_slash ? last_slash + 1 : input;
+
+    fc              = g_slice_new0(FileCompletion);
+    fc->c           = c;
+    fc->cancellable = g_cancellable_new();
+    fc->store       = gtk_list_store_new(COMPLETION_STORE_NUM, G_TYPE_STRING, G_TYPE_STRING);
+    fc->selfunc     = selfunc;
+    fc->back        = back;
+    fc->input       = vb_input_get_text(c);
+    fc->prefix      = g_strndup(input, basename - input);
+    fc->basename    = g_strdup(basename);
+    fc->path        = util_expand(*fc->prefix ? fc->prefix : ".",
+            UTIL_EXP_TILDE|UTIL_EXP_DOLLAR);
+    fc->dir         = g_file_new_for_path(fc->path);
+    gtk_tree_sortable_set_sort_column_id(GTK_TREE_SORTABLE(fc->store),
+            COMPLETION_STORE_FIRST, GTK_SORT_ASCENDING);
+
+    g_hash_table_insert(filecomp.jobs, c, fc);
+
+    /* The modification time tells if a cached listing is still valid. */
+    g_file_query_info_async(fc->dir,
+            G_FILE_ATTRIBUTE_TIME_MODIFIED "," G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC,
+            G_FILE_QUERY_INFO_NONE, G_PRIORITY_DEFAULT, fc->cancellable,
+            on_dir_info, fc);
+}
+
+/**
+ * Stops the file completion of the client if there is one in progress. The
+ * job is freed by its pending callback.
+ */
+void file_completion_cancel(Client *c)
+{
+    FileCompletion *fc;
+
+    if (filecomp.jobs && (fc = g_hash_table_lookup(filecomp.jobs, c))) {
+        g_hash_table_remove(filecomp.jobs, c);
+        g_cancellable_cancel(fc->cancellable);
+    }
+}
+
+void file_completion_cleanup(void)
+{
+    if (filecomp.jobs) {
+        g_hash_table_destroy(filecomp.jobs);
+        filecomp.jobs = NULL;
+    }
+    if (filecomp.cache) {
+        g_hash_table_destroy(filecomp.cache);
+        filecomp.cache = NULL;
+    }
+}
+
+static void on_dir_info(GObject *source, GAsyncResult *result, gpointer data)
+{
+    FileCompletion *fc = (FileCompletion*)data;
+    GFileInfo *info;
+    GError *error = NULL;
+    DirListing *listing;
+    guint64 mtime;
+
+    /* The operations of a cancelled job fail with G_IO_ERROR_CANCELLED. */
+    info = g_file_query_info_finish(G_FILE(source), result, &error);
+    if (!info) {
+        /* Can't read the directory, likely bad user input */
+        g_error_free(error);
+        finish(fc);
+        return;
+    }
+    mtime = g_file_info_get_attribute_uint64(info, G_FILE_ATTRIBUTE_TIME_MODIFIED) * G_USEC_PER_SEC
+        + g_file_info_get_attribute_uint32(info, G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC);
+    g_object_unref(info);
+
+    listing = g_hash_table_lookup(filecomp.cache, fc->path);
+    if (listing && listing->mtime == mtime) {
+        listing->used = g_get_monotonic_time();
+        add_matches(fc, listing, 0);
+        show(fc, TRUE);
+        finish(fc);
+        return;
+    }
+
+    fc->listing        = g_slice_new0(DirListing);
+    fc->listing->names = g_ptr_array_new_with_free_func(g_free);
+    fc->listing->mtime = mtime;
+
+    /* Only name and type are requested, so that the type is taken from the
+     * directory entry where possible instead of a stat of each file. */
+    g_file_enumerate_children_async(fc->dir,
+            G_FILE_ATTRIBUTE_STANDARD_NAME "," G_FILE_ATTRIBUTE_STANDARD_TYPE,
+            G_FILE_QUERY_INFO_NONE, G_PRIORITY_DEFAULT, fc->cancellable,
+            on_enumerate, fc);
+}
+
+static void on_enumerate(GObject *source, GAsyncResult *result, gpointer data)
+{
+    FileCompletion *fc = (FileCompletion*)data;
+    GFileEnumerator *enumerator;
+    GError *error = NULL;
+
+    enumerator = g_file_enumerate_children_finish(G_FILE(source), result, &error);
+    if (!enumerator) {
+        g_error_free(error);
+        finish(fc);
+        return;
+    }
+    g_file_enumerator_next_files_async(enumerator, FILE_COMPLETION_BATCH_SIZE,
+            G_PRIORITY_DEFAULT, fc->cancellable, on_next_files, fc);
+}
+
+static void on_next_files(GObject *source, GAsyncResult *result, gpointer data)
+{
+    FileCompletion *fc = (FileCompletion*)data;
+    GFileEnumerator *enumerator = G_FILE_ENUMERATOR(source);
+    GFileInfo *info;
+    GError *error = NULL;
+    GList *files, *l;
+    guint from;
+
+    files = g_file_enumerator_next_files_finish(enumerator, result, &error);
+    if (error) {
+        /* Show what was read so far, but a partial listing is not cached. */
+        if (!g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+            show(fc, TRUE);
+        }
+        g_error_free(error);
+        g_object_unref(enumerator);
+        finish(fc);
+        return;
+    }
+
+    /* The last batch is empty. */
+    if (!files) {
+        g_object_unref(enumerator);
+        cache_listing(fc);
+        show(fc, TRUE);
+        finish(fc);
+        return;
+    }
+
+    from = fc->listing->names->len;
+    for (l = files; l; l = l->next) {
+        info = G_FILE_INFO(l->data);
+        g_ptr_array_add(fc->listing->names,
+                g_file_info_get_file_type(info) == G_FILE_TYPE_DIRECTORY
+                ? g_strconcat(g_file_info_get_name(info), "/", NULL)
+                : g_strdup(g_file_info_get_name(info)));
+    }
+    g_list_free_full(files, g_object_unref);
+
+    add_matches(fc, fc->listing, from);
+    show(fc, FALSE);
+
+    g_file_enumerator_next_files_async(enumerator, FILE_COMPLETION_BATCH_SIZE,
+            G_PRIORITY_DEFAULT, fc->cancellable, on_next_files, fc);
+}
+
+/**
+ * Adds the entries of the listing starting with the given index that match
+ * the input to the completion store.
+ */
+static void add_matches(FileCompletion *fc, DirListing *listing, guint from)
+{
+    GtkTreeIter iter;
+    const char *name;
+    char *value;
+    guint i;
+
+    for (i = from; i < listing->names->len; i++) {
+        name = g_ptr_array_index(listing->names, i);
+        if (g_str_has_prefix(name, fc->basename)) {
+            value = g_strconcat(fc->prefix, name, NULL);
+            gtk_list_store_insert_with_values(fc->store, &iter, -1,
+                    COMPLETION_STORE_FIRST, value, -1);
+            g_free(value);
+        }
+    }
+}
+
+/**
+ * Shows the completion once there is a choice or if the last batch was read.
+ * A single match is taken directly like for other completions, which is
+ * only known after the last batch.
+ */
+static void show(FileCompletion *fc, gboolean last)
+{
+    int rows;
+    char *input;
+
+    rows = gtk_tree_model_iter_n_children(GTK_TREE_MODEL(fc->store), NULL);
+    if (fc->shown) {
+        completion_update(fc->c);
+        return;
+    }
+    if (rows < 1 || (!last && rows < 2)) {
+        return;
+    }
+
+    /* Don't overwrite what was typed while the directory was read. */
+    input = vb_input_get_text(fc->c);
+    if (strcmp(input, fc->input)) {
+        g_free(input);
+        file_completion_cancel(fc->c);
+        return;
+    }
+    g_free(input);
+
+    fc->shown = TRUE;
+    completion_create(fc->c, GTK_TREE_MODEL(g_object_ref(fc->store)),
+            fc->selfunc, fc->back);
+}
+
+/**
+ * Puts the completely read listing into the cache. The least recently used
+ * listing is dropped if the cache is full.
+ */
+static void cache_listing(FileCompletion *fc)
+{
+    GHashTableIter iter;
+    DirListing *listing;
+    gpointer key, value, oldest = NULL;
+    gint64 oldest_used = G_MAXINT64;
+
+    if (g_hash_table_size(filecomp.cache) >= FILE_COMPLETION_CACHE_SIZE
+            && !g_hash_table_contains(filecomp.cache, fc->path)) {
+        g_hash_table_iter_init(&iter, filecomp.cache);
+        while (g_hash_table_iter_next(&iter, &key, &value)) {
+            listing = (DirListing*)value;
+            if (listing->used < oldest_used) {
+                oldest_used = listing->used;
+                oldest      = key;
+            }
+        }
+        g_hash_table_remove(filecomp.cache, oldest);
+    }
+
+    fc->listing->used = g_get_monotonic_time();
+    g_hash_table_replace(filecomp.cache, g_strdup(fc->path), fc->listing);
+    fc->listing = NULL;
+}
+
+/**
+ * Frees the job. It's removed from the running jobs if it's not cancelled.
+ */
+static void finish(FileCompletion *fc)
+{
+    if (filecomp.jobs && g_hash_table_lookup(filecomp.jobs, fc->c) == fc) {
+        g_hash_table_remove(filecomp.jobs, fc->c);
+    }
+    if (fc->listing) {
+        dir_listing_free(fc->listing);
+    }
+    g_object_unref(fc->cancellable);
+    g_object_unref(fc->store);
+    g_object_unref(fc->dir);
+    g_free(fc->input);
+    g_free(fc->prefix);
+    g_free(fc->basename);
+    g_free(fc->path);
+    g_slice_free(FileCompletion, fc);
+}
+
+static void dir_listing_free(gpointer data)
+{
+    DirListing *listing = (DirListing*)data;
+
+    g_ptr_array_unref(listing->names);
+    g_slice_free(DirListing, listing);
+}
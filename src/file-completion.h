@@ -0,0 +1,33 @@
+/**
+ * vimb - a webkit based vim like browser.
+ *
+ * Copyright (C) 2012-2018 Daniel Carl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+#ifndef _FILE_COMPLETION_H
+#define _FILE_COMPLETION_H
+
+#include <glib.h>
+
+#include "completion.h"
+#include "main.h"
+
+void file_completion_start(Client *c, const char *input,
+        CompletionSelectFunc selfunc, gboolean back);
+void file_completion_cancel(Client *c);
+void file_completion_cleanup(void);
+
+#endif /* end of include guard: _FILE_COMPLETION_H */
@@ -31,6 +31,7 @@
 #include "map.h"
 #include "normal.h"
 #include "ext-proxy.h"
+#include "setting.h"
 
 static struct {
     char           mode;      /* mode identifying char - that last char of the hint prompt */
@@ -45,7 +46,7 @@ static struct {
 
 extern struct Vimb vb;
 
-static gboolean call_hints_function(Client *c, const char *func, const char* args,
+static gboolean call_hints_function(Client *c, ExtJsFunction func, GVariant *args,
         gboolean sync);
 static void on_hint_function_finished(GDBusProxy *proxy, GAsyncResult *result,
         Client *c);
@@ -62,7 +63,8 @@ VbResult hints_keypress(Client *c, int key)
         return RESULT_COMPLETE;
     } else if (key == CTRL('H')) { /* backspace */
         fire_timeout(c, FALSE);
-        if (call_hints_function(c, "update", "null", TRUE)) {
+        if (call_hints_function(c, EXT_JS_HINTS_UPDATE,
+                    g_variant_new("(ms)", NULL), TRUE)) {
             return RESULT_COMPLETE;
         }
     } else if (key == KEY_TAB) {
@@ -82,7 +84,8 @@ VbResult hints_keypress(Client *c, int key)
     } else {
         fire_timeout(c, TRUE);
         /* try to handle the key by the javascript */
-        if (call_hints_function(c, "update", (char[]){'"', key, '"', '\0'}, TRUE)) {
+        if (call_hints_function(c, EXT_JS_HINTS_UPDATE,
+                    g_variant_new("(ms)", (char[]){key, '\0'}), TRUE)) {
             return RESULT_COMPLETE;
         }
     }
@@ -99,7 +102,7 @@ void hints_clear(Client *c)
 
         /* Run this sync else we would disable JavaScript before the hint is
          * fired. */
-        call_hints_function(c, "clear", "true", TRUE);
+        call_hints_function(c, EXT_JS_HINTS_CLEAR, g_variant_new("(b)", TRUE), TRUE);
 
         /* if open window was not allowed for JavaScript, restore this */
         WebKitSettings *setting = webkit_web_view_get_settings(c->webview);
@@ -114,8 +117,6 @@ void hints_clear(Client *c)
 
 void hints_create(Client *c, const char *input)
 {
-    char *jsargs;
-
     /* check if the input contains a valid hinting prompt */
     if (!hints_parse_prompt(input, &hints.mode, &hints.gmode)) {
         /* if input is not valid, clear possible previous hint mode */
@@ -138,6 +139,10 @@ void hints_create(Client *c, const char *input)
                 NULL);
 
         /* if window open is already allowed there's no need to allow it again */
+        if (!hints.allow_open_win || !hints.allow_javascript) {
+            /* the changes must not reach the settings of other clients */
+            setting = setting_webkit_settings(c);
+        }
         if (!hints.allow_open_win) {
             g_object_set(G_OBJECT(setting), "javascript-can-open-windows-automatically", TRUE, NULL);
         }
@@ -151,38 +156,34 @@ void hints_create(Client *c, const char *input)
 
         hints.promptlen = hints.gmode ? 3 : 2;
 
-        jsargs = g_strdup_printf("'%s', %s, %d, '%s', %s, %s",
+        call_hints_function(c, EXT_JS_HINTS_INIT, g_variant_new("(sbisbb)",
             (char[]){hints.mode, '\0'},
-            hints.gmode ? "true" : "false",
+            hints.gmode,
             MAXIMUM_HINTS,
-            GET_CHAR(c, "hint-keys"),
-            GET_BOOL(c, "hint-follow-last") ? "true" : "false",
-            GET_BOOL(c, "hint-keys-same-length") ? "true" : "false"
-        );
-
-        call_hints_function(c, "init", jsargs, FALSE);
-        g_free(jsargs);
+            GET_CHAR(c, SID_HINT_KEYS),
+            GET_BOOL(c, SID_HINT_FOLLOW_LAST),
+            GET_BOOL(c, SID_HINT_KEYS_SAME_LENGTH)
+        ), FALSE);
 
         /* if hinting is started there won't be any additional filter given and
          * we can go out of this function */
         return;
     }
 
-    if (GET_BOOL(c, "hint-match-element")) {
-        jsargs = g_strdup_printf("'%s'", *(input + hints.promptlen) ? input + hints.promptlen : "");
-        call_hints_function(c, "filter", jsargs, FALSE);
-        g_free(jsargs);
+    if (GET_BOOL(c, SID_HINT_MATCH_ELEMENT)) {
+        call_hints_function(c, EXT_JS_HINTS_FILTER,
+                g_variant_new("(s)", input + hints.promptlen), FALSE);
     }
 }
 
 void hints_focus_next(Client *c, const gboolean back)
 {
-    call_hints_function(c, "focus", back ? "true" : "false", FALSE);
+    call_hints_function(c, EXT_JS_HINTS_FOCUS, g_variant_new("(b)", back), FALSE);
 }
 
 void hints_fire(Client *c)
 {
-    call_hints_function(c, "fire", "", FALSE);
+    call_hints_function(c, EXT_JS_HINTS_FIRE, NULL, FALSE);
 }
 
 void hints_follow_link(Client *c, const gboolean back, int count)
@@ -209,11 +210,7 @@ void hints_follow_link(Client *c, const gboolean back, int count)
 
 void hints_increment_uri(Client *c, int count)
 {
-    char *jsargs;
-
-    jsargs = g_strdup_printf("%d", count);
-    call_hints_function(c, "incrementUri", jsargs, FALSE);
-    g_free(jsargs);
+    ext_proxy_call_js(c, EXT_JS_INCREMENT_URI_NUMBER, g_variant_new("(i)", count), NULL);
 }
 
 /**
@@ -275,22 +272,19 @@ gboolean hints_parse_prompt(const char *prompt, char *mode, gboolean *is_gmode)
     return res;
 }
 
-static gboolean call_hints_function(Client *c, const char *func, const char* args,
+static gboolean call_hints_function(Client *c, ExtJsFunction func, GVariant *args,
         gboolean sync)
 {
-    char *jscode;
     /* Default value is only return in case of async call. */
     gboolean success = TRUE;
 
-    jscode = g_strdup_printf("hints.%s(%s);", func, args);
     if (sync) {
         GVariant *result;
-        result  = ext_proxy_eval_script_sync(c, jscode);
+        result  = ext_proxy_call_js_sync(c, func, args);
         success = hint_function_check_result(c, result);
     } else {
-        ext_proxy_eval_script(c, jscode, (GAsyncReadyCallback)on_hint_function_finished);
+        ext_proxy_call_js(c, func, args, (GAsyncReadyCallback)on_hint_function_finished);
     }
-    g_free(jscode);
 
     return success;
 }
@@ -387,7 +381,7 @@ static gboolean hint_function_check_result(Client *c, GVariant *return_value)
                 break;
 
             case 'x':
-                map_handle_string(c, GET_CHAR(c, "x-hint-command"), TRUE);
+                map_handle_string(c, GET_CHAR(c, SID_X_HINT_COMMAND), TRUE);
                 break;
 
             case 'y':
@@ -425,7 +419,7 @@ static void fire_timeout(Client *c, gboolean on)
     }
 
     if (on) {
-        millis = GET_INT(c, "hint-timeout");
+        millis = GET_INT(c, SID_HINT_TIMEOUT);
         if (millis) {
             hints.timeout_id = g_timeout_add(millis, (GSourceFunc)fire_cb, c);
         }
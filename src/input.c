@@ -17,9 +17,14 @@
  * along with this program. If not, see http://www.gnu.org/licenses/.
  */
 
+#include <fcntl.h>
+#include <gio/gunixinputstream.h>
+#include <gio/gunixoutputstream.h>
 #include <glib.h>
+#include <glib-unix.h>
 #include <glib/gstdio.h>
 #include <string.h>
+#include <unistd.h>
 
 #include "ascii.h"
 #include "command.h"
@@ -27,16 +32,20 @@
 #include "input.h"
 #include "main.h"
 #include "normal.h"
-#include "util.h"
-#include "scripts/scripts.h"
 #include "ext-proxy.h"
 
 typedef struct {
-    char   *element_id;
-    unsigned long element_map_key;
+    Client *c;
+    guint  key;     /* key of the element in the web extension */
 } ElementEditorData;
 
+static void on_editable_state(GDBusProxy *proxy, GAsyncResult *result,
+        Client *c);
+static void on_editable_value_read(GObject *stream, GAsyncResult *result,
+        gpointer data);
 static void input_editor_formfiller(const char *text, Client *c, gpointer data);
+static void on_editable_value_written(GObject *stream, GAsyncResult *result,
+        gpointer text);
 
 /**
  * Function called when vimb enters the input mode.
@@ -107,86 +116,125 @@ VbResult input_keypress(Client *c, int key)
     return RESULT_ERROR;
 }
 
+/**
+ * Opens the value of the focused editable element in the editor. The value
+ * is requested asynchronously and the editor is started once it's received.
+ */
 VbResult input_open_editor(Client *c)
 {
-    static unsigned long element_map_key = 0;
-    char *element_id = NULL;
-    char *text = NULL, *id = NULL;
-    gboolean success;
-    GVariant *jsreturn;
-    GVariant *idreturn;
-    ElementEditorData *data = NULL;
-
     g_assert(c);
 
-    /* get the selected input element */
-    jsreturn = ext_proxy_eval_script_sync(c, "vimb_input_mode_element.value");
-    g_variant_get(jsreturn, "(bs)", &success, &text);
-
-    if (!success || !text) {
+    if (!c->dbusproxy) {
         return RESULT_ERROR;
     }
+    ext_proxy_get_editable_state(c, (GAsyncReadyCallback)on_editable_state, c);
 
-    idreturn = ext_proxy_eval_script_sync(c, "vimb_input_mode_element.id");
-    g_variant_get(idreturn, "(bs)", &success, &id);
+    return RESULT_COMPLETE;
+}
 
-    /* Special case: the input element does not have an id assigned to it */
-    if (!success || !*id) {
-        char *js_command = g_strdup_printf(JS_SET_EDITOR_MAP_ELEMENT, ++element_map_key);
-        ext_proxy_eval_script(c, js_command, NULL);
-        g_free(js_command);
-    } else {
-        element_id = g_strdup(id);
+static void on_editable_state(GDBusProxy *proxy, GAsyncResult *result,
+        Client *c)
+{
+    ElementEditorData *eed;
+    GInputStream *in;
+    GOutputStream *out;
+    guint key;
+    int fd;
+
+    if (!ext_proxy_get_editable_state_finish(proxy, result, &key, &fd)) {
+        return;
+    }
+    if (fd == -1) {
+        /* Enable the element again, it's kept locked else. */
+        ext_proxy_set_editable_value(c, key, -1);
+        return;
     }
 
-    data                    = g_slice_new0(ElementEditorData);
-    data->element_id        = element_id;
-    data->element_map_key   = element_map_key;
+    eed      = g_slice_new0(ElementEditorData);
+    eed->c   = c;
+    eed->key = key;
 
-    if (command_spawn_editor(c, &((Arg){0, text}), input_editor_formfiller, data)) {
-        /* disable the active element */
-        ext_proxy_lock_input(c, element_id);
+    /* Read the value without blocking the UI, it may be large. */
+    in  = g_unix_input_stream_new(fd, TRUE);
+    out = g_memory_output_stream_new_resizable();
+    g_output_stream_splice_async(out, in, G_OUTPUT_STREAM_SPLICE_CLOSE_SOURCE,
+            G_PRIORITY_DEFAULT, c->cancellable, on_editable_value_read, eed);
+    g_object_unref(in);
+}
 
-        return RESULT_COMPLETE;
+static void on_editable_value_read(GObject *stream, GAsyncResult *result,
+        gpointer data)
+{
+    ElementEditorData *eed = (ElementEditorData *)data;
+    GError *error = NULL;
+    char *text;
+
+    if (g_output_stream_splice_finish(G_OUTPUT_STREAM(stream), result, &error) == -1) {
+        /* The client is gone if the read was cancelled. */
+        if (!g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+            g_warning("Could not read editable value: %s", error->message);
+            ext_proxy_set_editable_value(eed->c, eed->key, -1);
+        }
+        g_error_free(error);
+        g_object_unref(stream);
+        g_slice_free(ElementEditorData, eed);
+        return;
     }
 
-    g_free(element_id);
-    g_slice_free(ElementEditorData, data);
-    return RESULT_ERROR;
+    /* Terminate the received text to use it as string. */
+    g_output_stream_write_all(G_OUTPUT_STREAM(stream), "", 1, NULL, NULL, NULL);
+    g_output_stream_close(G_OUTPUT_STREAM(stream), NULL, NULL);
+    text = g_memory_output_stream_steal_data(G_MEMORY_OUTPUT_STREAM(stream));
+    g_object_unref(stream);
+
+    if (!command_spawn_editor(eed->c, &((Arg){0, text}), input_editor_formfiller, eed)) {
+        /* enable the element again */
+        ext_proxy_set_editable_value(eed->c, eed->key, -1);
+        g_slice_free(ElementEditorData, eed);
+    }
+    g_free(text);
 }
 
 static void input_editor_formfiller(const char *text, Client *c, gpointer data)
 {
-    char *escaped;
-    char *jscode;
-    char *jscode_enable;
     ElementEditorData *eed = (ElementEditorData *)data;
-
-    if (text) {
-        escaped = util_strescape(text, NULL);
-
-        /* put the text back into the element */
-        if (eed->element_id && strlen(eed->element_id) > 0) {
-            jscode = g_strdup_printf("document.getElementById(\"%s\").value=\"%s\"", eed->element_id, escaped);
-        } else {
-            jscode = g_strdup_printf("vimb_editor_map.get(\"%lu\").value=\"%s\"", eed->element_map_key, escaped);
-        }
-
-        ext_proxy_eval_script(c, jscode, NULL);
-
-        g_free(jscode);
-        g_free(escaped);
+    GOutputStream *stream;
+    GError *error = NULL;
+    char *value;
+    int fds[2];
+
+    if (!text) {
+        ext_proxy_set_editable_value(c, eed->key, -1);
+        g_slice_free(ElementEditorData, eed);
+        return;
     }
 
-    if (eed->element_id && strlen(eed->element_id) > 0) {
-        ext_proxy_unlock_input(c, eed->element_id);
-    } else {
-        jscode_enable = g_strdup_printf(JS_FOCUS_EDITOR_MAP_ELEMENT,
-                eed->element_map_key, eed->element_map_key);
-        ext_proxy_eval_script(c, jscode_enable, NULL);
-        g_free(jscode_enable);
+    if (!g_unix_open_pipe(fds, FD_CLOEXEC, &error)
+            || !g_unix_set_fd_nonblocking(fds[1], TRUE, &error)) {
+        g_warning("Could not pass editor text: %s", error->message);
+        g_error_free(error);
+        ext_proxy_set_editable_value(c, eed->key, -1);
+        g_slice_free(ElementEditorData, eed);
+        return;
     }
 
-    g_free(eed->element_id);
+    /* Put the text back into the element. It's written into the pipe while
+     * the web extension reads it. */
+    stream = g_unix_output_stream_new(fds[1], TRUE);
+    value  = g_strdup(text);
+    g_output_stream_write_all_async(stream, value, strlen(value),
+            G_PRIORITY_DEFAULT, NULL, on_editable_value_written, value);
+
+    ext_proxy_set_editable_value(c, eed->key, fds[0]);
+    close(fds[0]);
+
     g_slice_free(ElementEditorData, eed);
 }
+
+static void on_editable_value_written(GObject *stream, GAsyncResult *result,
+        gpointer text)
+{
+    g_output_stream_write_all_finish(G_OUTPUT_STREAM(stream), result, NULL, NULL);
+    g_object_unref(stream);
+    g_free(text);
+}
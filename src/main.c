@@ -40,8 +40,10 @@
 #include "autocmd.h"
 #include "command.h"
 #include "completion.h"
+#include "download.h"
 #include "ex.h"
 #include "ext-proxy.h"
+#include "file-completion.h"
 #include "file-storage.h"
 #include "handler.h"
 #include "history.h"
@@ -50,14 +52,27 @@
 #include "main.h"
 #include "map.h"
 #include "normal.h"
+#include "remote.h"
+#include "session.h"
 #include "setting.h"
 #include "shortcut.h"
+#include "suspend.h"
+#include "theme.h"
+#include "trace.h"
 #include "util.h"
-#define __USE_XOPEN2K
-#include "preference.h"
+#include "webview-pool.h"
+
+/* Key of the DownloadStat attached to each tracked WebKitDownload. */
+#define DOWNLOAD_STAT_KEY "vimb-download-stat"
+
+/* Parts of the window updated on the next frame by present_tick(). */
+enum {
+  PRESENT_TITLE = (1 << 0),
+  PRESENT_URLBAR = (1 << 1),
+};
 
 static void client_destroy(Client *c);
-static Client *client_new(WebKitWebView *webview);
+static Client *client_new(WebKitWebView *webview, const char *session_uri);
 static void client_show(WebKitWebView *webview, Client *c);
 static GtkWidget *create_window(Client *c);
 static gboolean input_clear(Client *c);
@@ -77,6 +92,10 @@ static gboolean on_webdownload_decide_destination(WebKitDownload *download,
                                                   Client *c);
 static void on_webdownload_response_received(WebKitDownload *download,
                                              GParamSpec *ps, Client *c);
+static void on_webdownload_response_native(WebKitDownload *download,
+                                           GParamSpec *ps, Client *c);
+static char *download_build_path(Client *c, const char *download_uri,
+                                 char *suggested_filename, const char *path);
 static void spawn_download_command(Client *c, WebKitURIResponse *response);
 static void on_webdownload_failed(WebKitDownload *download, GError *error,
                                   Client *c);
@@ -99,6 +118,10 @@ static void on_webview_load_changed(WebKitWebView *webview,
 static void on_webview_mouse_target_changed(WebKitWebView *webview,
                                             WebKitHitTestResult *result,
                                             guint modifiers, Client *c);
+static void on_webview_resource_load_started(WebKitWebView *webview,
+                                             WebKitWebResource *resource,
+                                             WebKitURIRequest *request,
+                                             Client *c);
 static void on_webview_notify_estimated_load_progress(WebKitWebView *webview,
                                                       GParamSpec *spec,
                                                       Client *c);
@@ -117,11 +140,23 @@ static gboolean on_webview_leave_fullscreen(WebKitWebView *webview, Client *c);
 static gboolean on_window_delete_event(GtkWidget *window, GdkEvent *event,
                                        Client *c);
 static void on_window_destroy(GtkWidget *window, Client *c);
+static gboolean on_window_focus_in(GtkWidget *window, GdkEvent *event,
+                                   Client *c);
+static gboolean on_window_focus_out(GtkWidget *window, GdkEvent *event,
+                                    Client *c);
+static gboolean session_load(Client *c);
 static gboolean quit(Client *c);
 static void read_from_stdin(Client *c);
 static void register_cleanup(Client *c);
+static void present_schedule(Client *c, guint parts);
+static gboolean present_tick(GtkWidget *widget, GdkFrameClock *clock,
+                             gpointer data);
+static gboolean present_timeout(gpointer data);
+static void present_update(Client *c);
+static const char *get_sanitized_uri(Client *c);
 static void update_title(Client *c);
 static void update_urlbar(Client *c);
+static void statusbar_set_left(Client *c, const char *text);
 static void set_statusbar_style(Client *c, StatusType type);
 static void set_title(Client *c, const char *title);
 static void spawn_new_instance(const char *uri);
@@ -130,8 +165,9 @@ static void vimb_cleanup(void);
 #endif
 static void vimb_setup(void);
 static WebKitWebView *webview_new(Client *c, WebKitWebView *webview);
-static void on_counted_matches(WebKitFindController *finder, guint count,
-                               Client *c);
+static void on_found_text(WebKitFindController *finder, guint count,
+                          Client *c);
+static void on_failed_to_find_text(WebKitFindController *finder, Client *c);
 static gboolean on_permission_request(WebKitWebView *webview,
                                       WebKitPermissionRequest *request,
                                       Client *c);
@@ -148,20 +184,16 @@ static gboolean autocmdOptionArgFunc(const gchar *option_name,
 struct Vimb vb;
 
 /**
- * Set the destination for a download according to suggested file name and
- * possible given path.
+ * Returns the newly allocated path to save a download of given uri to
+ * according to suggested file name and possible given path.
  */
-gboolean vb_download_set_destination(Client *c, WebKitDownload *download,
-                                     char *suggested_filename,
-                                     const char *path) {
-  char *download_path, *dir, *file, *uri, *basename = NULL, *decoded_uri = NULL;
-  const char *download_uri;
-  download_path = GET_CHAR(c, "download-path");
+static char *download_build_path(Client *c, const char *download_uri,
+                                 char *suggested_filename, const char *path) {
+  char *download_path, *dir, *file, *basename = NULL, *decoded_uri = NULL;
+  download_path = GET_CHAR(c, SID_DOWNLOAD_PATH);
 
   if (!suggested_filename || !*suggested_filename) {
     /* Try to find a matching name if there is no suggested filename. */
-    download_uri =
-        webkit_uri_request_get_uri(webkit_download_get_request(download));
     decoded_uri = soup_uri_decode(download_uri);
     basename = g_filename_display_basename(decoded_uri);
     g_free(decoded_uri);
@@ -186,7 +218,7 @@ gboolean vb_download_set_destination(Client *c, WebKitDownload *download,
   g_free(basename);
 
   if (!file) {
-    return FALSE;
+    return NULL;
   }
 
   /* If the filepath exists already insert numerical suffix before file
@@ -226,6 +258,25 @@ gboolean vb_download_set_destination(Client *c, WebKitDownload *download,
     g_string_free(tmp, TRUE);
   }
 
+  return file;
+}
+
+/**
+ * Set the destination for a download according to suggested file name and
+ * possible given path.
+ */
+gboolean vb_download_set_destination(Client *c, WebKitDownload *download,
+                                     char *suggested_filename,
+                                     const char *path) {
+  char *file, *uri;
+
+  file = download_build_path(
+      c, webkit_uri_request_get_uri(webkit_download_get_request(download)),
+      suggested_filename, path);
+  if (!file) {
+    return FALSE;
+  }
+
   /* Build URI from filepath. */
   uri = g_filename_to_uri(file, NULL, NULL);
   g_free(file);
@@ -339,15 +390,7 @@ void vb_enter_prompt(Client *c, char id, const char *prompt,
  * Returns the client for given page id.
  */
 Client *vb_get_client_for_page_id(guint64 pageid) {
-  Client *c;
-  /* Search for the client with the same page id. */
-  for (c = vb.clients; c && c->page_id != pageid; c = c->next)
-    ;
-
-  if (c) {
-    return c;
-  }
-  return NULL;
+  return vb.pages ? g_hash_table_lookup(vb.pages, &pageid) : NULL;
 }
 
 /**
@@ -404,7 +447,7 @@ gboolean vb_load_uri(Client *c, const Arg *arg) {
     path = g_strstrip(arg->s);
   }
   if (!path || !*path) {
-    path = GET_CHAR(c, "home-page");
+    path = GET_CHAR(c, SID_HOME_PAGE);
   }
 
   /* If path contains :// but no space we open it direct. This is required
@@ -434,7 +477,7 @@ gboolean vb_load_uri(Client *c, const Arg *arg) {
   } else if (arg->i == TARGET_NEW) {
     spawn_new_instance(uri);
   } else { /* TARGET_RELATED */
-    Client *newclient = client_new(c->webview);
+    Client *newclient = client_new(c->webview, NULL);
     /* Load the uri into the new client. */
     webkit_web_view_load_uri(newclient->webview, uri);
     set_title(c, uri);
@@ -444,6 +487,52 @@ gboolean vb_load_uri(Client *c, const Arg *arg) {
   return TRUE;
 }
 
+/**
+ * Opens a new window in the current instance, runs given ex commands in it
+ * and loads the uri or the home-page if uri is NULL.
+ */
+Client *vb_window_open(const char *uri, GSList *cmds) {
+  Client *c;
+  char *path;
+
+  c = client_new(NULL, NULL);
+  client_show(NULL, c);
+
+  for (GSList *l = cmds; l; l = l->next) {
+    ex_run_string(c, l->data, false);
+  }
+  /* vb_load_uri modifies the given string so hand over a copy. */
+  path = g_strdup(uri);
+  vb_load_uri(c, &(Arg){TARGET_CURRENT, path});
+  g_free(path);
+
+  if (GTK_IS_WINDOW(c->window)) {
+    gtk_window_present(GTK_WINDOW(c->window));
+  }
+
+  return c;
+}
+
+/**
+ * Opens a window of a saved session. The uri is not loaded before the window
+ * gets the focus, so that restoring many windows does not start all their
+ * pages at once.
+ */
+Client *vb_window_restore(const char *uri, const char *title, GSList *cmds) {
+  Client *c;
+
+  c = client_new(NULL, uri);
+  client_show(NULL, c);
+
+  for (GSList *l = cmds; l; l = l->next) {
+    ex_run_string(c, l->data, false);
+  }
+  /* Show which page the window holds until it's loaded. */
+  set_title(c, title && *title ? title : uri);
+
+  return c;
+}
+
 /**
  * Creates and add a new mode with given callback functions.
  */
@@ -517,7 +606,7 @@ void vb_modelabel_update(Client *c, const char *label) {
  */
 gboolean vb_quit(Client *c, gboolean force) {
   /* if not forced quit - don't quit if there are still running downloads */
-  if (!force && c->state.downloads) {
+  if (!force && c->state.downloads.active) {
     vb_echo_force(
         c, MSG_ERROR, TRUE,
         "Can't quit: there are running downloads. Use :q! to force quit");
@@ -548,6 +637,7 @@ void vb_register_add(Client *c, char buf, const char *value) {
     idx = mark - REG_CHARS;
 
     OVERWRITE_STRING(c->state.reg[idx], value);
+    session_schedule();
   }
 }
 
@@ -569,107 +659,175 @@ const char *vb_register_get(Client *c, char buf) {
   return NULL;
 }
 
-static void statusbar_update_downloads(Client *c, GString *status) {
-  GList *list;
-  guint list_length, remaining_max = 0;
-  gdouble progress, elapsed, total, remaining;
-  WebKitDownload *download;
+static void statusbar_render_downloads(Client *c, GString *status) {
+  DownloadTracker *t = &c->state.downloads;
+  char *speed;
 
   g_assert(c);
   g_assert(status);
 
-  if (c->state.downloads) {
-    list_length = g_list_length(c->state.downloads);
-    g_assert(list_length);
+  if (t->active) {
+    speed = g_format_size((guint64)t->speed);
+    g_string_append_printf(status, " %u %s (%s/s ETA %us)", t->active,
+                           t->active == 1 ? "dnld" : "dnlds", speed,
+                           download_tracker_get_eta(t));
+    g_free(speed);
+  }
+}
 
-    /* get highest ETA value of all downloads based on each download's
-     * current progress fraction and time elapsed */
-    for (list = c->state.downloads; list != NULL; list = list->next) {
-      download = (WebKitDownload *)list->data;
-      g_assert(download);
+/**
+ * Renders the text of a single field of the right side of the statusbar.
+ */
+static void statusbar_render_field(Client *c, StatusField field,
+                                   GString *status) {
+  switch (field) {
+  case STATUS_SEARCH:
+    /* show the number of matches search results */
+    if (c->state.search.matches) {
+      g_string_append_printf(status, " (%d)", c->state.search.matches);
+    }
+    break;
 
-      progress = webkit_download_get_estimated_progress(download);
+  case STATUS_PROGRESS:
+    /* show load status of page */
+    if (c->state.progress != 100) {
+#ifdef FEATURE_WGET_PROGRESS_BAR
+      char bar[PROGRESS_BAR_LEN + 1];
+      int i, state;
 
-      /* avoid dividing by zero */
-      if (progress == 0.0) {
-        continue;
+      state = c->state.progress * PROGRESS_BAR_LEN / 100;
+      for (i = 0; i < state; i++) {
+        bar[i] = PROGRESS_BAR[0];
       }
+      bar[i++] = PROGRESS_BAR[1];
+      for (; i < PROGRESS_BAR_LEN; i++) {
+        bar[i] = PROGRESS_BAR[2];
+      }
+      bar[i] = '\0';
+      g_string_append_printf(status, " [%s]", bar);
+#else
+      g_string_append_printf(status, " [%i%%]", c->state.progress);
+#endif
+    }
+    break;
+
+  case STATUS_DOWNLOADS:
+    statusbar_render_downloads(c, status);
+    break;
+
+  case STATUS_SETTINGS:
+#ifdef STATUS_VARAIBLE_SHOW
+    if (c->config.statusbar_show_settings) {
+      g_string_append_printf(status, STATUS_VARAIBLE_SHOW);
+    }
+#endif
+    break;
 
-      elapsed = webkit_download_get_elapsed_time(download);
-      total = (1.0 / progress) * elapsed;
-      remaining = total - elapsed;
+  case STATUS_SCROLL:
+    /* These architectures have different kinds of issues with scroll
+     * percentage, this is a somewhat clean fix that doesn't affect others.  */
+#if defined(_ARCH_PPC64) || defined(_ARCH_PPC) | defined(_ARCH_ARM)
+    /* force the scroll percent to be 16-bit */
+    c->state.scroll_percent = *(guint16 *)(&c->state.scroll_percent);
+#endif
 
-      remaining_max = MAX(remaining, remaining_max);
+    /* show the scroll status */
+    if (c->state.scroll_max == 0) {
+      g_string_append(status, " All");
+    } else if (c->state.scroll_percent == 0) {
+      g_string_append(status, " Top");
+    } else if (c->state.scroll_percent == 100) {
+      g_string_append(status, " Bot");
+    } else {
+      g_string_append_printf(status, " %d%%", c->state.scroll_percent);
     }
+    break;
 
-    g_string_append_printf(status, " %d %s (ETA %us)", list_length,
-                           list_length == 1 ? "dnld" : "dnlds", remaining_max);
+  default:
+    break;
   }
 }
 
-void vb_statusbar_update(Client *c) {
+/**
+ * Idle callback that renders the dirty fields of the statusbar and updates
+ * the label if the resulting text changed.
+ */
+static gboolean statusbar_render(gpointer data) {
+  Client *c = (Client *)data;
   GString *status;
+  int i;
 
+  c->statusbar.render_id = 0;
+
+  /* Keep the fields dirty until the statusbar is shown again. */
   if (!gtk_widget_get_visible(GTK_WIDGET(c->statusbar.box))) {
-    return;
+    return G_SOURCE_REMOVE;
   }
 
   status = g_string_new("");
-
-  /* show the number of matches search results */
-  if (c->state.search.matches) {
-    g_string_append_printf(status, " (%d)", c->state.search.matches);
+  for (i = 0; i < STATUS_FIELD_LAST; i++) {
+    if (c->statusbar.dirty & STATUS_DIRTY(i)) {
+      g_string_truncate(status, 0);
+      statusbar_render_field(c, i, status);
+      g_free(c->statusbar.fields[i]);
+      c->statusbar.fields[i] = g_strdup(status->str);
+    }
   }
+  c->statusbar.dirty = 0;
 
-  /* show load status of page or the downloads */
-  if (c->state.progress != 100) {
-#ifdef FEATURE_WGET_PROGRESS_BAR
-    char bar[PROGRESS_BAR_LEN + 1];
-    int i, state;
-
-    state = c->state.progress * PROGRESS_BAR_LEN / 100;
-    for (i = 0; i < state; i++) {
-      bar[i] = PROGRESS_BAR[0];
+  g_string_truncate(status, 0);
+  for (i = 0; i < STATUS_FIELD_LAST; i++) {
+    if (c->statusbar.fields[i]) {
+      g_string_append(status, c->statusbar.fields[i]);
     }
-    bar[i++] = PROGRESS_BAR[1];
-    for (; i < PROGRESS_BAR_LEN; i++) {
-      bar[i] = PROGRESS_BAR[2];
-    }
-    bar[i] = '\0';
-    g_string_append_printf(status, " [%s]", bar);
-#else
-    g_string_append_printf(status, " [%i%%]", c->state.progress);
-#endif
   }
 
-  statusbar_update_downloads(c, status);
+  /* Avoid the relayout of the statusbar if nothing visible changed. */
+  if (g_strcmp0(status->str, c->statusbar.text)) {
+    gtk_label_set_text(GTK_LABEL(c->statusbar.right), status->str);
+    g_free(c->statusbar.text);
+    c->statusbar.text = g_string_free(status, FALSE);
+  } else {
+    g_string_free(status, TRUE);
+  }
 
-  /* These architectures have different kinds of issues with scroll
-   * percentage, this is a somewhat clean fix that doesn't affect others.  */
-#if defined(_ARCH_PPC64) || defined(_ARCH_PPC) | defined(_ARCH_ARM)
-  /* force the scroll percent to be 16-bit */
-  c->state.scroll_percent = *(guint16 *)(&c->state.scroll_percent);
-#endif
+  return G_SOURCE_REMOVE;
+}
 
-#ifdef STATUS_VARAIBLE_SHOW
-  if (c->config.statusbar_show_settings) {
-    g_string_append_printf(status, STATUS_VARAIBLE_SHOW);
+static void statusbar_cleanup(Client *c) {
+  int i;
+
+  if (c->statusbar.render_id) {
+    g_source_remove(c->statusbar.render_id);
+    c->statusbar.render_id = 0;
   }
-#endif
+  for (i = 0; i < STATUS_FIELD_LAST; i++) {
+    g_free(c->statusbar.fields[i]);
+    c->statusbar.fields[i] = NULL;
+  }
+  g_free(c->statusbar.text);
+  c->statusbar.text = NULL;
+  g_free(c->statusbar.left_text);
+  c->statusbar.left_text = NULL;
+}
 
-  /* show the scroll status */
-  if (c->state.scroll_max == 0) {
-    g_string_append(status, " All");
-  } else if (c->state.scroll_percent == 0) {
-    g_string_append(status, " Top");
-  } else if (c->state.scroll_percent == 100) {
-    g_string_append(status, " Bot");
-  } else {
-    g_string_append_printf(status, " %d%%", c->state.scroll_percent);
+/**
+ * Marks the given fields of the statusbar as changed. The statusbar is
+ * rendered at most once per frame right before gtk redraws the window.
+ */
+void vb_statusbar_invalidate(Client *c, guint fields) {
+  c->statusbar.dirty |= fields;
+  if (!c->statusbar.render_id) {
+    c->statusbar.render_id = g_idle_add_full(GDK_PRIORITY_REDRAW - 10,
+                                             statusbar_render, c, NULL);
   }
+}
 
-  gtk_label_set_text(GTK_LABEL(c->statusbar.right), status->str);
-  g_string_free(status, TRUE);
+/**
+ * Marks all fields of the statusbar as changed.
+ */
+void vb_statusbar_update(Client *c) {
+  vb_statusbar_invalidate(c, STATUS_DIRTY_ALL);
 }
 
 /**
@@ -698,7 +856,7 @@ void vb_statusbar_show_hover_url(Client *c, VbLinkType type, const char *uri) {
 
   sanitized_uri = util_sanitize_uri(uri);
   msg = g_strconcat(type_label, uri, NULL);
-  gtk_label_set_text(GTK_LABEL(c->statusbar.left), msg);
+  statusbar_set_left(c, msg);
   g_free(msg);
   g_free(sanitized_uri);
 }
@@ -719,6 +877,8 @@ static void client_destroy(Client *c) {
                            vb.config.closed_max);
   }
 
+  session_client_closed(c);
+
   gtk_widget_destroy(c->window);
 
   /* Look for the client in the list, if we searched through the list and
@@ -730,15 +890,37 @@ static void client_destroy(Client *c) {
   } else {
     vb.clients = c->next;
   }
+  if (vb_get_client_for_page_id(c->page_id) == c) {
+    g_hash_table_remove(vb.pages, &c->page_id);
+  }
 
   if (c->state.search.last_query) {
     g_free(c->state.search.last_query);
   }
+  /* The tick callback was removed together with the window. */
+  if (c->state.present.timeout_id) {
+    g_source_remove(c->state.present.timeout_id);
+  }
+  g_free(c->state.present.title);
+  g_free(c->state.raw_uri);
+  g_free(c->state.uri);
+  g_free(c->state.session.uri);
+  if (c->state.session.focus_id) {
+    g_source_remove(c->state.session.focus_id);
+  }
 
+  /* The callbacks of the cancelled operations don't touch the client. */
+  g_cancellable_cancel(c->cancellable);
+  g_object_unref(c->cancellable);
+  file_completion_cancel(c);
   completion_cleanup(c);
   map_cleanup(c);
   register_cleanup(c);
   setting_cleanup(c);
+  statusbar_cleanup(c);
+  suspend_client_cleanup(c);
+  ext_proxy_client_cleanup(c);
+  download_client_closed(c);
 #ifdef FEATURE_AUTOCMD
   autocmd_cleanup(c);
 #endif
@@ -758,8 +940,10 @@ static void client_destroy(Client *c) {
  *
  * @webview:    Related webview or NULL if a client with an independent
  *              webview shoudl be created.
+ * @session_uri: Uri of a restored window to be loaded on the first focus or
+ *              NULL.
  */
-static Client *client_new(WebKitWebView *webview) {
+static Client *client_new(WebKitWebView *webview, const char *session_uri) {
   Client *c;
 
   /* create the client */
@@ -767,6 +951,18 @@ static Client *client_new(WebKitWebView *webview) {
   c = g_slice_new0(Client);
   c->next = vb.clients;
   vb.clients = c;
+  c->state.session.uri = g_strdup(session_uri);
+
+  /* Related webviews share the web process with the webview they are
+   * created from, so none of them can be suspended alone. */
+  if (webview) {
+    c->state.suspend.shared = TRUE;
+    for (Client *p = vb.clients; p; p = p->next) {
+      if (p->webview == webview) {
+        p->state.suspend.shared = TRUE;
+      }
+    }
+  }
 
   c->state.progress = 100;
   c->config.shortcuts = shortcut_new();
@@ -781,17 +977,27 @@ static Client *client_new(WebKitWebView *webview) {
   /* webview */
   c->webview = webview_new(c, webview);
   c->finder = webkit_web_view_get_find_controller(c->webview);
-  g_signal_connect(c->finder, "counted-matches", G_CALLBACK(on_counted_matches),
-                   c);
+  g_signal_connect(c->finder, "found-text", G_CALLBACK(on_found_text), c);
+  g_signal_connect(c->finder, "failed-to-find-text",
+                   G_CALLBACK(on_failed_to_find_text), c);
 
   c->page_id = webkit_web_view_get_page_id(c->webview);
+  /* The key points into the client and lives as long as the entry. */
+  if (!vb.pages) {
+    vb.pages = g_hash_table_new(g_int64_hash, g_int64_equal);
+  }
+  g_hash_table_replace(vb.pages, &c->page_id, c);
   c->inspector = webkit_web_view_get_inspector(c->webview);
+  c->cancellable = g_cancellable_new();
+  /* Pooled webviews may already have announced their page. */
+  ext_proxy_connect_client(c);
 
   return c;
 }
 
 static void client_show(WebKitWebView *webview, Client *c) {
   GtkWidget *box;
+  gboolean defaults;
 
   c->window = create_window(c);
 
@@ -840,7 +1046,10 @@ static void client_show(WebKitWebView *webview, Client *c) {
    * allow to se the default values for different scopes. For now we can
    * init the settings not in client_new because we need the access to some
    * widget for some settings. */
+  trace_begin("setting_init");
   setting_init(c);
+  trace_end("setting_init");
+  theme_client_init(c);
 
   gtk_widget_show_all(c->window);
 
@@ -866,8 +1075,14 @@ static void client_show(WebKitWebView *webview, Client *c) {
 
   c->state.enable_register = TRUE;
 
-  /* read the config file */
-  ex_run_file(c, vb.files[FILES_CONFIG]);
+  /* read the config file - the config of the first client makes up the
+   * defaults of all clients, so later clients only run the commands that
+   * are no settings */
+  defaults = setting_defaults_begin();
+  trace_begin("ex_run_file");
+  ex_run_config(c, vb.files[FILES_CONFIG], defaults);
+  trace_end("ex_run_file");
+  setting_defaults_end();
 }
 
 static GtkWidget *create_window(Client *c) {
@@ -897,7 +1112,9 @@ static GtkWidget *create_window(Client *c) {
   g_object_connect(
       G_OBJECT(window), "signal::destroy", G_CALLBACK(on_window_destroy), c,
       "signal::delete-event", G_CALLBACK(on_window_delete_event), c,
-      "signal::key-press-event", G_CALLBACK(on_map_keypress), c, NULL);
+      "signal::key-press-event", G_CALLBACK(on_map_keypress), c,
+      "signal::focus-in-event", G_CALLBACK(on_window_focus_in), c,
+      "signal::focus-out-event", G_CALLBACK(on_window_focus_out), c, NULL);
 
   return window;
 }
@@ -1042,7 +1259,7 @@ static void set_statusbar_style(Client *c, StatusType type) {
  */
 static void set_title(Client *c, const char *title) {
   OVERWRITE_STRING(c->state.title, title);
-  update_title(c);
+  present_schedule(c, PRESENT_TITLE);
   g_setenv("VIMB_TITLE", title ? title : "", TRUE);
 }
 
@@ -1107,13 +1324,15 @@ static void spawn_new_instance(const char *uri) {
  */
 static void on_webctx_download_started(WebKitWebContext *webctx,
                                        WebKitDownload *download, Client *c) {
+  DownloadStat *stat;
+
 #ifdef FEATURE_AUTOCMD
   const char *uri =
       webkit_uri_request_get_uri(webkit_download_get_request(download));
   autocmd_run(c, AU_DOWNLOAD_STARTED, uri, NULL);
 #endif
 
-  if (GET_BOOL(c, "download-use-external")) {
+  if (GET_BOOL(c, SID_DOWNLOAD_USE_EXTERNAL)) {
     g_signal_connect(download, "notify::response",
                      G_CALLBACK(on_webdownload_response_received), c);
   } else {
@@ -1124,11 +1343,20 @@ static void on_webctx_download_started(WebKitWebContext *webctx,
                      c);
     g_signal_connect(download, "received-data",
                      G_CALLBACK(on_webdownload_received_data), c);
+    if (GET_INT(c, SID_DOWNLOAD_SEGMENTS) > 0) {
+      g_signal_connect(download, "notify::response",
+                       G_CALLBACK(on_webdownload_response_native), c);
+    }
 
-    c->state.downloads = g_list_append(c->state.downloads, download);
+    /* The size is set once the response is received. */
+    stat = g_new0(DownloadStat, 1);
+    download_tracker_add(&c->state.downloads, stat, -1, 0,
+                         g_get_monotonic_time());
+    g_object_set_data_full(G_OBJECT(download), DOWNLOAD_STAT_KEY, stat,
+                           g_free);
 
     /* to reflect the correct download count */
-    vb_statusbar_update(c);
+    vb_statusbar_invalidate(c, STATUS_DIRTY(STATUS_DOWNLOADS));
   }
 }
 
@@ -1140,6 +1368,9 @@ static void on_webctx_init_web_extension(WebKitWebContext *webctx,
   const char *name;
   GVariant *vdata;
 
+  /* This covers only the setup on the ui side, the time until the web
+   * extension is ready is traced as web_extension_handshake. */
+  trace_begin("web_extension_setup");
 #if (CHECK_WEBEXTENSION_ON_STARTUP)
   char *extension = g_build_filename(EXTENSIONDIR, "webext_main.so", NULL);
   if (!g_file_test(extension, G_FILE_TEST_IS_REGULAR)) {
@@ -1154,6 +1385,7 @@ static void on_webctx_init_web_extension(WebKitWebContext *webctx,
 
   /* Setup the extension directory. */
   webkit_web_context_set_web_extensions_directory(webctx, EXTENSIONDIR);
+  trace_end("web_extension_setup");
 }
 
 /**
@@ -1164,6 +1396,14 @@ static void on_webctx_init_web_extension(WebKitWebContext *webctx,
 static gboolean on_webdownload_decide_destination(WebKitDownload *download,
                                                   gchar *suggested_filename,
                                                   Client *c) {
+  DownloadStat *stat = g_object_get_data(G_OBJECT(download), DOWNLOAD_STAT_KEY);
+  WebKitURIResponse *response = webkit_download_get_response(download);
+
+  if (stat && response) {
+    download_tracker_reset(stat,
+                           webkit_uri_response_get_content_length(response),
+                           stat->received, g_get_monotonic_time());
+  }
   if (webkit_download_get_destination(download)) {
     return TRUE;
   }
@@ -1177,13 +1417,62 @@ static void on_webdownload_response_received(WebKitDownload *download,
   webkit_download_cancel(download);
 }
 
+/**
+ * Hands the download over to the built-in download engine once the response
+ * is known. The webkit download is kept if the engine can't handle it.
+ */
+static void on_webdownload_response_native(WebKitDownload *download,
+                                           GParamSpec *ps, Client *c) {
+  WebKitURIResponse *response = webkit_download_get_response(download);
+  WebKitURIRequest *request = webkit_download_get_request(download);
+  SoupMessageHeaders *headers;
+  const char *uri, *destination, *ranges = NULL, *referer = NULL;
+  char *path, *suggested;
+
+  if (!response) {
+    return;
+  }
+  uri = webkit_uri_response_get_uri(response);
+
+  /* Use the destination given by :save or build it like webkit would. */
+  destination = webkit_download_get_destination(download);
+  if (destination) {
+    path = g_filename_from_uri(destination, NULL, NULL);
+  } else {
+    suggested = g_strdup(webkit_uri_response_get_suggested_filename(response));
+    path = download_build_path(c, uri, suggested, NULL);
+    g_free(suggested);
+  }
+  if (!path) {
+    return;
+  }
+
+  if ((headers = webkit_uri_response_get_http_headers(response))) {
+    ranges = soup_message_headers_get_one(headers, "Accept-Ranges");
+  }
+  if ((headers = webkit_uri_request_get_http_headers(request))) {
+    referer = soup_message_headers_get_one(headers, "Referer");
+  }
+
+  if (download_start(c, uri, referer ? referer : c->state.uri, path,
+                     webkit_uri_response_get_content_length(response),
+                     ranges && !g_ascii_strcasecmp(ranges, "bytes"))) {
+    /* Detach before the cancel to not report the download as failed. */
+    g_signal_handlers_disconnect_by_data(download, c);
+    download_tracker_remove(
+        g_object_get_data(G_OBJECT(download), DOWNLOAD_STAT_KEY));
+    webkit_download_cancel(download);
+  }
+  g_free(path);
+}
+
 static void spawn_download_command(Client *c, WebKitURIResponse *response) {
   char *cmd;
   char **argv, **envp;
   int argc;
   GError *error = NULL;
 
-  cmd = g_strdup_printf(GET_CHAR(c, "download-command"),
+  cmd = g_strdup_printf(GET_CHAR(c, SID_DOWNLOAD_COMMAND),
                         webkit_uri_response_get_uri(response));
 
   if (!g_shell_parse_argv(cmd, &argc, &argv, &error)) {
@@ -1195,7 +1484,7 @@ static void spawn_download_command(Client *c, WebKitURIResponse *response) {
 
   envp = g_get_environ();
   envp = g_environ_setenv(envp, "VIMB_DOWNLOAD_PATH",
-                          GET_CHAR(c, "download-path"), TRUE);
+                          GET_CHAR(c, SID_DOWNLOAD_PATH), TRUE);
 
   if (g_spawn_async(NULL, argv, envp, G_SPAWN_SEARCH_PATH, NULL, NULL, NULL,
                     &error)) {
@@ -1269,10 +1558,11 @@ static void on_webdownload_finished(WebKitDownload *download, Client *c) {
   autocmd_run(c, AU_DOWNLOAD_FINISHED, uri, NULL);
 #endif
 
-  c->state.downloads = g_list_remove(c->state.downloads, download);
+  download_tracker_remove(
+      g_object_get_data(G_OBJECT(download), DOWNLOAD_STAT_KEY));
 
   /* to reflect the correct download count */
-  vb_statusbar_update(c);
+  vb_statusbar_invalidate(c, STATUS_DIRTY(STATUS_DOWNLOADS));
 
   /* get the finished downloads destination uri */
   g_object_get(download, "destination", &destination, NULL);
@@ -1312,13 +1602,12 @@ static void on_webdownload_finished(WebKitDownload *download, Client *c) {
  */
 static void on_webdownload_received_data(WebKitDownload *download,
                                          guint64 data_length, Client *c) {
-  /* rate limit statusbar updates */
-  static gint64 statusbar_update_next = 0;
-
-  if (g_get_monotonic_time() > statusbar_update_next) {
-    statusbar_update_next = g_get_monotonic_time() + 1000000; /* 1 second */
+  DownloadStat *stat = g_object_get_data(G_OBJECT(download), DOWNLOAD_STAT_KEY);
 
-    vb_statusbar_update(c);
+  /* the tracker rate limits the statusbar updates per client */
+  if (stat && download_tracker_update(stat, data_length,
+                                      g_get_monotonic_time())) {
+    vb_statusbar_invalidate(c, STATUS_DIRTY(STATUS_DOWNLOADS));
   }
 }
 
@@ -1345,7 +1634,7 @@ static WebKitWebView *on_webview_create(WebKitWebView *webview,
     return NULL;
   }
 
-  Client *new = client_new(webview);
+  Client *new = client_new(webview, NULL);
 
   return new->webview;
 }
@@ -1422,11 +1711,19 @@ static void decide_navigation_action(Client *c, WebKitPolicyDecision *dec) {
       return;
     }
 #endif
-#ifdef FEATURE_AUTOCMD
     if (strcmp(uri, "about:blank")) {
+      /* Apply the site settings before the request is sent, so that the
+       * user-agent and the content settings are in effect for the main
+       * document. WebKit does not tell which frame the navigation targets,
+       * so frame navigations are undone in on_webview_resource_load_started()
+       * and the settings are corrected once the page is committed. */
+      setting_site_apply(c, uri);
+      g_free(c->state.site.navigation);
+      c->state.site.navigation = g_strdup(uri);
+#ifdef FEATURE_AUTOCMD
       autocmd_run(c, AU_LOAD_STARTING, uri, NULL);
-    }
 #endif
+    }
     webkit_policy_decision_use(dec);
   }
 }
@@ -1493,7 +1790,8 @@ static void on_webview_load_changed(WebKitWebView *webview,
 
   raw_uri = webkit_web_view_get_uri(webview);
   if (raw_uri) {
-    uri = util_sanitize_uri(raw_uri);
+    /* Copy the cached uri as autocmds may change it while we use it. */
+    uri = g_strdup(get_sanitized_uri(c));
   }
 
   switch (event) {
@@ -1501,9 +1799,15 @@ static void on_webview_load_changed(WebKitWebView *webview,
 #ifdef FEATURE_AUTOCMD
     autocmd_run(c, AU_LOAD_STARTED, raw_uri, NULL);
 #endif
+    /* A restored window that loads another page before it got the focus
+     * drops the page of the session. */
+    if (c->state.session.uri) {
+      g_clear_pointer(&c->state.session.uri, g_free);
+      c->state.session.scroll_top = 0;
+    }
     /* update load progress in statusbar */
     c->state.progress = 0;
-    vb_statusbar_update(c);
+    vb_statusbar_invalidate(c, STATUS_DIRTY(STATUS_PROGRESS));
     if (uri) {
       set_title(c, uri);
     }
@@ -1526,6 +1830,12 @@ static void on_webview_load_changed(WebKitWebView *webview,
      * or aborted the load will be commited. So this seems to be the
      * right place to remove the flag. */
     c->mode->flags &= ~FLAG_IGNORE_FOCUS;
+    trace_instant("load_committed");
+    /* The site settings were applied by the navigation already, this only
+     * corrects them if the main resource was redirected to another host. */
+    if (raw_uri) {
+      setting_site_apply(c, raw_uri);
+    }
 #ifdef FEATURE_AUTOCMD
     autocmd_run(c, AU_LOAD_COMMITTED, raw_uri, NULL);
 #endif
@@ -1552,13 +1862,26 @@ static void on_webview_load_changed(WebKitWebView *webview,
     break;
 
   case WEBKIT_LOAD_FINISHED:
+    /* Startup tracing ends with the first loaded page. */
+    trace_instant("load_finished");
+    trace_finish();
 #ifdef FEATURE_AUTOCMD
     autocmd_run(c, AU_LOAD_FINISHED, raw_uri, NULL);
 #endif
     c->state.progress = 100;
+    /* Fall back to the site settings of the shown page if the navigation
+     * failed or was cancelled, for example for a download. */
+    if (raw_uri) {
+      setting_site_apply(c, raw_uri);
+    }
     if (uri && strncmp(uri, "about:", 6)) {
       history_add(c, HISTORY_URL, uri, webkit_web_view_get_title(webview));
     }
+    /* Jump to the position of the restored session. */
+    if (c->state.session.scroll_top) {
+      ext_proxy_scroll(c, '\'', MIN(c->state.session.scroll_top, G_MAXINT), 0);
+      c->state.session.scroll_top = 0;
+    }
     break;
   }
 
@@ -1567,6 +1890,31 @@ static void on_webview_load_changed(WebKitWebView *webview,
   }
 }
 
+/**
+ * Callback for the webview resource-load-started signal.
+ * Takes back the site settings applied by decide_navigation_action() if the
+ * navigation loaded a frame instead of the main document.
+ */
+static void on_webview_resource_load_started(WebKitWebView *webview,
+                                             WebKitWebResource *resource,
+                                             WebKitURIRequest *request,
+                                             Client *c) {
+  const char *uri;
+
+  if (!c->state.site.navigation) {
+    return;
+  }
+  if (resource == webkit_web_view_get_main_resource(webview)) {
+    g_clear_pointer(&c->state.site.navigation, g_free);
+  } else if (!strcmp(webkit_uri_request_get_uri(request),
+                     c->state.site.navigation)) {
+    g_clear_pointer(&c->state.site.navigation, g_free);
+    if ((uri = webkit_web_view_get_uri(webview))) {
+      setting_site_apply(c, uri);
+    }
+  }
+}
+
 /**
  * Callback for the webview mouse-target-changed signal.
  * This is used to print the uri too statusbar if the user hovers over links
@@ -1604,8 +1952,10 @@ static void on_webview_notify_estimated_load_progress(WebKitWebView *webview,
                                                       Client *c) {
   c->state.progress =
       webkit_web_view_get_estimated_load_progress(webview) * 100;
-  vb_statusbar_update(c);
-  update_title(c);
+  vb_statusbar_invalidate(c, STATUS_DIRTY(STATUS_PROGRESS));
+#ifdef FEATURE_TITLE_PROGRESS
+  present_schedule(c, PRESENT_TITLE);
+#endif
 }
 
 /**
@@ -1627,14 +1977,10 @@ static void on_webview_notify_title(WebKitWebView *webview, GParamSpec *pspec,
  */
 static void on_webview_notify_uri(WebKitWebView *webview, GParamSpec *pspec,
                                   Client *c) {
-  if (c->state.uri) {
-    g_free(c->state.uri);
-  }
-
-  c->state.uri = util_sanitize_uri(webkit_web_view_get_uri(c->webview));
+  get_sanitized_uri(c);
 
-  update_urlbar(c);
-  g_setenv("VIMB_URI", c->state.uri, TRUE);
+  present_schedule(c, PRESENT_URLBAR);
+  g_setenv("VIMB_URI", c->state.uri ? c->state.uri : "", TRUE);
 }
 
 /**
@@ -1652,6 +1998,7 @@ static gboolean on_webview_web_process_crashed(WebKitWebView *webview,
                                                Client *c) {
   vb_echo(c, MSG_ERROR, FALSE, "Webview Crashed on %s",
           webkit_web_view_get_uri(webview));
+  ext_proxy_client_disconnect(c);
 
   return TRUE;
 }
@@ -1689,6 +2036,7 @@ static gboolean on_webview_leave_fullscreen(WebKitWebView *webview, Client *c) {
   c->state.is_fullscreen = FALSE;
   gtk_widget_show(GTK_WIDGET(c->statusbar.box));
   gtk_widget_set_visible(GTK_WIDGET(c->input), TRUE);
+  vb_statusbar_update(c);
   return FALSE;
 }
 
@@ -1712,6 +2060,53 @@ static void on_window_destroy(GtkWidget *window, Client *c) {
   client_destroy(c);
 }
 
+/**
+ * Callback for the window focus-in-event. Loads the page of restored or
+ * suspended windows.
+ */
+static gboolean on_window_focus_in(GtkWidget *window, GdkEvent *event,
+                                   Client *c) {
+  suspend_client_focus(c, TRUE);
+
+  /* The window manager may pass the focus through all the windows mapped on
+   * restore. Wait until the pending events are processed to load only the
+   * page of the window that really keeps the focus. */
+  if (c->state.session.uri && !c->state.session.focus_id) {
+    c->state.session.focus_id = g_idle_add((GSourceFunc)session_load, c);
+  }
+  return FALSE;
+}
+
+/**
+ * Callback for the window focus-out-event.
+ */
+static gboolean on_window_focus_out(GtkWidget *window, GdkEvent *event,
+                                    Client *c) {
+  suspend_client_focus(c, FALSE);
+  return FALSE;
+}
+
+/**
+ * Loads the page of a restored window if the window is still focused.
+ */
+static gboolean session_load(Client *c) {
+  char *uri;
+
+  c->state.session.focus_id = 0;
+  if (!c->state.session.uri ||
+      !gtk_window_is_active(GTK_WINDOW(c->window))) {
+    return G_SOURCE_REMOVE;
+  }
+
+  uri = c->state.session.uri;
+  c->state.session.uri = NULL;
+  c->state.suspend.reclaimed = 0;
+  webkit_web_view_load_uri(c->webview, uri);
+  g_free(uri);
+
+  return G_SOURCE_REMOVE;
+}
+
 /**
  * Callback for to quit given client as idle event source.
  */
@@ -1759,20 +2154,103 @@ static void register_cleanup(Client *c) {
   }
 }
 
+/**
+ * Schedules the update of the given parts of the window title and url bar for
+ * the next frame. Changes in between are coalesced into a single update.
+ * Windows that draw no frame, like unmapped or iconified ones, are updated
+ * after PRESENT_TIMEOUT instead.
+ */
+static void present_schedule(Client *c, guint parts) {
+  c->state.present.dirty |= parts;
+  if (!c->state.present.tick_id) {
+    c->state.present.tick_id =
+        gtk_widget_add_tick_callback(c->window, present_tick, c, NULL);
+  }
+  if (!c->state.present.timeout_id) {
+    c->state.present.timeout_id =
+        g_timeout_add(PRESENT_TIMEOUT, present_timeout, c);
+  }
+}
+
+static gboolean present_tick(GtkWidget *widget, GdkFrameClock *clock,
+                             gpointer data) {
+  Client *c = (Client *)data;
+
+  c->state.present.tick_id = 0;
+  if (c->state.present.timeout_id) {
+    g_source_remove(c->state.present.timeout_id);
+    c->state.present.timeout_id = 0;
+  }
+  present_update(c);
+
+  return G_SOURCE_REMOVE;
+}
+
+static gboolean present_timeout(gpointer data) {
+  Client *c = (Client *)data;
+
+  c->state.present.timeout_id = 0;
+  if (c->state.present.tick_id) {
+    gtk_widget_remove_tick_callback(c->window, c->state.present.tick_id);
+    c->state.present.tick_id = 0;
+  }
+  present_update(c);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void present_update(Client *c) {
+  guint parts = c->state.present.dirty;
+
+  c->state.present.dirty = 0;
+  if (parts & PRESENT_TITLE) {
+    update_title(c);
+  }
+  if (parts & PRESENT_URLBAR) {
+    update_urlbar(c);
+  }
+}
+
+/**
+ * Returns the sanitized uri of the current page. The uri is only sanitized
+ * again if webkit reports another uri than before.
+ */
+static const char *get_sanitized_uri(Client *c) {
+  const char *raw_uri = webkit_web_view_get_uri(c->webview);
+
+  if (g_strcmp0(raw_uri, c->state.raw_uri)) {
+    OVERWRITE_STRING(c->state.raw_uri, raw_uri);
+    g_free(c->state.uri);
+    c->state.uri = raw_uri ? util_sanitize_uri(raw_uri) : NULL;
+  }
+
+  return c->state.uri;
+}
+
 static void update_title(Client *c) {
+  char *title = NULL;
+
 #ifdef FEATURE_TITLE_PROGRESS
   /* Show load status of page or the downloads. */
   if (c->state.progress != 100) {
-    char *title = g_strdup_printf("[%i%%] %s", c->state.progress,
-                                  c->state.title ? c->state.title : "");
-    gtk_window_set_title(GTK_WINDOW(c->window), title);
-    g_free(title);
-
-    return;
+    title = g_strdup_printf("[%i%%] %s", c->state.progress,
+                            c->state.title ? c->state.title : "");
   }
 #endif
-  if (c->state.title) {
-    gtk_window_set_title(GTK_WINDOW(c->window), c->state.title);
+  if (!title) {
+    if (!c->state.title) {
+      return;
+    }
+    title = g_strdup(c->state.title);
+  }
+
+  /* Each new title is a round trip to the window manager. */
+  if (g_strcmp0(title, c->state.present.title)) {
+    gtk_window_set_title(GTK_WINDOW(c->window), title);
+    g_free(c->state.present.title);
+    c->state.present.title = title;
+  } else {
+    g_free(title);
   }
 }
 
@@ -1799,10 +2277,20 @@ static void update_urlbar(Client *c) {
     g_string_append_printf(str, " [%s]", back ? (fwd ? "-+" : "-") : "+");
   }
 
-  gtk_label_set_text(GTK_LABEL(c->statusbar.left), str->str);
+  statusbar_set_left(c, str->str);
   g_string_free(str, TRUE);
 }
 
+/**
+ * Sets the text on the left of the statusbar if it differs from the shown.
+ */
+static void statusbar_set_left(Client *c, const char *text) {
+  if (g_strcmp0(text, c->statusbar.left_text)) {
+    gtk_label_set_text(GTK_LABEL(c->statusbar.left), text);
+    OVERWRITE_STRING(c->statusbar.left_text, text);
+  }
+}
+
 #ifdef FREE_ON_QUIT
 /**
  * Free memory of the whole application.
@@ -1813,6 +2301,8 @@ static void vimb_cleanup(void) {
   while (vb.clients) {
     client_destroy(vb.clients);
   }
+  g_clear_pointer(&vb.pages, g_hash_table_destroy);
+  webview_pool_cleanup();
 
   /* free memory of other components */
   util_cleanup();
@@ -1857,6 +2347,7 @@ static void vimb_setup(void) {
   if (!vb.incognito) {
     vb.files[FILES_CLOSED] = g_build_filename(dataPath, "closed", NULL);
     vb.files[FILES_COOKIE] = g_build_filename(dataPath, "cookies.db", NULL);
+    vb.files[FILES_SESSION] = g_build_filename(dataPath, "session", NULL);
   }
   vb.files[FILES_BOOKMARK] = g_build_filename(dataPath, "bookmark", NULL);
   vb.files[FILES_QUEUE] = g_build_filename(dataPath, "queue", NULL);
@@ -1914,62 +2405,58 @@ static void vimb_setup(void) {
 /**
  * Update the gui style settings for client c, given a style setting name and a
  * style setting value to be updated. The complete style sheet document will be
- * regenerated and re-fed into gtk css provider.
+ * regenerated and re-fed into gtk css provider. If the setting name is NULL
+ * the style sheet is generated from the current settings only.
  */
 void vb_gui_style_update(Client *c, const char *setting_name_new,
                          const char *setting_value_new) {
   g_assert(c);
-  g_assert(setting_name_new);
-  g_assert(setting_value_new);
+  g_assert(!setting_name_new || setting_value_new);
 
   /* The css style sheet document being composed in this function */
   GString *style_sheet = g_string_new(GUI_STYLE_CSS_BASE);
   size_t i;
 
-  /* Mapping from vimb config setting name to css style sheet string */
-  static const char *setting_style_map[][2] = {
-      {"completion-css", " #completion{%s}"},
-      {"completion-hover-css", " #completion:hover{%s}"},
-      {"completion-selected-css", " #completion:selected{%s}"},
-      {"input-css", " #input{%s}"},
-      {"input-error-css", " #input.error{%s}"},
-      {"status-css", " #statusbar{%s}"},
-      {"status-ssl-css", " #statusbar.secure{%s}"},
-      {"status-ssl-invalid-css", " #statusbar.unsecure{%s}"},
-      {0, 0},
+  /* Mapping from vimb config setting to css style sheet string */
+  static const struct {
+    SettingId id;
+    const char *style;
+  } setting_style_map[] = {
+      {SID_COMPLETION_CSS, " #completion{%s}"},
+      {SID_COMPLETION_HOVER_CSS, " #completion:hover{%s}"},
+      {SID_COMPLETION_SELECTED_CSS, " #completion:selected{%s}"},
+      {SID_INPUT_CSS, " #input{%s}"},
+      {SID_INPUT_ERROR_CSS, " #input.error{%s}"},
+      {SID_STATUS_CSS, " #statusbar{%s}"},
+      {SID_STATUS_SSL_CSS, " #statusbar.secure{%s}"},
+      {SID_STATUS_SSL_INVALID_CSS, " #statusbar.unsecure{%s}"},
   };
 
-  /* For each supported style setting name */
-  for (i = 0; setting_style_map[i][0]; i++) {
-    const char *setting_name = setting_style_map[i][0];
-    const char *style_string = setting_style_map[i][1];
+  /* For each supported style setting */
+  for (i = 0; i < LENGTH(setting_style_map); i++) {
+    Setting *setting = c->config.settings[setting_style_map[i].id];
+    const char *style_string = setting_style_map[i].style;
+
+    /* If the current style setting name is not available via settings
+     * yet - this happens during setting_init() - cleanup and return.
+     * We are going to be called again. With the last setting_add(),
+     * all style setting names are available. */
+    if (!setting || !setting->name) {
+      goto cleanup;
+    }
 
     /* If the current style setting name is the one to be updated,
      * append the given value with appropriate css wrapping to the
      * style sheet document. */
-    if (strcmp(setting_name, setting_name_new) == 0) {
+    if (setting_name_new && strcmp(setting->name, setting_name_new) == 0) {
       if (strlen(setting_value_new)) {
         g_string_append_printf(style_sheet, style_string, setting_value_new);
       }
     }
     /* If the current style setting name is NOT the one being updated,
      * append the css string based on the current config setting. */
-    else {
-      Setting *setting_value =
-          (Setting *)g_hash_table_lookup(c->config.settings, setting_name);
-
-      /* If the current style setting name is not available via settings
-       * yet - this happens during setting_init() - cleanup and return.
-       * We are going to be called again. With the last setting_add(),
-       * all style setting names are available. */
-      if (!setting_value) {
-        goto cleanup;
-      }
-
-      if (strlen(setting_value->value.s)) {
-        g_string_append_printf(style_sheet, style_string,
-                               setting_value->value.s);
-      }
+    else if (setting->value.s && strlen(setting->value.s)) {
+      g_string_append_printf(style_sheet, style_string, setting->value.s);
     }
   }
 
@@ -2020,12 +2507,16 @@ static WebKitWebView *webview_new(Client *c, WebKitWebView *webview) {
   GdkRGBA background;
 
   /* create a new webview */
-  ucm = webkit_user_content_manager_new();
   if (webview) {
+    ucm = webkit_user_content_manager_new();
     new = WEBKIT_WEB_VIEW(g_object_new(WEBKIT_TYPE_WEB_VIEW,
                                        "user-content-manager", ucm,
                                        "related-view", webview, NULL));
+  } else if (!c->state.session.uri && (new = webview_pool_take())) {
+    /* Prepared webview with running web process and user content. */
+    ucm = webkit_web_view_get_user_content_manager(new);
   } else {
+    ucm = webkit_user_content_manager_new();
     new = WEBKIT_WEB_VIEW(g_object_new(WEBKIT_TYPE_WEB_VIEW,
                                        "user-content-manager", ucm,
                                        "web-context", vb.webcontext, NULL));
@@ -2046,6 +2537,8 @@ static WebKitWebView *webview_new(Client *c, WebKitWebView *webview) {
       "signal::notify::title", G_CALLBACK(on_webview_notify_title), c,
       "signal::notify::uri", G_CALLBACK(on_webview_notify_uri), c,
       "signal::permission-request", G_CALLBACK(on_permission_request), c,
+      "signal::resource-load-started",
+      G_CALLBACK(on_webview_resource_load_started), c,
       "signal::scroll-event", G_CALLBACK(on_scroll), c, "signal::ready-to-show",
       G_CALLBACK(on_webview_ready_to_show), c, "signal::web-process-crashed",
       G_CALLBACK(on_webview_web_process_crashed), c, "signal::authenticate",
@@ -2065,10 +2558,21 @@ static WebKitWebView *webview_new(Client *c, WebKitWebView *webview) {
   return new;
 }
 
-static void on_counted_matches(WebKitFindController *finder, guint count,
-                               Client *c) {
-  c->state.search.matches = count;
-  vb_statusbar_update(c);
+/**
+ * Takes the number of matches of a literal search from the find controller.
+ * It searches the frames of the page too, so the count fits to the matches
+ * stepped through by n and N.
+ */
+static void on_found_text(WebKitFindController *finder, guint count,
+                          Client *c) {
+  if (c->state.search.active && !c->state.search.flags) {
+    c->state.search.matches = count;
+    vb_statusbar_invalidate(c, STATUS_DIRTY(STATUS_SEARCH));
+  }
+}
+
+static void on_failed_to_find_text(WebKitFindController *finder, Client *c) {
+  on_found_text(finder, 0, c);
 }
 
 static gboolean on_permission_request(WebKitWebView *webview,
@@ -2079,7 +2583,7 @@ static gboolean on_permission_request(WebKitWebView *webview,
   char *msg = NULL;
 
   if (WEBKIT_IS_GEOLOCATION_PERMISSION_REQUEST(request)) {
-    char *geolocation_setting = GET_CHAR(c, "geolocation");
+    char *geolocation_setting = GET_CHAR(c, SID_GEOLOCATION);
     if (strcmp(geolocation_setting, "ask") == 0) {
       msg = "access your location";
     } else if (strcmp(geolocation_setting, "always") == 0) {
@@ -2098,7 +2602,7 @@ static gboolean on_permission_request(WebKitWebView *webview,
       msg = "access you webcam";
     }
   } else if (WEBKIT_IS_NOTIFICATION_PERMISSION_REQUEST(request)) {
-    char *notification_setting = GET_CHAR(c, "notification");
+    char *notification_setting = GET_CHAR(c, SID_NOTIFICATION);
     if (strcmp(notification_setting, "ask") == 0) {
       msg = "show notifications";
     } else if (strcmp(notification_setting, "always") == 0) {
@@ -2177,52 +2681,18 @@ static gboolean autocmdOptionArgFunc(const gchar *option_name,
   return TRUE;
 }
 
-void preference_apply(Preference *preference, void *args) {
-  Client *client = args;
-  GdkRGBA *ssl_color = malloc(sizeof(GdkRGBA));
-  GdkRGBA *unsecure_color = malloc(sizeof(GdkRGBA));
-
-  preference->background.alpha = preference->opacity;
-
-  memcpy(ssl_color, &preference->palette[2], sizeof(GdkRGBA));
-  ssl_color->alpha = preference->opacity;
-
-  memcpy(unsecure_color, &preference->palette[1], sizeof(GdkRGBA));
-  unsecure_color->alpha = preference->opacity;
-
-  char *style_sheet = malloc(sizeof(char) * 1000);
-  sprintf(style_sheet,
-          "#statusbar {background-color: %s; color: %s; font-family: %s; "
-          "font-size: %s;}\n"
-          "#statusbar.secure {background-color: %s;}\n"
-          "#statusbar.unsecure {background-color: %s;}\n"
-          "#input.view {background-color: %s; font-family: %s; font-size: %s;}"
-          "#input.view text {background-color: rgba(0,0,0,0); color: %s;}",
-          gdk_rgba_to_string(&preference->background),
-          gdk_rgba_to_string(&preference->bold), preference->font_family,
-          preference->font_size, gdk_rgba_to_string(ssl_color),
-          gdk_rgba_to_string(unsecure_color),
-          gdk_rgba_to_string(&preference->background), preference->font_family,
-          preference->font_size, gdk_rgba_to_string(&preference->foreground));
-
-  gtk_css_provider_load_from_data(vb.style_provider, style_sheet, -1, NULL);
-
-  G_GNUC_BEGIN_IGNORE_DEPRECATIONS;
-  gtk_style_context_invalidate(gtk_widget_get_style_context(client->input));
-  G_GNUC_END_IGNORE_DEPRECATIONS;
-
-  webkit_web_view_set_background_color(client->webview, &preference->background);
-}
-
 int main(int argc, char *argv[]) {
   Client *c;
   GError *err = NULL;
   char *pidstr;
-  PreferenceWatch *prefwatch;
 #ifndef FEATURE_NO_XEMBED
   char *winid = NULL;
 #endif
-  gboolean ver = FALSE, buginfo = FALSE;
+  gboolean ver = FALSE, buginfo = FALSE, restore = FALSE;
+  guint restored = 0;
+  char *tracefile = NULL;
+  gint64 start = g_get_monotonic_time();
+  gboolean remote = FALSE;
 
   GOptionEntry opts[] = {
       {"cmd", 'C', 0, G_OPTION_ARG_CALLBACK,
@@ -2243,6 +2713,15 @@ int main(int argc, char *argv[]) {
        "Do no attempt to maximize window", NULL},
       {"bug-info", 0, 0, G_OPTION_ARG_NONE, &buginfo,
        "Print used library versions", NULL},
+      {"restore", 'r', 0, G_OPTION_ARG_NONE, &restore,
+       "Restore the windows of the last session", NULL},
+      {"trace-startup", 0, 0, G_OPTION_ARG_FILENAME, &tracefile,
+       "Write startup trace to FILE or summary to stdout if FILE is '-'",
+       "FILE"},
+      /* Accepted without FEATURE_REMOTE too, so that launchers using it
+       * still work. */
+      {"remote", 0, 0, G_OPTION_ARG_NONE, &remote,
+       "Open URI in an already running instance if there is one", NULL},
       {NULL}};
 
   /* initialize GTK+ */
@@ -2253,6 +2732,12 @@ int main(int argc, char *argv[]) {
     return EXIT_FAILURE;
   }
 
+  if (tracefile) {
+    trace_init(tracefile, start);
+    trace_add("gtk_init", start, g_get_monotonic_time());
+    g_free(tracefile);
+  }
+
   if (ver) {
     printf("%s, version %s\n", PROJECT, VERSION);
     return EXIT_SUCCESS;
@@ -2277,6 +2762,18 @@ int main(int argc, char *argv[]) {
     return EXIT_SUCCESS;
   }
 
+#ifdef FEATURE_REMOTE
+  /* Hand the request over to a running instance of the same profile. Reading
+   * from stdin, embedding and incognito always start an own instance. */
+  if (remote && !vb.incognito && !(argc > 1 && !strcmp(argv[argc - 1], "-"))
+#ifndef FEATURE_NO_XEMBED
+      && !winid
+#endif
+      && remote_forward(argc > 1 ? argv[argc - 1] : NULL, vb.cmdargs)) {
+    return EXIT_SUCCESS;
+  }
+#endif
+
   /* Save the base name for spawning new instances. */
   vb.argv0 = argv[0];
 
@@ -2285,7 +2782,14 @@ int main(int argc, char *argv[]) {
   g_setenv("VIMB_PID", pidstr, TRUE);
   g_free(pidstr);
 
+  trace_begin("vimb_setup");
   vimb_setup();
+  trace_end("vimb_setup");
+#ifdef FEATURE_REMOTE
+  if (!vb.incognito) {
+    remote_init();
+  }
+#endif
 
 #ifndef FEATURE_NO_XEMBED
   if (winid) {
@@ -2293,28 +2797,51 @@ int main(int argc, char *argv[]) {
   }
 #endif
 
-  c = client_new(NULL);
-  client_show(NULL, c);
-
-  /* process the --cmd if this was given */
-  for (GSList *l = vb.cmdargs; l; l = l->next) {
-    ex_run_string(c, l->data, false);
+  if (restore) {
+    trace_begin("session_restore");
+    restored = session_restore();
+    trace_end("session_restore");
   }
-  if (argc <= 1) {
-    vb_load_uri(c, &(Arg){TARGET_CURRENT, NULL});
-  } else if (!strcmp(argv[argc - 1], "-")) {
-    /* read from stdin if uri is - */
-    read_from_stdin(c);
-  } else {
-    vb_load_uri(c, &(Arg){TARGET_CURRENT, argv[argc - 1]});
+
+  /* A given uri is opened in a window beside the restored ones. */
+  if (!restored || argc > 1) {
+    trace_begin("client_new");
+    c = client_new(NULL, NULL);
+    trace_end("client_new");
+    trace_begin("client_show");
+    client_show(NULL, c);
+    trace_end("client_show");
+
+    /* process the --cmd if this was given */
+    for (GSList *l = vb.cmdargs; l; l = l->next) {
+      ex_run_string(c, l->data, false);
+    }
+    if (argc <= 1) {
+      vb_load_uri(c, &(Arg){TARGET_CURRENT, NULL});
+    } else if (!strcmp(argv[argc - 1], "-")) {
+      /* read from stdin if uri is - */
+      read_from_stdin(c);
+    } else {
+      vb_load_uri(c, &(Arg){TARGET_CURRENT, argv[argc - 1]});
+    }
   }
 
-  prefwatch = preference_watch(preference_apply, c);
+  theme_init();
+  /* Prepare webviews for further windows once the first one is up. */
+  webview_pool_init(WEBVIEW_POOL_SIZE);
+  suspend_init();
   gtk_main();
+  suspend_cleanup();
+  session_cleanup();
+  file_completion_cleanup();
+  download_cleanup();
+#ifdef FEATURE_REMOTE
+  remote_cleanup();
+#endif
 #ifdef FREE_ON_QUIT
   vimb_cleanup();
 #endif
-  // preference_watch_cancel(prefwatch);
+  theme_cleanup();
   pthread_exit(NULL);
 
   return EXIT_SUCCESS;
@@ -30,14 +30,16 @@
 #include "shortcut.h"
 #include "handler.h"
 #include "file-storage.h"
+#include "setting-id.h"
+#include "download-tracker.h"
 
 
 #define LENGTH(x) (sizeof x / sizeof x[0])
 #define OVERWRITE_STRING(t, s) {if (t) g_free(t); t = g_strdup(s);}
 #define OVERWRITE_NSTRING(t, s, l) {if (t) {g_free(t); t = NULL;} t = g_strndup(s, l);}
-#define GET_CHAR(c, n)  (((Setting*)g_hash_table_lookup(c->config.settings, n))->value.s)
-#define GET_INT(c, n)   (((Setting*)g_hash_table_lookup(c->config.settings, n))->value.i)
-#define GET_BOOL(c, n)  (((Setting*)g_hash_table_lookup(c->config.settings, n))->value.b)
+#define GET_CHAR(c, id) (c->config.settings[id]->value.s)
+#define GET_INT(c, id)  (c->config.settings[id]->value.i)
+#define GET_BOOL(c, id) (c->config.settings[id]->value.b)
 
 
 #ifdef DEBUG
@@ -112,6 +114,7 @@ enum {
     FILES_COOKIE,
     FILES_QUEUE,
     FILES_SCRIPT,
+    FILES_SESSION,
     FILES_USER_STYLE,
     FILES_LAST
 };
@@ -162,7 +165,8 @@ typedef struct {
 } Setting;
 
 struct State {
-    char                *uri;
+    char                *uri;               /* sanitized uri of the current page */
+    char                *raw_uri;           /* webkit uri the uri was made of */
     gboolean            typed;              /* indicates if the user typed the keys */
     gboolean            processed_key;      /* indicates if a key press was handled and should not bubbled up */
     gboolean            ctrlv;              /* indicates if the CTRL-V temorary submode is on */
@@ -177,13 +181,35 @@ struct State {
     guint               scroll_percent;     /* Current position of the viewport in document (percent). */
     guint64             scroll_top;         /* Current position of the viewport in document (pixel). */
     char                *title;             /* Window title of the client. */
+    struct {
+        char            *title;             /* title last set on the window */
+        guint           dirty;              /* parts to update on next frame */
+        guint           tick_id;            /* id of the pending tick callback */
+        guint           timeout_id;         /* fallback if no frame is drawn */
+    } present;
+    struct {
+        char            mode;               /* key of the pending relative scroll */
+        int             count;              /* summed up count of the pending scroll */
+        guint           tick_id;            /* id of the pending tick callback */
+    } scroll;
+    struct {
+        char            *uri;               /* uri of a restored window loaded on first focus */
+        guint64         scroll_top;         /* scroll position to restore after the load */
+        guint           focus_id;           /* pending load after the focus */
+    } session;
+    struct {
+        guint           timeout_id;         /* pending suspension of the unfocused window */
+        gint64          inactive_since;     /* time the window lost the focus or 0 */
+        gsize           reclaimed;          /* KiB freed by the suspension */
+        gboolean        shared;             /* web process is shared with related windows */
+    } suspend;
 
     char                *reg[REG_SIZE];     /* holds the yank buffers */
     /* TODO rename to reg_{enabled,current} */
     gboolean            enable_register;    /* indicates if registers are filled */
     char                current_register;   /* holds char for current register to be used */
 
-    GList               *downloads;
+    DownloadTracker     downloads;          /* progress of running downloads */
     guint               progress;
     WebKitHitTestResult *hit_test_result;
     gboolean            is_fullscreen;
@@ -192,8 +218,17 @@ struct State {
         gboolean    active;         /* indicate if there is a active search */
         short       direction;      /* last direction 1 forward, -1 backward */
         int         matches;        /* number of matching search results */
+        guint       flags;          /* ExtSearchFlags of the active search */
         char        *last_query;    /* last search query */
     } search;
+    struct {
+        const GArray    *profile;       /* site settings of the current host */
+        guint           generation;     /* of the site rules profile is from */
+        GArray          *saved;         /* values replaced by site settings */
+        char            *navigation;    /* uri of the navigation the site
+                                           settings were applied for until
+                                           its main resource is loaded */
+    } site;
 };
 
 struct Map {
@@ -220,9 +255,27 @@ struct Mode {
     unsigned int         flags;
 };
 
+/* Fields on the right of the statusbar in the order they are shown. */
+typedef enum {
+    STATUS_SEARCH,
+    STATUS_PROGRESS,
+    STATUS_DOWNLOADS,
+    STATUS_SETTINGS,
+    STATUS_SCROLL,
+    STATUS_FIELD_LAST
+} StatusField;
+
+#define STATUS_DIRTY(field) (1 << (field))
+#define STATUS_DIRTY_ALL    (STATUS_DIRTY(STATUS_FIELD_LAST) - 1)
+
 struct Statusbar {
     GtkBox    *box;
     GtkWidget *mode, *left, *right, *cmd;
+    char      *fields[STATUS_FIELD_LAST];   /* rendered text of the fields */
+    char      *text;                        /* text shown on the right */
+    char      *left_text;                   /* text shown on the left */
+    guint     dirty;                        /* fields to render again */
+    guint     render_id;                    /* source id of pending render */
 };
 
 struct AuGroup;
@@ -241,12 +294,15 @@ struct Client {
     guint64             page_id;                /* page id of the webview */
     GtkTextBuffer       *buffer;
     GDBusProxy          *dbusproxy;
+    GQueue              *dbuscalls;             /* calls made before dbusproxy was set */
+    gint64              dbuswait;               /* time the client started to wait for dbusproxy */
+    GCancellable        *cancellable;           /* cancelled when the client is destroyed */
     GDBusServer         *dbusserver;
     Handler             *handler;               /* the protocoll handlers */
     struct {
-        /* TODO split in global setting definitions and set values on a per
-         * client base. */
-        GHashTable              *settings;
+        /* Points to the global default of the setting or to the client's
+         * own copy if the setting was changed for this client only. */
+        Setting                 *settings[SID_LAST];
         guint                   scrollstep;
         guint                   scrollmultiplier;
         gboolean                input_autohide;
@@ -275,6 +331,7 @@ struct Client {
 struct Vimb {
     char        *argv0;
     Client      *clients;
+    GHashTable  *pages;             /* clients by the page id of their webview */
 #ifndef FEATURE_NO_XEMBED
     Window      embed;
 #endif
@@ -313,8 +370,11 @@ void vb_modelabel_update(Client *c, const char *label);
 gboolean vb_quit(Client *c, gboolean force);
 void vb_register_add(Client *c, char buf, const char *value);
 const char *vb_register_get(Client *c, char buf);
+void vb_statusbar_invalidate(Client *c, guint fields);
 void vb_statusbar_update(Client *c);
 void vb_statusbar_show_hover_url(Client *c, VbLinkType type, const char *uri);
 void vb_gui_style_update(Client *c, const char *name, const char *value);
+Client *vb_window_open(const char *uri, GSList *cmds);
+Client *vb_window_restore(const char *uri, const char *title, GSList *cmds);
 
 #endif /* end of include guard: _MAIN_H */
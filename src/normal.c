@@ -27,7 +27,7 @@
 #include "ext-proxy.h"
 #include "main.h"
 #include "normal.h"
-#include "scripts/scripts.h"
+#include "setting.h"
 #include "util.h"
 #include "ext-proxy.h"
 
@@ -71,6 +71,8 @@ static VbResult normal_prevnext(Client *c, const NormalCmdInfo *info);
 static VbResult normal_queue(Client *c, const NormalCmdInfo *info);
 static VbResult normal_quit(Client *c, const NormalCmdInfo *info);
 static VbResult normal_scroll(Client *c, const NormalCmdInfo *info);
+static void normal_scroll_flush(Client *c);
+static gboolean normal_scroll_tick(GtkWidget *widget, GdkFrameClock *clock, gpointer data);
 static VbResult normal_search(Client *c, const NormalCmdInfo *info);
 static VbResult normal_search_selection(Client *c, const NormalCmdInfo *info);
 static VbResult normal_view_inspector(Client *c, const NormalCmdInfo *info);
@@ -519,12 +521,10 @@ static VbResult normal_do_hint(Client *c, const char *prompt)
 
 static VbResult normal_increment_decrement(Client *c, const NormalCmdInfo *info)
 {
-    char *js;
     int count = info->count ? info->count : 1;
 
-    js = g_strdup_printf(JS_INCREMENT_URI_NUMBER, info->key == CTRL('A') ? count : -count);
-    ext_proxy_eval_script(c, js, NULL);
-    g_free(js);
+    ext_proxy_call_js(c, EXT_JS_INCREMENT_URI_NUMBER,
+            g_variant_new("(i)", info->key == CTRL('A') ? count : -count), NULL);
 
     return RESULT_COMPLETE;
 }
@@ -707,15 +707,55 @@ static VbResult normal_quit(Client *c, const NormalCmdInfo *info)
 
 static VbResult normal_scroll(Client *c, const NormalCmdInfo *info)
 {
-    char *js;
+    switch (info->key) {
+        case 'j': case 'k': case 'h': case 'l':
+        case CTRL('D'): case CTRL('U'): case CTRL('F'): case CTRL('B'):
+            /* Relative scrolls of held keys are summed up and sent once per
+             * frame. */
+            if (c->state.scroll.mode && c->state.scroll.mode != info->key) {
+                normal_scroll_flush(c);
+            }
+            c->state.scroll.mode   = info->key;
+            c->state.scroll.count += info->count ? info->count : 1;
+            if (!c->state.scroll.tick_id) {
+                c->state.scroll.tick_id = gtk_widget_add_tick_callback(c->window,
+                        normal_scroll_tick, c, NULL);
+            }
+            break;
 
-    js = g_strdup_printf("vbscroll('%c',%d,%d);", info->key, c->config.scrollstep, info->count);
-    ext_proxy_eval_script(c, js, NULL);
-    g_free(js);
+        default:
+            /* Absolute positions must not overtake pending scrolls. */
+            normal_scroll_flush(c);
+            ext_proxy_scroll(c, info->key, c->config.scrollstep, info->count);
+            break;
+    }
 
     return RESULT_COMPLETE;
 }
 
+/**
+ * Sends the pending relative scroll to the web extension.
+ */
+static void normal_scroll_flush(Client *c)
+{
+    if (!c->state.scroll.mode) {
+        return;
+    }
+    ext_proxy_scroll(c, c->state.scroll.mode, c->config.scrollstep, c->state.scroll.count);
+    c->state.scroll.mode  = 0;
+    c->state.scroll.count = 0;
+}
+
+static gboolean normal_scroll_tick(GtkWidget *widget, GdkFrameClock *clock, gpointer data)
+{
+    Client *c = (Client*)data;
+
+    c->state.scroll.tick_id = 0;
+    normal_scroll_flush(c);
+
+    return G_SOURCE_REMOVE;
+}
+
 static VbResult normal_search(Client *c, const NormalCmdInfo *info)
 {
     int count = (info->count > 0) ? info->count : 1;
@@ -818,7 +858,9 @@ static VbResult normal_zoom(Client *c, const NormalCmdInfo *info)
 
     /* zz reset zoom to it's default zoom level */
     if (info->key2 == 'z') {
-        webkit_settings_set_zoom_text_only(webkit_web_view_get_settings(view), FALSE);
+        if (webkit_settings_get_zoom_text_only(webkit_web_view_get_settings(view))) {
+            webkit_settings_set_zoom_text_only(setting_webkit_settings(c), FALSE);
+        }
         webkit_web_view_set_zoom_level(view, c->config.default_zoom / 100.0);
 
         return RESULT_COMPLETE;
@@ -834,7 +876,9 @@ static VbResult normal_zoom(Client *c, const NormalCmdInfo *info)
     }
 
     /* apply the new zoom level */
-    webkit_settings_set_zoom_text_only(webkit_web_view_get_settings(view), VB_IS_LOWER(info->key2));
+    if (webkit_settings_get_zoom_text_only(webkit_web_view_get_settings(view)) != VB_IS_LOWER(info->key2)) {
+        webkit_settings_set_zoom_text_only(setting_webkit_settings(c), VB_IS_LOWER(info->key2));
+    }
     webkit_web_view_set_zoom_level(view, level);
 
     return RESULT_COMPLETE;
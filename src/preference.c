@@ -1,170 +1,223 @@
 #include "preference.h"
 #include "config.h"
-#include <ctype.h>
-#include <pthread.h>
-#include <stdlib.h>
+#include <stdio.h>
 #include <string.h>
-#include <sys/inotify.h>
 
-#define MAX_EVENTS 1024
-#define LEN_NAME 16
-#define EVENT_SIZE (sizeof(struct inotify_event))
-#define BUF_LEN (MAX_EVENTS * (EVENT_SIZE + LEN_NAME))
-#define FILE_BUF_LEN 256
+static void preference_color_parse(GKeyFile *kfile, const gchar *name,
+                                   GdkRGBA *color) {
+  gchar *value;
 
-void preference_color_parse(GKeyFile *kfile, gchar *name, GdkRGBA *color) {
-  GError *error = NULL;
-  gchar *value = malloc(sizeof(gchar) * 30);
-  gboolean parsed = FALSE;
-
-  g_strlcpy(value, g_key_file_get_value(kfile, "Preference", name, &error),
-            sizeof(gchar) * 30);
-  if (error == NULL) {
-    parsed = gdk_rgba_parse(color, value);
-    if (parsed != TRUE) {
-      fprintf(stderr, "could not parse the %s.", name);
-      exit(EXIT_FAILURE);
+  value = g_key_file_get_value(kfile, "Preference", name, NULL);
+  if (value) {
+    if (!gdk_rgba_parse(color, value)) {
+      fprintf(stderr, "could not parse the %s.\n", name);
     }
+    g_free(value);
+  }
+}
+
+static void preference_string_parse(GKeyFile *kfile, const gchar *name,
+                                    char *buf, gsize len) {
+  gchar *value;
+
+  value = g_key_file_get_value(kfile, "Preference", name, NULL);
+  if (value) {
+    g_strlcpy(buf, value, len);
+    g_free(value);
   }
 }
 
-/* Parsing preference file contents */
-Preference *preference_parse(GFile *file) {
+/* Parsing preference file contents into the given preference. Fields not
+ * found in the file get the default values, so does a missing file. Returns
+ * FALSE if the file could not be parsed. */
+gboolean preference_parse(Preference *preference, const char *path) {
   GKeyFile *kfile;
   GError *error = NULL;
-  Preference *preference = malloc(sizeof(Preference));
-  gchar *font = malloc(sizeof(gchar) * 256);
-  gchar *font_size = malloc(sizeof(gchar)*30);
   gdouble opacity;
   gchar **palette;
-  gboolean parsed = FALSE;
+  gsize length;
 
   preference_apply_default(preference);
   kfile = g_key_file_new();
-  g_key_file_load_from_file(kfile, g_file_get_path(file), G_KEY_FILE_NONE,
-                            &error);
+  if (!g_key_file_load_from_file(kfile, path, G_KEY_FILE_NONE, &error)) {
+    gboolean missing = g_error_matches(error, G_FILE_ERROR, G_FILE_ERROR_NOENT);
 
-  if (error) {
-    fprintf(stderr, "could not parse the config file: %s\n", error->message);
-    exit(EXIT_FAILURE);
+    if (!missing) {
+      fprintf(stderr, "could not parse the config file: %s\n", error->message);
+    }
+    g_error_free(error);
+    g_key_file_free(kfile);
+    return missing;
   }
 
   preference_color_parse(kfile, "ColorBackground", &preference->background);
   preference_color_parse(kfile, "ColorForeground", &preference->foreground);
   preference_color_parse(kfile, "ColorCursor", &preference->cursor);
   preference_color_parse(kfile, "ColorBold", &preference->bold);
-  g_strlcpy(font,
-            g_key_file_get_value(kfile, "Preference", "FontFamily", &error),
-            sizeof(gchar) * 256);
-  if (error == NULL) {
-    preference->font_family = font;
-  }
+  preference_string_parse(kfile, "FontFamily", preference->font_family,
+                          sizeof(preference->font_family));
+  preference_string_parse(kfile, "FontSize", preference->font_size,
+                          sizeof(preference->font_size));
 
-  error = NULL;
-  g_strlcpy(font_size, g_key_file_get_value(kfile, "Preference", "FontSize", &error),
-            sizeof(gchar) * 30);
-  if (error == NULL) {
-    preference->font_size = font_size;
-  }
-
-  error = NULL;
   opacity = g_key_file_get_double(kfile, "Preference", "Opacity", &error);
   if (error == NULL) {
     preference->opacity = opacity;
+  } else {
+    g_clear_error(&error);
   }
 
-  error = NULL;
-  gsize palettes[16] = {sizeof(gchar) * 30};
   palette = g_key_file_get_string_list(kfile, "Preference", "ColorPalette",
-                                       palettes, &error);
-  if (error == NULL) {
-    for (int i = 0; i < 16; i++) {
-      parsed = gdk_rgba_parse(&preference->palette[i], palette[i]);
-      if (parsed != TRUE) {
-        fprintf(stderr, "could not parse the ColorPalette[%d].", i);
-        exit(EXIT_FAILURE);
+                                       &length, NULL);
+  if (palette) {
+    for (gsize i = 0; i < length && i < 16; i++) {
+      if (!gdk_rgba_parse(&preference->palette[i], palette[i])) {
+        fprintf(stderr, "could not parse the ColorPalette[%zu].\n", i);
       }
     }
+    g_strfreev(palette);
   }
-  return preference;
+
+  g_key_file_free(kfile);
+  return TRUE;
+}
+
+/* Returns the PREFERENCE_CHANGED_* flags of the gui parts that must be
+ * updated to get from the old to the new preference. */
+guint preference_diff(const Preference *old, const Preference *new) {
+  guint changed = 0;
+
+  /* The opacity is used as alpha of all the background colors. */
+  if (!gdk_rgba_equal(&old->background, &new->background) ||
+      old->opacity != new->opacity) {
+    changed |= PREFERENCE_CHANGED_BACKGROUND | PREFERENCE_CHANGED_CSS;
+  }
+  if (!gdk_rgba_equal(&old->foreground, &new->foreground) ||
+      !gdk_rgba_equal(&old->bold, &new->bold) ||
+      !gdk_rgba_equal(&old->palette[1], &new->palette[1]) ||
+      !gdk_rgba_equal(&old->palette[2], &new->palette[2]) ||
+      strcmp(old->font_family, new->font_family) ||
+      strcmp(old->font_size, new->font_size)) {
+    changed |= PREFERENCE_CHANGED_CSS;
+  }
+
+  return changed;
 }
 
 void preference_apply_default(Preference *preference) {
-  char *palette = malloc(sizeof(char) * 480);
-  char *color = malloc(sizeof(char) * 30);
-  char *color_c = NULL;
+  char palette[] = PREFERENCE_COLOR_PALETTE;
+  char *color, *color_c = NULL;
   int i = 0;
 
-  strcpy(palette, PREFERENCE_COLOR_PALETTE);
-
   gdk_rgba_parse(&preference->background, PREFERENCE_COLOR_BACKGROUND);
   gdk_rgba_parse(&preference->cursor, PREFERENCE_COLOR_CURSOR);
   gdk_rgba_parse(&preference->bold, PREFERENCE_COLOR_BOLD);
   gdk_rgba_parse(&preference->foreground, PREFERENCE_COLOR_FOREGROUND);
   preference->opacity = PREFERENCE_OPACITY;
-  preference->font_family = PREFERENCE_FONT_FAMILY;
-  preference->font_size = PREFERENCE_FONT_SIZE;
+  g_strlcpy(preference->font_family, PREFERENCE_FONT_FAMILY,
+            sizeof(preference->font_family));
+  g_strlcpy(preference->font_size, PREFERENCE_FONT_SIZE,
+            sizeof(preference->font_size));
 
-  strcpy(color, strtok_r(palette, ";", &color_c));
-
-  while (color != NULL && i < 15) {
+  color = strtok_r(palette, ";", &color_c);
+  while (color != NULL && i < 16) {
     gdk_rgba_parse(&preference->palette[i], color);
     i++;
     color = strtok_r(NULL, ";", &color_c);
   }
 }
 
-typedef struct {
-  // Or whatever information that you need
-  void (*ptr)(Preference *preference, void *args);
-  void *args;
-} preference_watch_args;
+/* Reads the file once the changes settled and calls the watch function if
+ * anything visible changed. */
+static gboolean preference_reload(gpointer data) {
+  PreferenceWatch *watch = data;
+  guint changed;
+
+  watch->timeout_id = 0;
 
-static void __preference_watch(GFileMonitor *monitor, GFile *file,
-                               GFile *other_file, GFileMonitorEvent event_type,
-                               gpointer args) {
-  preference_watch_args *targs = args;
-  Preference *preference;
+  /* Keep the current preference if the file is broken, it's likely still
+   * edited. */
+  if (!preference_parse(&watch->next, watch->path)) {
+    return G_SOURCE_REMOVE;
+  }
+  changed = preference_diff(&watch->current, &watch->next);
+  if (changed) {
+    watch->current = watch->next;
+    watch->func(&watch->current, changed, watch->args);
+  }
 
-  preference = preference_parse(file);
-  targs->ptr(preference, targs->args);
+  return G_SOURCE_REMOVE;
 }
 
-PreferenceWatch *
-preference_watch(void (*ptr)(Preference *preference, void *args), void *args) {
-  char *rc_path = malloc(sizeof(char) * 256);
+static void preference_on_changed(GFileMonitor *monitor, GFile *file,
+                                  GFile *other_file,
+                                  GFileMonitorEvent event_type,
+                                  gpointer data) {
+  PreferenceWatch *watch = data;
+
+  switch (event_type) {
+  case G_FILE_MONITOR_EVENT_CHANGED:
+  case G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT:
+  case G_FILE_MONITOR_EVENT_CREATED:
+  case G_FILE_MONITOR_EVENT_DELETED:
+  case G_FILE_MONITOR_EVENT_MOVED_IN:
+  case G_FILE_MONITOR_EVENT_RENAMED:
+    break;
+  default:
+    return;
+  }
+
+  /* One save of an editor fires several events - restart the timer on each
+   * of them and read the file once after the last. */
+  if (watch->timeout_id) {
+    g_source_remove(watch->timeout_id);
+  }
+  watch->timeout_id =
+      g_timeout_add(PREFERENCE_DEBOUNCE_MS, preference_reload, watch);
+}
+
+PreferenceWatch *preference_watch(PreferenceFunc func, void *args) {
   GFile *rc;
-  GError *error;
-  GCancellable *cancellable;
-  PreferenceWatch *watch = malloc(sizeof(PreferenceWatch));
-
-  preference_watch_args *targs = malloc(sizeof(*targs));
-  targs->ptr = ptr;
-  targs->args = args;
-
-  strcpy(rc_path, preference_file_path());
-  rc = g_file_new_for_path(rc_path);
-  cancellable = g_cancellable_new();
-  watch->monitor = g_file_monitor(rc, G_FILE_MONITOR_NONE, cancellable, &error);
-  __preference_watch(watch->monitor, rc, NULL, G_FILE_MONITOR_EVENT_CHANGED,
-                     targs);
+  GError *error = NULL;
+  PreferenceWatch *watch = g_slice_new0(PreferenceWatch);
+
+  watch->func = func;
+  watch->args = args;
+  watch->path = preference_file_path();
+
+  /* Apply the current preference right away. */
+  preference_parse(&watch->current, watch->path);
+  func(&watch->current, PREFERENCE_CHANGED_ALL, args);
+
+  rc = g_file_new_for_path(watch->path);
+  watch->monitor = g_file_monitor(rc, G_FILE_MONITOR_NONE, NULL, &error);
+  g_object_unref(rc);
   if (error) {
     fprintf(stderr, "could not watch preference file: %s\n", error->message);
-    exit(EXIT_FAILURE);
+    g_error_free(error);
+    return watch;
   }
-  g_signal_connect(watch->monitor, "changed", G_CALLBACK(__preference_watch),
-                   targs);
+  g_signal_connect(watch->monitor, "changed",
+                   G_CALLBACK(preference_on_changed), watch);
   return watch;
 }
 
 gboolean preference_watch_cancel(PreferenceWatch *watch) {
-  return g_file_monitor_cancel(watch->monitor);
+  if (watch->timeout_id) {
+    g_source_remove(watch->timeout_id);
+    watch->timeout_id = 0;
+  }
+  return watch->monitor ? g_file_monitor_cancel(watch->monitor) : TRUE;
+}
+
+void preference_watch_free(PreferenceWatch *watch) {
+  preference_watch_cancel(watch);
+  g_clear_object(&watch->monitor);
+  g_free(watch->path);
+  g_slice_free(PreferenceWatch, watch);
 }
 
-char *preference_file_path() {
-  char *rc_path = malloc(sizeof(char) * 256);
-  char *config_dir = malloc(sizeof(char) * 256);
-  strcpy(config_dir, g_get_user_config_dir());
-  strcpy(rc_path, strcat(config_dir, "/vimb/preferencerc"));
-  return rc_path;
+/* Returns the newly allocated path of the preferencerc file. */
+char *preference_file_path(void) {
+  return g_build_filename(g_get_user_config_dir(), "vimb", "preferencerc",
+                          NULL);
 }
@@ -1,8 +1,14 @@
 #include <gdk/gdk.h>
+#include <gio/gio.h>
 
-typedef struct {
-    GFileMonitor *monitor;
-} PreferenceWatch;
+#define PREFERENCE_FONT_FAMILY_LEN 256
+#define PREFERENCE_FONT_SIZE_LEN 30
+
+/* Flags of the parts of the gui that depend on changed preference fields. */
+#define PREFERENCE_CHANGED_CSS        (1 << 0)
+#define PREFERENCE_CHANGED_BACKGROUND (1 << 1)
+#define PREFERENCE_CHANGED_ALL                                                 \
+  (PREFERENCE_CHANGED_CSS | PREFERENCE_CHANGED_BACKGROUND)
 
 typedef struct{
   GdkRGBA background;
@@ -11,17 +17,33 @@ typedef struct{
   GdkRGBA palette[16];
   GdkRGBA bold;
   double opacity;
-  char *font_family;
-  char *font_size;
+  char font_family[PREFERENCE_FONT_FAMILY_LEN];
+  char font_size[PREFERENCE_FONT_SIZE_LEN];
 } Preference;
 
-PreferenceWatch *preference_watch(void (*ptr)(Preference *preference, void *args),
-                           void *args);
+typedef void (*PreferenceFunc)(Preference *preference, guint changed,
+                               void *args);
 
-Preference *preference_parse(GFile *f);
+typedef struct {
+    GFileMonitor *monitor;
+    char *path;
+    guint timeout_id;        /* pending debounced reload */
+    PreferenceFunc func;
+    void *args;
+    Preference current;      /* preference applied last */
+    Preference next;         /* reused buffer for parsing */
+} PreferenceWatch;
+
+PreferenceWatch *preference_watch(PreferenceFunc func, void *args);
+
+gboolean preference_parse(Preference *preference, const char *path);
+
+guint preference_diff(const Preference *old, const Preference *new);
 
 void preference_apply_default(Preference *preference);
 
-char * preference_file_path();
+char *preference_file_path(void);
 
 gboolean preference_watch_cancel(PreferenceWatch *watch);
+
+void preference_watch_free(PreferenceWatch *watch);
@@ -0,0 +1,409 @@
+/**
+ * vimb - a webkit based vim like browser.
+ *
+ * Copyright (C) 2012-2018 Daniel Carl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+#include "config.h"
+#ifdef FEATURE_REMOTE
+#include <errno.h>
+#include <gio/gio.h>
+#include <glib/gstdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "ex.h"
+#include "main.h"
+#include "remote.h"
+
+/* State of a single connection to the remote control socket. Commands given
+ * by 'cmd' lines are collected until the window is opened by 'open'. */
+typedef struct {
+    GSocketConnection *connection;
+    GDataInputStream  *input;
+    GSList            *cmds;
+    Client            *client;  /* client opened by this connection */
+} RemoteConn;
+
+static char *get_socket_path(void);
+static GSocketConnection *connect_socket(const char *path);
+static gboolean on_incoming(GSocketService *service,
+        GSocketConnection *connection, GObject *source, gpointer data);
+static void read_next_line(RemoteConn *rc);
+static void on_line_read(GObject *stream, GAsyncResult *result, gpointer data);
+static void process_line(RemoteConn *rc, char *line);
+static char *process_query(RemoteConn *rc, const char *what);
+static Client *get_client(RemoteConn *rc);
+static void reply(RemoteConn *rc, const char *format, ...) G_GNUC_PRINTF(2, 3);
+static void remote_conn_free(RemoteConn *rc);
+
+extern struct Vimb vb;
+
+static struct {
+    GSocketService *service;
+    char           *path;
+} remote;
+
+
+/**
+ * Starts the remote control socket for the current profile. Returns FALSE if
+ * the socket could not be created or another instance already serves it.
+ */
+gboolean remote_init(void)
+{
+    GSocketConnection *connection;
+    GSocketAddress *address;
+    GError *error = NULL;
+
+    remote.path = get_socket_path();
+    if (!remote.path) {
+        return FALSE;
+    }
+
+    /* Another instance is already listening - leave the socket alone. */
+    connection = connect_socket(remote.path);
+    if (connection) {
+        g_object_unref(connection);
+        g_clear_pointer(&remote.path, g_free);
+
+        return FALSE;
+    }
+
+    /* Remove stale socket left by an instance that did not exit cleanly. */
+    g_unlink(remote.path);
+
+    remote.service = g_socket_service_new();
+    address        = g_unix_socket_address_new(remote.path);
+    if (!g_socket_listener_add_address(G_SOCKET_LISTENER(remote.service),
+                address, G_SOCKET_TYPE_STREAM, G_SOCKET_PROTOCOL_DEFAULT,
+                NULL, NULL, &error)) {
+        g_warning("Could not create remote socket '%s': %s", remote.path, error->message);
+        g_error_free(error);
+        g_object_unref(address);
+        g_clear_object(&remote.service);
+        g_clear_pointer(&remote.path, g_free);
+
+        return FALSE;
+    }
+    g_object_unref(address);
+    g_chmod(remote.path, 0600);
+
+    g_signal_connect(remote.service, "incoming", G_CALLBACK(on_incoming), NULL);
+    g_socket_service_start(remote.service);
+
+    return TRUE;
+}
+
+/**
+ * Hands the given uri and ex commands over to an already running instance of
+ * the current profile. Returns TRUE if the running instance accepted the
+ * request, FALSE if there is none and the caller should start up itself.
+ */
+gboolean remote_forward(const char *uri, GSList *cmds)
+{
+    GSocketConnection *connection;
+    GDataInputStream *input;
+    GOutputStream *output;
+    GString *request;
+    GSList *l;
+    char *path, *line, *value;
+    guint replies;
+    gboolean result = FALSE;
+
+    path = get_socket_path();
+    if (!path) {
+        return FALSE;
+    }
+    connection = connect_socket(path);
+    g_free(path);
+    if (!connection) {
+        return FALSE;
+    }
+
+    request = g_string_new(NULL);
+    for (l = cmds; l; l = l->next) {
+        /* The protocol is line based so newlines can't be transferred. */
+        value = g_strdelimit(g_strdup(l->data), "\r\n", ' ');
+        g_string_append_printf(request, "cmd %s\n", value);
+        g_free(value);
+    }
+    if (uri) {
+        value = g_strdelimit(g_strdup(uri), "\r\n", ' ');
+        g_string_append_printf(request, "open %s\n", value);
+        g_free(value);
+    } else {
+        g_string_append(request, "open\n");
+    }
+
+    output = g_io_stream_get_output_stream(G_IO_STREAM(connection));
+    if (g_output_stream_write_all(output, request->str, request->len, NULL, NULL, NULL)) {
+        /* Each request line is answered by one reply line. The last one
+         * belongs to the open which decides about the success. */
+        input   = g_data_input_stream_new(g_io_stream_get_input_stream(G_IO_STREAM(connection)));
+        replies = g_slist_length(cmds) + 1;
+        while (replies--) {
+            line = g_data_input_stream_read_line(input, NULL, NULL, NULL);
+            if (!line) {
+                break;
+            }
+            if (!replies) {
+                result = !strcmp(line, "OK");
+            }
+            g_free(line);
+        }
+        g_object_unref(input);
+    }
+
+    g_string_free(request, TRUE);
+    g_io_stream_close(G_IO_STREAM(connection), NULL, NULL);
+    g_object_unref(connection);
+
+    return result;
+}
+
+/**
+ * Stops the remote control service and removes the socket file.
+ */
+void remote_cleanup(void)
+{
+    if (remote.service) {
+        g_socket_service_stop(remote.service);
+        g_socket_listener_close(G_SOCKET_LISTENER(remote.service));
+        g_clear_object(&remote.service);
+    }
+    if (remote.path) {
+        g_unlink(remote.path);
+        g_clear_pointer(&remote.path, g_free);
+    }
+}
+
+/**
+ * Returns the newly allocated path of the socket for the current profile
+ * $XDG_RUNTIME_DIR/vimb[/PROFILE]/socket. The directory is created if it does
+ * not exist.
+ */
+static char *get_socket_path(void)
+{
+    char *dir, *path;
+
+    if (vb.profile) {
+        dir = g_build_filename(g_get_user_runtime_dir(), PROJECT, vb.profile, NULL);
+    } else {
+        dir = g_build_filename(g_get_user_runtime_dir(), PROJECT, NULL);
+    }
+
+    /* Keep the socket private to the user. */
+    if (g_mkdir_with_parents(dir, 0700) == -1) {
+        g_warning("Could not create directory '%s': %s", dir, g_strerror(errno));
+        g_free(dir);
+
+        return NULL;
+    }
+    path = g_build_filename(dir, "socket", NULL);
+    g_free(dir);
+
+    return path;
+}
+
+static GSocketConnection *connect_socket(const char *path)
+{
+    GSocketClient *client;
+    GSocketAddress *address;
+    GSocketConnection *connection;
+
+    client     = g_socket_client_new();
+    address    = g_unix_socket_address_new(path);
+    /* Don't hang on an instance that does not answer. The timeout applies
+     * to the connect and to the I/O on the connection. */
+    g_socket_client_set_timeout(client, REMOTE_TIMEOUT);
+    connection = g_socket_client_connect(client, G_SOCKET_CONNECTABLE(address), NULL, NULL);
+
+    g_object_unref(address);
+    g_object_unref(client);
+
+    return connection;
+}
+
+static gboolean on_incoming(GSocketService *service,
+        GSocketConnection *connection, GObject *source, gpointer data)
+{
+    RemoteConn *rc = g_slice_new0(RemoteConn);
+
+    rc->connection = g_object_ref(connection);
+    rc->input      = g_data_input_stream_new(g_io_stream_get_input_stream(G_IO_STREAM(connection)));
+    read_next_line(rc);
+
+    return TRUE;
+}
+
+static void read_next_line(RemoteConn *rc)
+{
+    g_data_input_stream_read_line_async(rc->input, G_PRIORITY_DEFAULT, NULL,
+            on_line_read, rc);
+}
+
+static void on_line_read(GObject *stream, GAsyncResult *result, gpointer data)
+{
+    RemoteConn *rc = data;
+    char *line;
+
+    line = g_data_input_stream_read_line_finish(G_DATA_INPUT_STREAM(stream),
+            result, NULL, NULL);
+    if (!line) {
+        /* EOF or error - the peer has gone. */
+        remote_conn_free(rc);
+        return;
+    }
+
+    process_line(rc, line);
+    g_free(line);
+    read_next_line(rc);
+}
+
+/**
+ * Handles a single request line of the form 'command [argument]'.
+ *
+ * cmd {ex-command}   queue ex command to be run in the next opened window
+ * open [uri]         open new window with uri and queued ex commands
+ * ex {ex-command}    run ex command in the window opened by this connection
+ *                    or the most recent one
+ * query {what}       print uri, title, mode, clients or profile
+ */
+static void process_line(RemoteConn *rc, char *line)
+{
+    Client *c;
+    char *arg, *value;
+
+    arg = strchr(line, ' ');
+    if (arg) {
+        *arg++ = '\0';
+        g_strstrip(arg);
+    }
+
+    if (!strcmp(line, "cmd")) {
+        if (!arg || !*arg) {
+            reply(rc, "ERR missing command");
+            return;
+        }
+        rc->cmds = g_slist_append(rc->cmds, g_strdup(arg));
+        reply(rc, "OK");
+    } else if (!strcmp(line, "open")) {
+        rc->client = vb_window_open(arg && *arg ? arg : NULL, rc->cmds);
+        g_slist_free_full(rc->cmds, g_free);
+        rc->cmds = NULL;
+        reply(rc, "OK");
+    } else if (!strcmp(line, "ex")) {
+        if (!arg || !*arg) {
+            reply(rc, "ERR missing command");
+        } else if (!(c = get_client(rc))) {
+            reply(rc, "ERR no window");
+        } else if (ex_run_string(c, arg, FALSE) & CMD_SUCCESS) {
+            reply(rc, "OK");
+        } else {
+            reply(rc, "ERR command failed");
+        }
+    } else if (!strcmp(line, "query")) {
+        value = process_query(rc, arg);
+        if (value) {
+            reply(rc, "%s", value);
+            g_free(value);
+        } else {
+            reply(rc, "ERR unknown query");
+        }
+    } else {
+        reply(rc, "ERR unknown command");
+    }
+}
+
+static char *process_query(RemoteConn *rc, const char *what)
+{
+    Client *c;
+    guint count = 0;
+
+    if (!what) {
+        return NULL;
+    }
+    if (!strcmp(what, "clients")) {
+        for (c = vb.clients; c; c = c->next) {
+            count++;
+        }
+        return g_strdup_printf("%u", count);
+    }
+    if (!strcmp(what, "profile")) {
+        return g_strdup(vb.profile ? vb.profile : "");
+    }
+
+    if (!(c = get_client(rc))) {
+        return NULL;
+    }
+    if (!strcmp(what, "uri")) {
+        return g_strdup(c->state.uri ? c->state.uri : "");
+    }
+    if (!strcmp(what, "title")) {
+        return g_strdup(c->state.title ? c->state.title : "");
+    }
+    if (!strcmp(what, "mode")) {
+        return g_strdup_printf("%c", c->mode ? c->mode->id : 'n');
+    }
+
+    return NULL;
+}
+
+/**
+ * Returns the client opened by the connection if it still exists, else the
+ * most recently created client.
+ */
+static Client *get_client(RemoteConn *rc)
+{
+    Client *c;
+
+    if (rc->client) {
+        for (c = vb.clients; c; c = c->next) {
+            if (c == rc->client) {
+                return c;
+            }
+        }
+        rc->client = NULL;
+    }
+
+    return vb.clients;
+}
+
+static void reply(RemoteConn *rc, const char *format, ...)
+{
+    GOutputStream *output;
+    va_list args;
+    char *msg;
+
+    va_start(args, format);
+    msg = g_strdup_vprintf(format, args);
+    va_end(args);
+
+    output = g_io_stream_get_output_stream(G_IO_STREAM(rc->connection));
+    g_output_stream_write_all(output, msg, strlen(msg), NULL, NULL, NULL);
+    g_output_stream_write_all(output, "\n", 1, NULL, NULL, NULL);
+    g_free(msg);
+}
+
+static void remote_conn_free(RemoteConn *rc)
+{
+    g_io_stream_close(G_IO_STREAM(rc->connection), NULL, NULL);
+    g_object_unref(rc->input);
+    g_object_unref(rc->connection);
+    g_slist_free_full(rc->cmds, g_free);
+    g_slice_free(RemoteConn, rc);
+}
+#endif /* FEATURE_REMOTE */
@@ -0,0 +1,32 @@
+/**
+ * vimb - a webkit based vim like browser.
+ *
+ * Copyright (C) 2012-2018 Daniel Carl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+#ifndef _REMOTE_H
+#define _REMOTE_H
+
+#include "config.h"
+#ifdef FEATURE_REMOTE
+#include <glib.h>
+
+gboolean remote_init(void);
+gboolean remote_forward(const char *uri, GSList *cmds);
+void remote_cleanup(void);
+
+#endif /* FEATURE_REMOTE */
+#endif /* end of include guard: _REMOTE_H */
@@ -1,6 +1,6 @@
-/* TODO maybe it's better to inject this in the webview as method */
-/* and to call it if needed */
-var c = %d, on, nn, m = location.href.match(/(.*?)(\d+)(\D*)$/);
+// Function body called with the number c to add to the last number of the
+// uri.
+var on, nn, m = location.href.match(/(.*?)(\d+)(\D*)$/);
 if (m) {
     on = m[2];
     nn = String(Math.max(parseInt(on) + c, 0));
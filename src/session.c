@@ -0,0 +1,254 @@
+/**
+ * vimb - a webkit based vim like browser.
+ *
+ * Copyright (C) 2012-2018 Daniel Carl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+#include <string.h>
+
+#include "config.h"
+#include "main.h"
+#include "session.h"
+
+static void save(gboolean closed);
+static gboolean on_save_timeout(gpointer data);
+static void save_client(GKeyFile *kf, const char *group, Client *c);
+static gboolean restore_client(GKeyFile *kf, const char *group);
+
+extern struct Vimb vb;
+
+static struct {
+    guint    save_id;   /* pending save of the session */
+    GKeyFile *closed;   /* windows closed since the last save */
+    guint    closed_count;
+} session;
+
+
+/**
+ * Saves the session after a while. Further calls until then are merged into
+ * this save, so frequent changes like scrolling cause only one write.
+ */
+void session_schedule(void)
+{
+    if (!vb.files[FILES_SESSION] || session.save_id) {
+        return;
+    }
+    session.save_id = g_timeout_add_seconds(SESSION_SAVE_DELAY, on_save_timeout, NULL);
+}
+
+/**
+ * Writes the uri, scroll position and registers of all windows into the
+ * session file.
+ */
+void session_save(void)
+{
+    save(FALSE);
+}
+
+/**
+ * Removes a closed window from the session with the next save. If the last
+ * window is closed before that save, the windows closed in the meantime are
+ * kept in the session. This is the case if all windows are closed on logout
+ * or by the window manager.
+ */
+void session_client_closed(Client *c)
+{
+    char group[32];
+
+    if (!vb.files[FILES_SESSION]) {
+        return;
+    }
+    if (!session.closed) {
+        session.closed = g_key_file_new();
+    }
+    snprintf(group, sizeof(group), "closed%u", session.closed_count++);
+    save_client(session.closed, group, c);
+
+    if (vb.clients == c && !c->next) {
+        save(TRUE);
+    } else {
+        session_schedule();
+    }
+}
+
+/**
+ * Opens the windows of the saved session. The pages are not loaded before
+ * the windows get the focus. Returns the number of restored windows.
+ */
+guint session_restore(void)
+{
+    GKeyFile *kf;
+    char **groups;
+    gsize len, i;
+    guint count = 0;
+
+    if (!vb.files[FILES_SESSION]) {
+        return 0;
+    }
+
+    kf = g_key_file_new();
+    if (!g_key_file_load_from_file(kf, vb.files[FILES_SESSION], G_KEY_FILE_NONE, NULL)) {
+        g_key_file_free(kf);
+        return 0;
+    }
+
+    /* Groups are returned in the order of the file. */
+    groups = g_key_file_get_groups(kf, &len);
+    for (i = 0; i < len; i++) {
+        if (restore_client(kf, groups[i])) {
+            count++;
+        }
+    }
+    g_strfreev(groups);
+    g_key_file_free(kf);
+
+    return count;
+}
+
+/**
+ * Writes a pending save of the session. The windows closed since the last
+ * save are kept, as they are closed by the quit.
+ */
+void session_cleanup(void)
+{
+    if (session.save_id) {
+        save(TRUE);
+    }
+    if (session.closed) {
+        g_key_file_free(session.closed);
+        session.closed = NULL;
+    }
+}
+
+/**
+ * Writes the open windows into the session file. If closed is TRUE the
+ * windows closed since the last save are written before them.
+ */
+static void save(gboolean closed)
+{
+    GKeyFile *kf;
+    GError *error = NULL;
+    GSList *clients = NULL, *l;
+    Client *c;
+    char group[32];
+    guint i = 0;
+
+    if (session.save_id) {
+        g_source_remove(session.save_id);
+        session.save_id = 0;
+    }
+    /* The closed windows are only kept until the next save. */
+    if (closed && session.closed) {
+        kf = session.closed;
+    } else {
+        kf = g_key_file_new();
+        if (session.closed) {
+            g_key_file_free(session.closed);
+        }
+    }
+    session.closed       = NULL;
+    session.closed_count = 0;
+    if (!vb.files[FILES_SESSION]) {
+        g_key_file_free(kf);
+        return;
+    }
+
+    /* The newest client comes first, write the windows in the order they
+     * where opened so that the newest is restored last and gets the focus. */
+    for (c = vb.clients; c; c = c->next) {
+        clients = g_slist_prepend(clients, c);
+    }
+    for (l = clients; l; l = l->next) {
+        snprintf(group, sizeof(group), "window%u", i++);
+        save_client(kf, group, l->data);
+    }
+    g_slist_free(clients);
+
+    if (!g_key_file_save_to_file(kf, vb.files[FILES_SESSION], &error)) {
+        g_warning("Could not save session: %s", error->message);
+        g_error_free(error);
+    }
+    g_key_file_free(kf);
+}
+
+static gboolean on_save_timeout(gpointer data)
+{
+    session.save_id = 0;
+    save(FALSE);
+
+    return G_SOURCE_REMOVE;
+}
+
+static void save_client(GKeyFile *kf, const char *group, Client *c)
+{
+    GPtrArray *regs;
+    const char *uri;
+    guint i;
+
+    /* Windows that wait for the focus have not loaded their page yet. */
+    uri = c->state.session.uri ? c->state.session.uri : c->state.uri;
+    if (uri) {
+        g_key_file_set_string(kf, group, "uri", uri);
+    }
+    if (c->state.title) {
+        g_key_file_set_string(kf, group, "title", c->state.title);
+    }
+    g_key_file_set_uint64(kf, group, "scroll",
+            c->state.session.uri ? c->state.session.scroll_top : c->state.scroll_top);
+
+    /* Each register is saved with its name as first char. */
+    regs = g_ptr_array_new_with_free_func(g_free);
+    for (i = 0; i < REG_SIZE; i++) {
+        if (c->state.reg[i]) {
+            g_ptr_array_add(regs, g_strdup_printf("%c%s", REG_CHARS[i], c->state.reg[i]));
+        }
+    }
+    if (regs->len) {
+        g_key_file_set_string_list(kf, group, "registers",
+                (const char * const *)regs->pdata, regs->len);
+    }
+    g_ptr_array_free(regs, TRUE);
+}
+
+static gboolean restore_client(GKeyFile *kf, const char *group)
+{
+    Client *c;
+    char *uri, *title, **regs;
+    gsize len, i;
+
+    uri = g_key_file_get_string(kf, group, "uri", NULL);
+    if (!uri || !*uri) {
+        g_free(uri);
+        return FALSE;
+    }
+    title = g_key_file_get_string(kf, group, "title", NULL);
+
+    c = vb_window_restore(uri, title, vb.cmdargs);
+    c->state.session.scroll_top = g_key_file_get_uint64(kf, group, "scroll", NULL);
+
+    regs = g_key_file_get_string_list(kf, group, "registers", &len, NULL);
+    for (i = 0; regs && i < len; i++) {
+        if (*regs[i]) {
+            vb_register_add(c, regs[i][0], regs[i] + 1);
+        }
+    }
+
+    g_strfreev(regs);
+    g_free(title);
+    g_free(uri);
+
+    return TRUE;
+}
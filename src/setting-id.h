@@ -0,0 +1,123 @@
+/**
+ * vimb - a webkit based vim like browser.
+ *
+ * Copyright (C) 2012-2018 Daniel Carl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+#ifndef _SETTING_ID_H
+#define _SETTING_ID_H
+
+/* Table of all settings as S(id, name, type, default, setter, flags, data).
+ * The ids index the dense per client setting array, the other columns make
+ * up the builtin defaults in setting.c where the setters, flags and the
+ * config.h values of the defaults are known. The type is one of BOOLEAN,
+ * INTEGER or CHAR. Settings that are not available in the used webkit
+ * version keep their id but are not added, see setting_available(). */
+#define SETTING_LIST(S) \
+    S(SID_USER_AGENT, "user-agent", CHAR, "Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/605.1.15 (KHTML, like Gecko) Version/11.0 Safari/605.1.15 " PROJECT "/" VERSION, webkit, 0, "user-agent") \
+    S(SID_ACCELERATED_2D_CANVAS, "accelerated-2d-canvas", BOOLEAN, FALSE, webkit, 0, "enable-accelerated-2d-canvas") \
+    S(SID_ALLOW_FILE_ACCESS_FROM_FILE_URLS, "allow-file-access-from-file-urls", BOOLEAN, FALSE, webkit, 0, "allow-file-access-from-file-urls") \
+    S(SID_ALLOW_UNIVERSAL_ACCESS_FROM_FILE_URLS, "allow-universal-access-from-file-urls", BOOLEAN, FALSE, webkit, 0, "allow-universal-access-from-file-urls") \
+    S(SID_CARET, "caret", BOOLEAN, FALSE, webkit, 0, "enable-caret-browsing") \
+    S(SID_CURSIV_FONT, "cursiv-font", CHAR, "serif", webkit, 0, "cursive-font-family") \
+    S(SID_DARK_MODE, "dark-mode", BOOLEAN, FALSE, dark_mode, 0, NULL) \
+    S(SID_DEFAULT_CHARSET, "default-charset", CHAR, "utf-8", webkit, 0, "default-charset") \
+    S(SID_DEFAULT_FONT, "default-font", CHAR, "sans-serif", webkit, 0, "default-font-family") \
+    S(SID_DNS_PREFETCHING, "dns-prefetching", BOOLEAN, TRUE, webkit, 0, "enable-dns-prefetching") \
+    S(SID_FONT_SIZE, "font-size", INTEGER, SETTING_DEFAULT_FONT_SIZE, webkit, 0, "default-font-size") \
+    S(SID_FRAME_FLATTENING, "frame-flattening", BOOLEAN, FALSE, webkit, 0, "enable-frame-flattening") \
+    S(SID_GEOLOCATION, "geolocation", CHAR, "ask", geolocation, FLAG_NODUP, NULL) \
+    S(SID_HARDWARE_ACCELERATION_POLICY, "hardware-acceleration-policy", CHAR, "ondemand", hardware_acceleration_policy, FLAG_NODUP, NULL) \
+    S(SID_HEADER, "header", CHAR, "", headers, FLAG_LIST|FLAG_NODUP|FLAG_CLIENT, "header") \
+    S(SID_HINT_TIMEOUT, "hint-timeout", INTEGER, 1000, NULL, 0, NULL) \
+    S(SID_HINT_KEYS, "hint-keys", CHAR, SETTING_HINT_KEYS, NULL, 0, NULL) \
+    S(SID_HINT_FOLLOW_LAST, "hint-follow-last", BOOLEAN, TRUE, NULL, 0, NULL) \
+    S(SID_HINT_KEYS_SAME_LENGTH, "hint-keys-same-length", BOOLEAN, FALSE, NULL, 0, NULL) \
+    S(SID_HINT_MATCH_ELEMENT, "hint-match-element", BOOLEAN, TRUE, NULL, 0, NULL) \
+    S(SID_HTML5_DATABASE, "html5-database", BOOLEAN, TRUE, webkit, 0, "enable-html5-database") \
+    S(SID_HTML5_LOCAL_STORAGE, "html5-local-storage", BOOLEAN, TRUE, webkit, 0, "enable-html5-local-storage") \
+    S(SID_HYPERLINK_AUDITING, "hyperlink-auditing", BOOLEAN, FALSE, webkit, 0, "enable-hyperlink-auditing") \
+    S(SID_IMAGES, "images", BOOLEAN, TRUE, webkit, 0, "auto-load-images") \
+    S(SID_JAVASCRIPT_CAN_ACCESS_CLIPBOARD, "javascript-can-access-clipboard", BOOLEAN, FALSE, webkit, 0, "javascript-can-access-clipboard") \
+    S(SID_JAVASCRIPT_CAN_OPEN_WINDOWS_AUTOMATICALLY, "javascript-can-open-windows-automatically", BOOLEAN, FALSE, webkit, 0, "javascript-can-open-windows-automatically") \
+    S(SID_JAVASCRIPT_ENABLE_MARKUP, "javascript-enable-markup", BOOLEAN, TRUE, webkit, 0, "enable-javascript-markup") \
+    S(SID_MEDIA_PLAYBACK_ALLOWS_INLINE, "media-playback-allows-inline", BOOLEAN, TRUE, webkit, 0, "media-playback-allows-inline") \
+    S(SID_MEDIA_PLAYBACK_REQUIRES_USER_GESTURE, "media-playback-requires-user-gesture", BOOLEAN, FALSE, webkit, 0, "media-playback-requires-user-gesture") \
+    S(SID_MEDIA_STREAM, "media-stream", BOOLEAN, FALSE, webkit, 0, "enable-media-stream") \
+    S(SID_MEDIASOURCE, "mediasource", BOOLEAN, FALSE, webkit, 0, "enable-mediasource") \
+    S(SID_MINIMUM_FONT_SIZE, "minimum-font-size", INTEGER, 5, webkit, 0, "minimum-font-size") \
+    S(SID_MONOSPACE_FONT, "monospace-font", CHAR, "monospace", webkit, 0, "monospace-font-family") \
+    S(SID_MONOSPACE_FONT_SIZE, "monospace-font-size", INTEGER, SETTING_DEFAULT_MONOSPACE_FONT_SIZE, webkit, 0, "default-monospace-font-size") \
+    S(SID_NOTIFICATION, "notification", CHAR, "ask", notification, FLAG_NODUP, NULL) \
+    S(SID_OFFLINE_CACHE, "offline-cache", BOOLEAN, TRUE, webkit, 0, "enable-offline-web-application-cache") \
+    S(SID_PLUGINS, "plugins", BOOLEAN, TRUE, webkit, 0, "enable-plugins") \
+    S(SID_PREVENT_NEWWINDOW, "prevent-newwindow", BOOLEAN, FALSE, internal, FLAG_CLIENT_DATA, CLIENT_OFFSET(config.prevent_newwindow)) \
+    S(SID_PRINT_BACKGROUNDS, "print-backgrounds", BOOLEAN, TRUE, webkit, 0, "print-backgrounds") \
+    S(SID_SANS_SERIF_FONT, "sans-serif-font", CHAR, "sans-serif", webkit, 0, "sans-serif-font-family") \
+    S(SID_SCRIPTS, "scripts", BOOLEAN, TRUE, webkit, 0, "enable-javascript") \
+    S(SID_SERIF_FONT, "serif-font", CHAR, "serif", webkit, 0, "serif-font-family") \
+    S(SID_SITE_SPECIFIC_QUIRKS, "site-specific-quirks", BOOLEAN, FALSE, webkit, 0, "enable-site-specific-quirks") \
+    S(SID_SMOOTH_SCROLLING, "smooth-scrolling", BOOLEAN, FALSE, webkit, 0, "enable-smooth-scrolling") \
+    S(SID_SPATIAL_NAVIGATION, "spatial-navigation", BOOLEAN, FALSE, webkit, 0, "enable-spatial-navigation") \
+    S(SID_TABS_TO_LINKS, "tabs-to-links", BOOLEAN, TRUE, webkit, 0, "enable-tabs-to-links") \
+    S(SID_WEBAUDIO, "webaudio", BOOLEAN, FALSE, webkit, 0, "enable-webaudio") \
+    S(SID_WEBGL, "webgl", BOOLEAN, FALSE, webkit, 0, "enable-webgl") \
+    S(SID_WEBINSPECTOR, "webinspector", BOOLEAN, TRUE, webkit, 0, "enable-developer-extras") \
+    S(SID_XSS_AUDITOR, "xss-auditor", BOOLEAN, TRUE, webkit, 0, "enable-xss-auditor") \
+    S(SID_STYLESHEET, "stylesheet", BOOLEAN, TRUE, user_style, FLAG_CLIENT, NULL) \
+    S(SID_USER_SCRIPTS, "user-scripts", BOOLEAN, TRUE, user_scripts, FLAG_CLIENT, NULL) \
+    S(SID_COOKIE_ACCEPT, "cookie-accept", CHAR, SETTING_COOKIE_ACCEPT, cookie_accept, 0, NULL) \
+    S(SID_SCROLL_STEP, "scroll-step", INTEGER, 40, internal, FLAG_CLIENT_DATA, CLIENT_OFFSET(config.scrollstep)) \
+    S(SID_SCROLL_MULTIPLIER, "scroll-multiplier", INTEGER, 1, internal, FLAG_CLIENT_DATA, CLIENT_OFFSET(config.scrollmultiplier)) \
+    S(SID_HOME_PAGE, "home-page", CHAR, SETTING_HOME_PAGE, NULL, 0, NULL) \
+    S(SID_STATUS_BAR_SHOW_SETTINGS, "status-bar-show-settings", BOOLEAN, FALSE, internal, FLAG_CLIENT_DATA, CLIENT_OFFSET(config.statusbar_show_settings)) \
+    S(SID_HISTORY_MAX_ITEMS, "history-max-items", INTEGER, 2000, internal, 0, &vb.config.history_max) \
+    S(SID_EDITOR_COMMAND, "editor-command", CHAR, "x-terminal-emulator -e -vi '%s'", NULL, 0, NULL) \
+    S(SID_STRICT_SSL, "strict-ssl", BOOLEAN, TRUE, tls_policy, 0, NULL) \
+    S(SID_STATUS_BAR, "status-bar", BOOLEAN, TRUE, statusbar, FLAG_CLIENT, NULL) \
+    S(SID_TIMEOUTLEN, "timeoutlen", INTEGER, 1000, internal, FLAG_CLIENT_DATA, CLIENT_OFFSET(map.timeoutlen)) \
+    S(SID_INPUT_AUTOHIDE, "input-autohide", BOOLEAN, FALSE, input_autohide, FLAG_CLIENT_DATA, CLIENT_OFFSET(config.input_autohide)) \
+    S(SID_FULLSCREEN, "fullscreen", BOOLEAN, FALSE, fullscreen, FLAG_CLIENT, NULL) \
+    S(SID_SHOW_TITLEBAR, "show-titlebar", BOOLEAN, TRUE, window_decorate, FLAG_CLIENT, NULL) \
+    S(SID_DEFAULT_ZOOM, "default-zoom", INTEGER, 100, default_zoom, FLAG_CLIENT, NULL) \
+    S(SID_DOWNLOAD_PATH, "download-path", CHAR, SETTING_DOWNLOAD_PATH, NULL, 0, NULL) \
+    S(SID_DOWNLOAD_COMMAND, "download-command", CHAR, SETTING_DOWNLOAD_COMMAND, NULL, 0, NULL) \
+    S(SID_DOWNLOAD_USE_EXTERNAL, "download-use-external", BOOLEAN, FALSE, NULL, 0, NULL) \
+    S(SID_DOWNLOAD_SEGMENTS, "download-segments", INTEGER, SETTING_DOWNLOAD_SEGMENTS, NULL, 0, NULL) \
+    S(SID_INCSEARCH, "incsearch", BOOLEAN, FALSE, internal, FLAG_CLIENT_DATA, CLIENT_OFFSET(config.incsearch)) \
+    S(SID_SEARCH_MODE, "search-mode", CHAR, "literal", search_mode, FLAG_NODUP, NULL) \
+    S(SID_CLOSED_MAX_ITEMS, "closed-max-items", INTEGER, 10, internal, 0, &vb.config.closed_max) \
+    S(SID_SUSPEND_TIMEOUT, "suspend-timeout", INTEGER, SETTING_SUSPEND_TIMEOUT, NULL, 0, NULL) \
+    S(SID_X_HINT_COMMAND, "x-hint-command", CHAR, ":o <C-R>;", NULL, 0, NULL) \
+    S(SID_SPELL_CHECKING, "spell-checking", BOOLEAN, FALSE, webkit_spell_checking, 0, NULL) \
+    S(SID_SPELL_CHECKING_LANGUAGES, "spell-checking-languages", CHAR, "en_US", webkit_spell_checking_language, FLAG_LIST|FLAG_NODUP, NULL) \
+    S(SID_COMPLETION_CSS, "completion-css", CHAR, SETTING_COMPLETION_CSS, gui_style, 0, NULL) \
+    S(SID_COMPLETION_HOVER_CSS, "completion-hover-css", CHAR, SETTING_COMPLETION_HOVER_CSS, gui_style, 0, NULL) \
+    S(SID_COMPLETION_SELECTED_CSS, "completion-selected-css", CHAR, SETTING_COMPLETION_SELECTED_CSS, gui_style, 0, NULL) \
+    S(SID_INPUT_CSS, "input-css", CHAR, SETTING_INPUT_CSS, gui_style, 0, NULL) \
+    S(SID_INPUT_ERROR_CSS, "input-error-css", CHAR, SETTING_INPUT_ERROR_CSS, gui_style, 0, NULL) \
+    S(SID_STATUS_CSS, "status-css", CHAR, SETTING_STATUS_CSS, gui_style, 0, NULL) \
+    S(SID_STATUS_SSL_CSS, "status-ssl-css", CHAR, SETTING_STATUS_SSL_CSS, gui_style, 0, NULL) \
+    S(SID_STATUS_SSL_INVALID_CSS, "status-ssl-invalid-css", CHAR, SETTING_STATUS_SSL_INVLID_CSS, gui_style, 0, NULL)
+
+#define SETTING_ID_ENUM(id, name, type, value, setter, flags, data) id,
+typedef enum {
+    SETTING_LIST(SETTING_ID_ENUM)
+    SID_LAST
+} SettingId;
+#undef SETTING_ID_ENUM
+
+#endif /* end of include guard: _SETTING_ID_H */
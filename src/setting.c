@@ -17,8 +17,11 @@
  * along with this program. If not, see http://www.gnu.org/licenses/.
  */
 
+#include <gio/gio.h>
 #include <glib.h>
+#include <libsoup/soup.h>
 #include <string.h>
+#include <sys/stat.h>
 
 #include "../version.h"
 #include "completion.h"
@@ -28,6 +31,7 @@
 #include "setting.h"
 #include "scripts/scripts.h"
 #include "shortcut.h"
+#include "site.h"
 
 typedef enum {
     SETTING_SET,        /* :set option=value */
@@ -39,16 +43,63 @@ typedef enum {
 } SettingType;
 
 enum {
-    FLAG_LIST  = (1<<1),    /* setting contains a ',' separated list of values */
-    FLAG_NODUP = (1<<2),    /* don't allow duplicate strings within list values */
+    FLAG_LIST        = (1<<1),  /* setting contains a ',' separated list of values */
+    FLAG_NODUP       = (1<<2),  /* don't allow duplicate strings within list values */
+    FLAG_CLIENT      = (1<<3),  /* setter must be applied to every new client */
+    FLAG_CLIENT_DATA = (1<<4),  /* like FLAG_CLIENT but data is the offset of
+                                   the value within the client struct */
 };
 
-static int setting_set_value(Client *c, Setting *prop, void *value, SettingType type);
+#define CLIENT_OFFSET(member) GSIZE_TO_POINTER(G_STRUCT_OFFSET(Client, member))
+
+typedef gpointer (*UserContentNewFunc)(const char *source);
+
+/* A :set command with the name resolved and the value converted to the type
+ * of the setting. */
+struct SettingCmd {
+    SettingId    id;
+    SettingType  type;
+    SettingValue value;     /* unused for SETTING_GET and SETTING_TOGGLE */
+};
+
+/* Value of a setting of the client before a site setting replaced it. */
+typedef struct {
+    SettingId   id;
+    Setting     setting;
+} SiteSaved;
+
+/* Process wide cache of the user script or style object created from one of
+ * the files in vb.files. The object is shared by all user content managers
+ * and only recreated if the file was changed. */
+typedef struct {
+    int                file;    /* index into vb.files */
+    UserContentNewFunc create;
+    GDestroyNotify     unref;
+    GFileMonitor       *monitor;
+    gboolean           valid;   /* indicates if object reflects the file */
+    dev_t              dev;
+    ino_t              ino;
+    time_t             mtime;
+    gpointer           object;  /* NULL if the file could not be read */
+} UserContent;
+
+static void defaults_init(Client *c);
+static void client_apply(Client *c);
+static int setting_set_value(Client *c, SettingId id, void *value, SettingType type);
+static gboolean setting_value_equals(Setting *s, void *value);
+static void *setting_value_ptr(Setting *s);
+static void *setting_data(Client *c, Setting *s);
 static gboolean prepare_setting_value(Setting *prop, void *value, SettingType type, void **newvalue);
-static gboolean setting_add(Client *c, const char *name, DataType type, void *value,
-    SettingFunction setter, int flags, void *data);
+static gboolean setting_available(SettingId id);
+static gboolean setting_add(Client *c, SettingId id);
 static void setting_print(Client *c, Setting *s);
-static void setting_free(Setting *s);
+static void setting_clear(Setting *s);
+static const char *const *setting_choices(SettingId id);
+static void site_value_free(gpointer data);
+static void site_saved_clear(gpointer data);
+static void site_saved_copy(SiteSaved *saved, const Setting *s);
+static void site_saved_update(Client *c, SettingId id);
+static gboolean site_has_setting(const GArray *profile, SettingId id);
 
 static int cookie_accept(Client *c, const char *name, DataType type, void *value, void *data);
 static int dark_mode(Client *c, const char *name, DataType type, void *value, void *data);
@@ -60,9 +111,17 @@ static int hardware_acceleration_policy(Client *c, const char *name, DataType ty
 static int input_autohide(Client *c, const char *name, DataType type, void *value, void *data);
 static int internal(Client *c, const char *name, DataType type, void *value, void *data);
 static int notification(Client *c, const char *name, DataType type, void *value, void *data);
+static int search_mode(Client *c, const char *name, DataType type, void *value, void *data);
 static int headers(Client *c, const char *name, DataType type, void *value, void *data);
 static int user_scripts(Client *c, const char *name, DataType type, void *value, void *data);
 static int user_style(Client *c, const char *name, DataType type, void *value, void *data);
+static void attach_user_scripts(WebKitUserContentManager *ucm, gboolean enabled);
+static void attach_user_style(WebKitUserContentManager *ucm, gboolean enabled);
+static gpointer user_content_get(UserContent *uc);
+static void on_user_content_file_changed(GFileMonitor *monitor, GFile *file,
+        GFile *other, GFileMonitorEvent event, UserContent *uc);
+static gpointer user_script_new(const char *source);
+static gpointer user_style_new(const char *source);
 static int statusbar(Client *c, const char *name, DataType type, void *value, void *data);
 static int tls_policy(Client *c, const char *name, DataType type, void *value, void *data);
 static int webkit(Client *c, const char *name, DataType type, void *value, void *data);
@@ -72,115 +131,67 @@ static int window_decorate(Client *c, const char *name, DataType type, void *val
 
 extern struct Vimb vb;
 
+#define SETTING_VALUE_BOOLEAN(value) {.b = value}
+#define SETTING_VALUE_INTEGER(value) {.i = value}
+#define SETTING_VALUE_CHAR(value)    {.s = value}
+#define SETTING_BUILTIN(id, name, type, value, setter, flags, data) \
+    {name, TYPE_##type, SETTING_VALUE_##type(value), setter, flags, data},
+/* Builtin defaults of the settings indexed by their ids. */
+static const Setting builtin[SID_LAST] = {
+    SETTING_LIST(SETTING_BUILTIN)
+};
+#undef SETTING_BUILTIN
+#undef SETTING_VALUE_BOOLEAN
+#undef SETTING_VALUE_INTEGER
+#undef SETTING_VALUE_CHAR
+
+/* Global setting defaults shared by all clients. They are filled by the
+ * first client from the builtin defaults and its config file. Clients point
+ * to these settings until they change one of them. */
+static struct {
+    Setting        settings[SID_LAST];
+    GHashTable     *index;      /* setting ids by name */
+    WebKitSettings *webkit;     /* shared by all webviews without own changes */
+    gboolean       initialized;
+    gboolean       writing;     /* indicates that changes go to the defaults */
+    gboolean       sealed;      /* no more changes of the defaults */
+} defaults;
+
+/* Side effects of settings deferred until the end of a batch. */
+static struct {
+    guint    depth;
+    gboolean gui_style;     /* regenerate the gui style */
+} batch;
+
+/* Per-site settings of the :site command by host pattern. */
+static SiteTrie *sites;
+
+/* Allowed values of the settings that take one of some keywords. */
+static const char *const cookie_accept_values[] = {"always", "origin", "never", NULL};
+static const char *const hardware_acceleration_values[] = {"ondemand", "always", "never", NULL};
+static const char *const permission_values[] = {"always", "ask", "never", NULL};
+static const char *const search_mode_values[] = {"literal", "regex", "word", NULL};
+
+static UserContent user_script = {
+    FILES_SCRIPT, user_script_new, (GDestroyNotify)webkit_user_script_unref
+};
+static UserContent user_stylesheet = {
+    FILES_USER_STYLE, user_style_new, (GDestroyNotify)webkit_user_style_sheet_unref
+};
 
 void setting_init(Client *c)
 {
     int i;
-    gboolean on = TRUE, off = FALSE;
-
-    c->config.settings = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, (GDestroyNotify)setting_free);
-    setting_add(c, "user-agent", TYPE_CHAR, &"Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/605.1.15 (KHTML, like Gecko) Version/11.0 Safari/605.1.15 " PROJECT "/" VERSION, webkit, 0, "user-agent");
-    /* TODO use the real names for webkit settings */
-    i = 14;
-    setting_add(c, "accelerated-2d-canvas", TYPE_BOOLEAN, &off, webkit, 0, "enable-accelerated-2d-canvas");
-    setting_add(c, "allow-file-access-from-file-urls", TYPE_BOOLEAN, &off, webkit, 0, "allow-file-access-from-file-urls");
-    setting_add(c, "allow-universal-access-from-file-urls", TYPE_BOOLEAN, &off, webkit, 0, "allow-universal-access-from-file-urls");
-    setting_add(c, "caret", TYPE_BOOLEAN, &off, webkit, 0, "enable-caret-browsing");
-    setting_add(c, "cursiv-font", TYPE_CHAR, &"serif", webkit, 0, "cursive-font-family");
-    setting_add(c, "dark-mode", TYPE_BOOLEAN, &off, dark_mode, 0, NULL);
-    setting_add(c, "default-charset", TYPE_CHAR, &"utf-8", webkit, 0, "default-charset");
-    setting_add(c, "default-font", TYPE_CHAR, &"sans-serif", webkit, 0, "default-font-family");
-    setting_add(c, "dns-prefetching", TYPE_BOOLEAN, &on, webkit, 0, "enable-dns-prefetching");
-    i = SETTING_DEFAULT_FONT_SIZE;
-    setting_add(c, "font-size", TYPE_INTEGER, &i, webkit, 0, "default-font-size");
-    setting_add(c, "frame-flattening", TYPE_BOOLEAN, &off, webkit, 0, "enable-frame-flattening");
-    setting_add(c, "geolocation", TYPE_CHAR, &"ask", geolocation, FLAG_NODUP, NULL);
-    setting_add(c, "hardware-acceleration-policy", TYPE_CHAR, &"ondemand", hardware_acceleration_policy, FLAG_NODUP, NULL);
-    setting_add(c, "header", TYPE_CHAR, &"", headers, FLAG_LIST|FLAG_NODUP, "header");
-    i = 1000;
-    setting_add(c, "hint-timeout", TYPE_INTEGER, &i, NULL, 0, NULL);
-    setting_add(c, "hint-keys", TYPE_CHAR, &SETTING_HINT_KEYS, NULL, 0, NULL);
-    setting_add(c, "hint-follow-last", TYPE_BOOLEAN, &on, NULL, 0, NULL);
-    setting_add(c, "hint-keys-same-length", TYPE_BOOLEAN, &off, NULL, 0, NULL);
-    setting_add(c, "hint-match-element", TYPE_BOOLEAN, &on, NULL, 0, NULL);
-    setting_add(c, "html5-database", TYPE_BOOLEAN, &on, webkit, 0, "enable-html5-database");
-    setting_add(c, "html5-local-storage", TYPE_BOOLEAN, &on, webkit, 0, "enable-html5-local-storage");
-    setting_add(c, "hyperlink-auditing", TYPE_BOOLEAN, &off, webkit, 0, "enable-hyperlink-auditing");
-    setting_add(c, "images", TYPE_BOOLEAN, &on, webkit, 0, "auto-load-images");
-    setting_add(c, "javascript-can-access-clipboard", TYPE_BOOLEAN, &off, webkit, 0, "javascript-can-access-clipboard");
-    setting_add(c, "javascript-can-open-windows-automatically", TYPE_BOOLEAN, &off, webkit, 0, "javascript-can-open-windows-automatically");
-#if WEBKIT_CHECK_VERSION(2, 24, 0)
-    setting_add(c, "javascript-enable-markup", TYPE_BOOLEAN, &on, webkit, 0, "enable-javascript-markup");
-#endif
-    setting_add(c, "media-playback-allows-inline", TYPE_BOOLEAN, &on, webkit, 0, "media-playback-allows-inline");
-    setting_add(c, "media-playback-requires-user-gesture", TYPE_BOOLEAN, &off, webkit, 0, "media-playback-requires-user-gesture");
-    setting_add(c, "media-stream", TYPE_BOOLEAN, &off, webkit, 0, "enable-media-stream");
-    setting_add(c, "mediasource", TYPE_BOOLEAN, &off, webkit, 0, "enable-mediasource");
-    i = 5;
-    setting_add(c, "minimum-font-size", TYPE_INTEGER, &i, webkit, 0, "minimum-font-size");
-    setting_add(c, "monospace-font", TYPE_CHAR, &"monospace", webkit, 0, "monospace-font-family");
-    i = SETTING_DEFAULT_MONOSPACE_FONT_SIZE;
-    setting_add(c, "monospace-font-size", TYPE_INTEGER, &i, webkit, 0, "default-monospace-font-size");
-    setting_add(c, "notification", TYPE_CHAR, &"ask", notification, FLAG_NODUP, NULL);
-    setting_add(c, "offline-cache", TYPE_BOOLEAN, &on, webkit, 0, "enable-offline-web-application-cache");
-    setting_add(c, "plugins", TYPE_BOOLEAN, &on, webkit, 0, "enable-plugins");
-    setting_add(c, "prevent-newwindow", TYPE_BOOLEAN, &off, internal, 0, &c->config.prevent_newwindow);
-    setting_add(c, "print-backgrounds", TYPE_BOOLEAN, &on, webkit, 0, "print-backgrounds");
-    setting_add(c, "sans-serif-font", TYPE_CHAR, &"sans-serif", webkit, 0, "sans-serif-font-family");
-    setting_add(c, "scripts", TYPE_BOOLEAN, &on, webkit, 0, "enable-javascript");
-    setting_add(c, "serif-font", TYPE_CHAR, &"serif", webkit, 0, "serif-font-family");
-    setting_add(c, "site-specific-quirks", TYPE_BOOLEAN, &off, webkit, 0, "enable-site-specific-quirks");
-    setting_add(c, "smooth-scrolling", TYPE_BOOLEAN, &off, webkit, 0, "enable-smooth-scrolling");
-    setting_add(c, "spatial-navigation", TYPE_BOOLEAN, &off, webkit, 0, "enable-spatial-navigation");
-    setting_add(c, "tabs-to-links", TYPE_BOOLEAN, &on, webkit, 0, "enable-tabs-to-links");
-    setting_add(c, "webaudio", TYPE_BOOLEAN, &off, webkit, 0, "enable-webaudio");
-    setting_add(c, "webgl", TYPE_BOOLEAN, &off, webkit, 0, "enable-webgl");
-    setting_add(c, "webinspector", TYPE_BOOLEAN, &on, webkit, 0, "enable-developer-extras");
-    setting_add(c, "xss-auditor", TYPE_BOOLEAN, &on, webkit, 0, "enable-xss-auditor");
-
-    /* internal variables */
-    setting_add(c, "stylesheet", TYPE_BOOLEAN, &on, user_style, 0, NULL);
-    setting_add(c, "user-scripts", TYPE_BOOLEAN, &on, user_scripts, 0, NULL);
-    setting_add(c, "cookie-accept", TYPE_CHAR, &SETTING_COOKIE_ACCEPT, cookie_accept, 0, NULL);
-    i = 40;
-    setting_add(c, "scroll-step", TYPE_INTEGER, &i, internal, 0, &c->config.scrollstep);
-    i = 1;
-    setting_add(c, "scroll-multiplier", TYPE_INTEGER, &i, internal, 0, &c->config.scrollmultiplier);
-    setting_add(c, "home-page", TYPE_CHAR, &SETTING_HOME_PAGE, NULL, 0, NULL);
-    i = 2000;
-    setting_add(c, "status-bar-show-settings", TYPE_BOOLEAN, &off, internal, 0, &c->config.statusbar_show_settings);
-    /* TODO should be global and not overwritten by a new client */
-    setting_add(c, "history-max-items", TYPE_INTEGER, &i, internal, 0, &vb.config.history_max);
-    setting_add(c, "editor-command", TYPE_CHAR, &"x-terminal-emulator -e -vi '%s'", NULL, 0, NULL);
-    setting_add(c, "strict-ssl", TYPE_BOOLEAN, &on, tls_policy, 0, NULL);
-    setting_add(c, "status-bar", TYPE_BOOLEAN, &on, statusbar, 0, NULL);
-    i = 1000;
-    setting_add(c, "timeoutlen", TYPE_INTEGER, &i, internal, 0, &c->map.timeoutlen);
-    setting_add(c, "input-autohide", TYPE_BOOLEAN, &off, input_autohide, 0, &c->config.input_autohide);
-    setting_add(c, "fullscreen", TYPE_BOOLEAN, &off, fullscreen, 0, NULL);
-    setting_add(c, "show-titlebar", TYPE_BOOLEAN, &on, window_decorate, 0, NULL);
-    i = 100;
-    setting_add(c, "default-zoom", TYPE_INTEGER, &i, default_zoom, 0, NULL);
-    setting_add(c, "download-path", TYPE_CHAR, &SETTING_DOWNLOAD_PATH, NULL, 0, NULL);
-    setting_add(c, "download-command", TYPE_CHAR, &SETTING_DOWNLOAD_COMMAND, NULL, 0, NULL);
-    setting_add(c, "download-use-external", TYPE_BOOLEAN, &off, NULL, 0, NULL);
-    setting_add(c, "incsearch", TYPE_BOOLEAN, &off, internal, 0, &c->config.incsearch);
-    i = 10;
-    /* TODO should be global and not overwritten by a new client */
-    setting_add(c, "closed-max-items", TYPE_INTEGER, &i, internal, 0, &vb.config.closed_max);
-    setting_add(c, "x-hint-command", TYPE_CHAR, &":o <C-R>;", NULL, 0, NULL);
-    setting_add(c, "spell-checking", TYPE_BOOLEAN, &off, webkit_spell_checking, 0, NULL);
-    setting_add(c, "spell-checking-languages", TYPE_CHAR, &"en_US", webkit_spell_checking_language, FLAG_LIST|FLAG_NODUP, NULL);
-
-    /* gui style settings vimb */
-    setting_add(c, "completion-css", TYPE_CHAR, &SETTING_COMPLETION_CSS, gui_style, 0, NULL);
-    setting_add(c, "completion-hover-css", TYPE_CHAR, &SETTING_COMPLETION_HOVER_CSS, gui_style, 0, NULL);
-    setting_add(c, "completion-selected-css", TYPE_CHAR, &SETTING_COMPLETION_SELECTED_CSS, gui_style, 0, NULL);
-    setting_add(c, "input-css", TYPE_CHAR, &SETTING_INPUT_CSS, gui_style, 0, NULL);
-    setting_add(c, "input-error-css", TYPE_CHAR, &SETTING_INPUT_ERROR_CSS, gui_style, 0, NULL);
-    setting_add(c, "status-css", TYPE_CHAR, &SETTING_STATUS_CSS, gui_style, 0, NULL);
-    setting_add(c, "status-ssl-css", TYPE_CHAR, &SETTING_STATUS_SSL_CSS, gui_style, 0, NULL);
-    setting_add(c, "status-ssl-invalid-css", TYPE_CHAR, &SETTING_STATUS_SSL_INVLID_CSS, gui_style, 0, NULL);
+
+    /* Let the client use the shared defaults. */
+    for (i = 0; i < SID_LAST; i++) {
+        c->config.settings[i] = &defaults.settings[i];
+    }
+    if (defaults.initialized) {
+        client_apply(c);
+    } else {
+        defaults_init(c);
+    }
 
     /* initialize the shortcuts and set the default shortcuts */
     shortcut_add(c->config.shortcuts, "dl", "https://duckduckgo.com/html/?q=$0");
@@ -188,11 +199,130 @@ void setting_init(Client *c)
     shortcut_set_default(c->config.shortcuts, "dl");
 }
 
+/**
+ * Fills the global defaults with the builtin values. The setters are applied
+ * to the first client.
+ */
+static void defaults_init(Client *c)
+{
+    int i;
+
+    defaults.initialized = TRUE;
+    defaults.writing     = TRUE;
+    defaults.index       = g_hash_table_new(g_str_hash, g_str_equal);
+    defaults.webkit      = g_object_ref(webkit_web_view_get_settings(c->webview));
+
+    setting_batch_begin();
+    for (i = 0; i < SID_LAST; i++) {
+        if (setting_available(i)) {
+            setting_add(c, i);
+        }
+    }
+    setting_batch_end(c);
+    defaults.writing = FALSE;
+}
+
+/**
+ * Applies the settings that affect the client itself like its widgets to a
+ * new client. Settings with a global effect were already applied once for
+ * the defaults.
+ */
+static void client_apply(Client *c)
+{
+    Setting *s;
+    int i;
+
+    webkit_web_view_set_settings(c->webview, defaults.webkit);
+
+    setting_batch_begin();
+    for (i = 0; i < SID_LAST; i++) {
+        s = &defaults.settings[i];
+        if (s->setter && s->flags & (FLAG_CLIENT|FLAG_CLIENT_DATA)) {
+            s->setter(c, s->name, s->type, setting_value_ptr(s), setting_data(c, s));
+        }
+    }
+    setting_batch_end(c);
+}
+
+/**
+ * Starts the sourcing of the config file of the first client. The settings
+ * changed until setting_defaults_end() are stored in the global defaults
+ * instead of the client. Returns FALSE if the defaults are already sealed by
+ * an earlier client.
+ */
+gboolean setting_defaults_begin(void)
+{
+    defaults.writing = !defaults.sealed;
+
+    return defaults.writing;
+}
+
+/**
+ * Ends writing to the defaults. Further changes of the settings are copied
+ * into the client that made them.
+ */
+void setting_defaults_end(void)
+{
+    defaults.writing = FALSE;
+    defaults.sealed  = TRUE;
+}
+
+/**
+ * Starts a batch of setting changes. Expensive side effects of the settings
+ * like the regeneration of the gui style are deferred until the outermost
+ * batch is ended by setting_batch_end().
+ */
+void setting_batch_begin(void)
+{
+    batch.depth++;
+}
+
+/**
+ * Ends a batch of setting changes and applies the deferred side effects to
+ * given client.
+ */
+void setting_batch_end(Client *c)
+{
+    if (!batch.depth || --batch.depth) {
+        return;
+    }
+    if (batch.gui_style) {
+        batch.gui_style = FALSE;
+        vb_gui_style_update(c, NULL, NULL);
+    }
+}
+
+/**
+ * Runs a :set command given by the setting name with optional modifier and
+ * the value.
+ */
 VbCmdResult setting_run(Client *c, char *name, const char *param)
 {
+    SettingCmd *cmd;
+    VbCmdResult res;
+
+    if (!(cmd = setting_cmd_new(c, name, param))) {
+        return CMD_ERROR | CMD_KEEPINPUT;
+    }
+    res = setting_cmd_run(c, cmd);
+    setting_cmd_free(cmd);
+
+    return res;
+}
+
+/**
+ * Resolves the setting name and converts the value of a :set command once so
+ * that it can be run for several clients. Returns NULL if the setting does
+ * not exist or the value is missing.
+ */
+SettingCmd *setting_cmd_new(Client *c, char *name, const char *param)
+{
+    SettingCmd *cmd;
     SettingType type = SETTING_SET;
+    Setting *s;
+    gpointer id;
     char modifier;
-    int res, len;
+    int len;
 
     /* determine the type to names last char and param */
     len      = strlen(name);
@@ -217,57 +347,91 @@ VbCmdResult setting_run(Client *c, char *name, const char *param)
     }
 
     /* lookup a matching setting */
-    Setting *s = g_hash_table_lookup(c->config.settings, name);
-    if (!s) {
+    if (!g_hash_table_lookup_extended(defaults.index, name, NULL, &id)) {
         vb_echo(c, MSG_ERROR, TRUE, "Config '%s' not found", name);
-        return CMD_ERROR | CMD_KEEPINPUT;
+        return NULL;
     }
+    /* The type of a setting is the same for all clients. */
+    s = &defaults.settings[GPOINTER_TO_INT(id)];
 
-    if (type == SETTING_GET) {
-        setting_print(c, s);
-        return CMD_SUCCESS | CMD_KEEPINPUT;
+    if (type == SETTING_TOGGLE && s->type != TYPE_BOOLEAN) {
+        vb_echo(c, MSG_ERROR, TRUE, "Could not toggle none boolean %s", s->name);
+        return NULL;
+    }
+    if (type != SETTING_GET && type != SETTING_TOGGLE && !param) {
+        vb_echo(c, MSG_ERROR, TRUE, "No valid value");
+        return NULL;
     }
 
-    if (type == SETTING_TOGGLE) {
-        if (s->type != TYPE_BOOLEAN) {
-            vb_echo(c, MSG_ERROR, TRUE, "Could not toggle none boolean %s", s->name);
+    cmd       = g_slice_new0(SettingCmd);
+    cmd->id   = GPOINTER_TO_INT(id);
+    cmd->type = type;
+    if (type == SETTING_GET || type == SETTING_TOGGLE) {
+        return cmd;
+    }
 
-            return CMD_ERROR | CMD_KEEPINPUT;
-        }
-        gboolean value = !s->value.b;
-        res = setting_set_value(c, s, &value, SETTING_SET);
+    /* convert sting value into internal used data type */
+    switch (s->type) {
+        case TYPE_BOOLEAN:
+            cmd->value.b = g_ascii_strncasecmp(param, "true", 4) == 0
+                || g_ascii_strncasecmp(param, "on", 2) == 0;
+            break;
+
+        case TYPE_INTEGER:
+            cmd->value.i = g_ascii_strtoull(param, (char**)NULL, 10);
+            break;
+
+        default:
+            cmd->value.s = g_strdup(param);
+            break;
+    }
+
+    return cmd;
+}
+
+/**
+ * Applies a :set command created by setting_cmd_new() to the client.
+ */
+VbCmdResult setting_cmd_run(Client *c, const SettingCmd *cmd)
+{
+    Setting *s = c->config.settings[cmd->id];
+    SettingValue value = cmd->value;
+    void *ptr;
+    int res;
+
+    if (cmd->type == SETTING_GET) {
         setting_print(c, s);
+        return CMD_SUCCESS | CMD_KEEPINPUT;
+    }
+
+    if (cmd->type == SETTING_TOGGLE) {
+        value.b = !s->value.b;
+        res = setting_set_value(c, cmd->id, &value.b, SETTING_SET);
+        /* the client may got an own copy of the setting */
+        setting_print(c, c->config.settings[cmd->id]);
 
         /* make sure the new value set by the toggle keep visible */
         res |= CMD_KEEPINPUT;
     } else {
-        if (!param) {
-            vb_echo(c, MSG_ERROR, TRUE, "No valid value");
-
-            return CMD_ERROR | CMD_KEEPINPUT;
-        }
-
-        /* convert sting value into internal used data type */
-        gboolean boolvar;
-        int intvar;
         switch (s->type) {
             case TYPE_BOOLEAN:
-                boolvar = g_ascii_strncasecmp(param, "true", 4) == 0
-                    || g_ascii_strncasecmp(param, "on", 2) == 0;
-                res = setting_set_value(c, s, &boolvar, type);
+                ptr = &value.b;
                 break;
 
             case TYPE_INTEGER:
-                intvar = g_ascii_strtoull(param, (char**)NULL, 10);
-                res = setting_set_value(c, s, &intvar, type);
+                ptr = &value.i;
                 break;
 
             default:
-                res = setting_set_value(c, s, (void*)param, type);
+                ptr = value.s;
                 break;
         }
+        res = setting_set_value(c, cmd->id, ptr, cmd->type);
     }
 
+    if (res & CMD_SUCCESS) {
+        site_saved_update(c, cmd->id);
+    }
     if (res & (CMD_SUCCESS | CMD_KEEPINPUT)) {
         return res;
     }
@@ -276,11 +440,21 @@ VbCmdResult setting_run(Client *c, char *name, const char *param)
     return CMD_ERROR | CMD_KEEPINPUT;
 }
 
+void setting_cmd_free(SettingCmd *cmd)
+{
+    DataType type = defaults.settings[cmd->id].type;
+
+    if (type != TYPE_BOOLEAN && type != TYPE_INTEGER) {
+        g_free(cmd->value.s);
+    }
+    g_slice_free(SettingCmd, cmd);
+}
+
 gboolean setting_fill_completion(Client *c, GtkListStore *store, const char *input)
 {
     GtkTreeIter iter;
     gboolean found = FALSE;
-    GList *src     = g_hash_table_get_keys(c->config.settings);
+    GList *src     = g_hash_table_get_keys(defaults.index);
 
     /* If no filter input given - copy all entries into the data store. */
     if (!input || !*input) {
@@ -308,30 +482,260 @@ gboolean setting_fill_completion(Client *c, GtkListStore *store, const char *inp
     return found;
 }
 
+/**
+ * Attaches the user scripts and styles of the default settings to given user
+ * content manager of a webview that is not yet bound to a client.
+ */
+void setting_user_content_init(WebKitUserContentManager *ucm)
+{
+    attach_user_scripts(ucm, TRUE);
+    attach_user_style(ucm, TRUE);
+}
+
+/**
+ * Returns the webkit settings the client is allowed to change. As long as the
+ * defaults are written this is the shared settings object. Else the client
+ * gets an own copy of the shared settings on first change.
+ */
+WebKitSettings *setting_webkit_settings(Client *c)
+{
+    WebKitSettings *settings = webkit_web_view_get_settings(c->webview);
+    GParamSpec **specs;
+    GValue value = G_VALUE_INIT;
+    guint i, n;
+
+    if (defaults.writing || settings != defaults.webkit) {
+        return settings;
+    }
+
+    settings = webkit_settings_new();
+    specs    = g_object_class_list_properties(G_OBJECT_GET_CLASS(defaults.webkit), &n);
+    for (i = 0; i < n; i++) {
+        if ((specs[i]->flags & G_PARAM_READWRITE) != G_PARAM_READWRITE
+            || specs[i]->flags & G_PARAM_CONSTRUCT_ONLY) {
+            continue;
+        }
+        g_value_init(&value, specs[i]->value_type);
+        g_object_get_property(G_OBJECT(defaults.webkit), specs[i]->name, &value);
+        g_object_set_property(G_OBJECT(settings), specs[i]->name, &value);
+        g_value_unset(&value);
+    }
+    g_free(specs);
+
+    webkit_web_view_set_settings(c->webview, settings);
+    g_object_unref(settings);
+
+    return settings;
+}
+
+/**
+ * Adds a setting for all pages of the hosts matched by pattern. Like for
+ * :set the param is converted to the type of the setting, but only once
+ * here and not on each navigation.
+ */
+VbCmdResult setting_site_add(Client *c, const char *pattern, char *name, const char *param)
+{
+    const char *const *choices;
+    Setting *value;
+    gpointer id;
+    char *end, *list;
+
+    if (!g_hash_table_lookup_extended(defaults.index, name, NULL, &id)) {
+        vb_echo(c, MSG_ERROR, TRUE, "Config '%s' not found", name);
+        return CMD_ERROR | CMD_KEEPINPUT;
+    }
+    if (!param) {
+        vb_echo(c, MSG_ERROR, TRUE, "No valid value");
+        return CMD_ERROR | CMD_KEEPINPUT;
+    }
+
+    /* Check the value now, an invalid rule would else only be noticed on a
+     * navigation to the site. */
+    value       = g_slice_new0(Setting);
+    value->name = defaults.settings[GPOINTER_TO_INT(id)].name;
+    value->type = defaults.settings[GPOINTER_TO_INT(id)].type;
+    switch (value->type) {
+        case TYPE_BOOLEAN:
+            if (!g_ascii_strcasecmp(param, "true") || !g_ascii_strcasecmp(param, "on")) {
+                value->value.b = TRUE;
+            } else if (!g_ascii_strcasecmp(param, "false") || !g_ascii_strcasecmp(param, "off")) {
+                value->value.b = FALSE;
+            } else {
+                vb_echo(c, MSG_ERROR, TRUE, "%s must be in [true, false, on, off]", value->name);
+                goto error;
+            }
+            break;
+
+        case TYPE_INTEGER:
+            value->value.i = g_ascii_strtoll(param, &end, 10);
+            if (end == param || *end) {
+                vb_echo(c, MSG_ERROR, TRUE, "%s must be a number", value->name);
+                goto error;
+            }
+            break;
+
+        default:
+            choices = setting_choices(GPOINTER_TO_INT(id));
+            if (choices && !g_strv_contains(choices, param)) {
+                list = g_strjoinv(", ", (char**)choices);
+                vb_echo(c, MSG_ERROR, TRUE, "%s must be in [%s]", value->name, list);
+                g_free(list);
+                goto error;
+            }
+            value->value.s = g_strdup(param);
+            break;
+    }
+
+    if (!sites) {
+        sites = site_trie_new(site_value_free);
+    }
+    /* The trie takes the value also for an invalid pattern. */
+    if (!site_trie_add(sites, pattern, GPOINTER_TO_INT(id), value)) {
+        vb_echo(c, MSG_ERROR, TRUE, "Invalid host pattern '%s'", pattern);
+        return CMD_ERROR | CMD_KEEPINPUT;
+    }
+
+    return CMD_SUCCESS;
+
+error:
+    site_value_free(value);
+    return CMD_ERROR | CMD_KEEPINPUT;
+}
+
+/**
+ * Applies the site settings for the host of uri to the client. Settings
+ * that were changed for the previous site but not for this are set back.
+ * Nothing is done if the host has the same site settings as the previous
+ * one, and only values that differ from the current ones are passed to the
+ * setters.
+ */
+void setting_site_apply(Client *c, const char *uri)
+{
+    const GArray *profile = NULL;
+    SoupURI *suri;
+    SiteSaved *saved, entry;
+    SiteRule *rule;
+    Setting *value;
+    guint i, j, generation = 0;
+
+    /* Site settings must not get into the defaults. */
+    if (defaults.writing) {
+        return;
+    }
+    if (sites) {
+        generation = site_trie_get_generation(sites);
+        if ((suri = soup_uri_new(uri))) {
+            profile = site_trie_lookup(sites, soup_uri_get_host(suri));
+            soup_uri_free(suri);
+        }
+    }
+    if (profile == c->state.site.profile && generation == c->state.site.generation) {
+        return;
+    }
+    c->state.site.profile    = profile;
+    c->state.site.generation = generation;
+
+    if (!c->state.site.saved) {
+        c->state.site.saved = g_array_new(FALSE, FALSE, sizeof(SiteSaved));
+        g_array_set_clear_func(c->state.site.saved, site_saved_clear);
+    }
+
+    /* The batch skips values equal to the current ones. */
+    setting_batch_begin();
+    for (i = c->state.site.saved->len; i > 0; i--) {
+        saved = &g_array_index(c->state.site.saved, SiteSaved, i - 1);
+        if (!site_has_setting(profile, saved->id)) {
+            setting_set_value(c, saved->id, setting_value_ptr(&saved->setting), SETTING_SET);
+            g_array_remove_index_fast(c->state.site.saved, i - 1);
+        }
+    }
+    for (i = 0; profile && i < profile->len; i++) {
+        rule  = &g_array_index(profile, SiteRule, i);
+        value = (Setting*)rule->value;
+
+        /* Keep the value the site setting replaces for the first site that
+         * changes it. */
+        for (j = 0; j < c->state.site.saved->len; j++) {
+            if (g_array_index(c->state.site.saved, SiteSaved, j).id == rule->key) {
+                break;
+            }
+        }
+        if (j == c->state.site.saved->len) {
+            entry.id = rule->key;
+            site_saved_copy(&entry, c->config.settings[rule->key]);
+            g_array_append_val(c->state.site.saved, entry);
+        }
+        setting_set_value(c, rule->key, setting_value_ptr(value), SETTING_SET);
+    }
+    setting_batch_end(c);
+}
+
+/**
+ * Frees the settings the client changed for itself. The defaults are kept for
+ * the other clients.
+ */
 void setting_cleanup(Client *c)
 {
-    if (c->config.settings) {
-        g_hash_table_destroy(c->config.settings);
-        c->config.settings = NULL;
+    int i;
+
+    for (i = 0; i < SID_LAST; i++) {
+        if (c->config.settings[i] && c->config.settings[i] != &defaults.settings[i]) {
+            setting_clear(c->config.settings[i]);
+            g_slice_free(Setting, c->config.settings[i]);
+        }
+        c->config.settings[i] = NULL;
     }
+    if (c->state.site.saved) {
+        g_array_free(c->state.site.saved, TRUE);
+        c->state.site.saved = NULL;
+    }
+    g_clear_pointer(&c->state.site.navigation, g_free);
 }
 
-static int setting_set_value(Client *c, Setting *prop, void *value, SettingType type)
+static int setting_set_value(Client *c, SettingId id, void *value, SettingType type)
 {
     int res = CMD_SUCCESS;
+    Setting *prop = c->config.settings[id];
     /* by default given value is also the new value */
     void *newvalue = NULL;
-    gboolean free_newvalue;
+    gboolean free_newvalue, copied = FALSE;
+
+    /* the slots of unavailable settings are never filled */
+    if (!prop->name) {
+        return CMD_ERROR | CMD_KEEPINPUT;
+    }
 
     /* get prepared value according to setting type */
     free_newvalue = prepare_setting_value(prop, value, type, &newvalue);
 
+    /* Sourced files often repeat the values the client already has, so skip
+     * the setter for them. */
+    if (batch.depth && !defaults.writing && setting_value_equals(prop, newvalue)) {
+        goto free;
+    }
+
+    /* Copy the setting on first change so that the other clients keep the
+     * default. */
+    if (!defaults.writing && prop == &defaults.settings[id]) {
+        prop = g_slice_dup(Setting, prop);
+        if (prop->type == TYPE_CHAR || prop->type == TYPE_COLOR || prop->type == TYPE_FONT) {
+            prop->value.s = g_strdup(prop->value.s);
+        }
+        c->config.settings[id] = prop;
+        copied = TRUE;
+    }
+
     /* if there is a setter defined - call this first to check if the value is
      * accepted */
     if (prop->setter) {
-        res = prop->setter(c, prop->name, prop->type, newvalue, prop->data);
+        res = prop->setter(c, prop->name, prop->type, newvalue, setting_data(c, prop));
         /* break here on error and don't change the setting */
         if (res & CMD_ERROR) {
+            if (copied) {
+                c->config.settings[id] = &defaults.settings[id];
+                setting_clear(prop);
+                g_slice_free(Setting, prop);
+            }
             goto free;
         }
     }
@@ -358,6 +762,46 @@ free:
     return res;
 }
 
+static gboolean setting_value_equals(Setting *s, void *value)
+{
+    switch (s->type) {
+        case TYPE_BOOLEAN:
+            return !s->value.b == !*((gboolean*)value);
+
+        case TYPE_INTEGER:
+            return s->value.i == *((int*)value);
+
+        default:
+            return !g_strcmp0(s->value.s, (char*)value);
+    }
+}
+
+static void *setting_value_ptr(Setting *s)
+{
+    switch (s->type) {
+        case TYPE_BOOLEAN:
+            return &s->value.b;
+
+        case TYPE_INTEGER:
+            return &s->value.i;
+
+        default:
+            return s->value.s;
+    }
+}
+
+/**
+ * Returns the data given to the setter of the setting. For settings stored
+ * in the client this is the address of the field within given client.
+ */
+static void *setting_data(Client *c, Setting *s)
+{
+    if (s->flags & FLAG_CLIENT_DATA) {
+        return (char*)c + GPOINTER_TO_SIZE(s->data);
+    }
+    return s->data;
+}
+
 /**
  * Prepares the value for the setting for the different setting types.
  * Return value TRUE indicates that the memory of newvalue must be freed by
@@ -465,19 +909,41 @@ static gboolean prepare_setting_value(Setting *prop, void *value, SettingType ty
     return res;
 }
 
-static gboolean setting_add(Client *c, const char *name, DataType type, void *value,
-        SettingFunction setter, int flags, void *data)
+/**
+ * Returns TRUE if the setting is supported by the used webkit version. The
+ * slots of the other settings are left empty.
+ */
+static gboolean setting_available(SettingId id)
 {
-    Setting *prop = g_slice_new0(Setting);
-    prop->name   = name;
-    prop->type   = type;
-    prop->setter = setter;
-    prop->flags  = flags;
-    prop->data   = data;
-
-    setting_set_value(c, prop, value, SETTING_SET);
+#if !WEBKIT_CHECK_VERSION(2, 24, 0)
+    if (id == SID_JAVASCRIPT_ENABLE_MARKUP) {
+        return FALSE;
+    }
+#endif
+    return TRUE;
+}
 
-    g_hash_table_insert(c->config.settings, (char*)name, prop);
+/**
+ * Adds the setting with its builtin default to the defaults.
+ */
+static gboolean setting_add(Client *c, SettingId id)
+{
+    Setting *prop = &defaults.settings[id];
+    SettingValue value = builtin[id].value;
+
+    prop->name   = builtin[id].name;
+    prop->type   = builtin[id].type;
+    prop->setter = builtin[id].setter;
+    prop->flags  = builtin[id].flags;
+    prop->data   = builtin[id].data;
+
+    setting_set_value(c, id,
+            prop->type == TYPE_BOOLEAN ? (void*)&value.b
+            : prop->type == TYPE_INTEGER ? (void*)&value.i
+            : (void*)value.s,
+            SETTING_SET);
+
+    g_hash_table_insert(defaults.index, (char*)prop->name, GINT_TO_POINTER(id));
     return TRUE;
 }
 
@@ -498,12 +964,88 @@ static void setting_print(Client *c, Setting *s)
     }
 }
 
-static void setting_free(Setting *s)
+static void setting_clear(Setting *s)
 {
     if (s->type == TYPE_CHAR || s->type == TYPE_COLOR || s->type == TYPE_FONT) {
         g_free(s->value.s);
     }
-    g_slice_free(Setting, s);
+    memset(s, 0, sizeof(Setting));
+}
+
+/**
+ * Returns the NULL terminated list of values allowed for the setting or NULL
+ * if the setting is not restricted to some keywords.
+ */
+static const char *const *setting_choices(SettingId id)
+{
+    switch (id) {
+        case SID_COOKIE_ACCEPT:
+            return cookie_accept_values;
+
+        case SID_HARDWARE_ACCELERATION_POLICY:
+            return hardware_acceleration_values;
+
+        case SID_GEOLOCATION:
+        case SID_NOTIFICATION:
+            return permission_values;
+
+        case SID_SEARCH_MODE:
+            return search_mode_values;
+
+        default:
+            return NULL;
+    }
+}
+
+static void site_value_free(gpointer data)
+{
+    setting_clear((Setting*)data);
+    g_slice_free(Setting, data);
+}
+
+static void site_saved_clear(gpointer data)
+{
+    setting_clear(&((SiteSaved*)data)->setting);
+}
+
+static void site_saved_copy(SiteSaved *saved, const Setting *s)
+{
+    saved->setting = *s;
+    if (s->type == TYPE_CHAR || s->type == TYPE_COLOR || s->type == TYPE_FONT) {
+        saved->setting.value.s = g_strdup(s->value.s);
+    }
+}
+
+/**
+ * Takes the value of a setting the user changed while a site setting
+ * replaces it as the value to set back when the site is left.
+ */
+static void site_saved_update(Client *c, SettingId id)
+{
+    SiteSaved *saved;
+    guint i;
+
+    for (i = 0; c->state.site.saved && i < c->state.site.saved->len; i++) {
+        saved = &g_array_index(c->state.site.saved, SiteSaved, i);
+        if (saved->id == id) {
+            setting_clear(&saved->setting);
+            site_saved_copy(saved, c->config.settings[id]);
+            return;
+        }
+    }
+}
+
+static gboolean site_has_setting(const GArray *profile, SettingId id)
+{
+    guint i;
+
+    /* Profiles hold only a few settings. */
+    for (i = 0; profile && i < profile->len; i++) {
+        if (g_array_index(profile, SiteRule, i).key == id) {
+            return TRUE;
+        }
+    }
+    return FALSE;
 }
 
 static int cookie_accept(Client *c, const char *name, DataType type, void *value, void *data)
@@ -541,8 +1083,11 @@ static int default_zoom(Client *c, const char *name, DataType type, void *value,
     /* Store the percent value in the client config. */
     c->config.default_zoom = *(int*)value;
 
-    /* Apply the default zoom to the webview. */
-    webkit_settings_set_zoom_text_only(webkit_web_view_get_settings(c->webview), FALSE);
+    /* Apply the default zoom to the webview. Only a client that zoomed the
+     * text only needs its own webkit settings to reset this. */
+    if (webkit_settings_get_zoom_text_only(webkit_web_view_get_settings(c->webview))) {
+        webkit_settings_set_zoom_text_only(setting_webkit_settings(c), FALSE);
+    }
     webkit_web_view_set_zoom_level(c->webview, c->config.default_zoom / 100.0);
 
     return CMD_SUCCESS;
@@ -561,8 +1106,7 @@ static int fullscreen(Client *c, const char *name, DataType type, void *value, v
 
 static int geolocation(Client *c, const char *name, DataType type, void *value, void *data)
 {
-    char *policy = (char *)value;
-    if (strcmp("always", policy) != 0 && strcmp("ask", policy) != 0 && strcmp("never", policy) != 0) {
+    if (!g_strv_contains(permission_values, (char *)value)) {
         vb_echo(c, MSG_ERROR, FALSE, "%s must be in [always, ask, never]", name);
         return CMD_ERROR | CMD_KEEPINPUT;
     }
@@ -582,7 +1126,7 @@ static int window_decorate(Client *c, const char *name, DataType type, void *val
 
 static int hardware_acceleration_policy(Client *c, const char *name, DataType type, void *value, void *data)
 {
-    WebKitSettings *settings = webkit_web_view_get_settings(c->webview);
+    WebKitSettings *settings = setting_webkit_settings(c);
 
     if (g_str_equal(value, "ondemand")) {
         webkit_settings_set_hardware_acceleration_policy(settings, WEBKIT_HARDWARE_ACCELERATION_POLICY_ON_DEMAND);
@@ -659,98 +1203,191 @@ static int internal(Client *c, const char *name, DataType type, void *value, voi
 
 static int notification(Client *c, const char *name, DataType type, void *value, void *data)
 {
-    char *policy = (char *)value;
-    if (strcmp("always", policy) != 0 && strcmp("ask", policy) != 0 && strcmp("never", policy) != 0) {
+    if (!g_strv_contains(permission_values, (char *)value)) {
         vb_echo(c, MSG_ERROR, FALSE, "%s must be in [always, ask, never]", name);
         return CMD_ERROR | CMD_KEEPINPUT;
     }
     return CMD_SUCCESS;
 }
 
+static int search_mode(Client *c, const char *name, DataType type, void *value, void *data)
+{
+    if (!g_strv_contains(search_mode_values, (char *)value)) {
+        vb_echo(c, MSG_ERROR, FALSE, "%s must be in [literal, regex, word]", name);
+        return CMD_ERROR | CMD_KEEPINPUT;
+    }
+    return CMD_SUCCESS;
+}
+
 static int user_scripts(Client *c, const char *name, DataType type, void *value, void *data)
 {
-    WebKitUserContentManager *ucm;
-    WebKitUserScript *script;
-    gchar *source;
+    attach_user_scripts(webkit_web_view_get_user_content_manager(c->webview),
+            *(gboolean*)value);
 
-    gboolean enabled = *(gboolean*)value;
+    return CMD_SUCCESS;
+}
 
-    ucm = webkit_web_view_get_user_content_manager(c->webview);
-    webkit_user_content_manager_remove_all_scripts(ucm);
+static int user_style(Client *c, const char *name, DataType type, void *value, void *data)
+{
+    attach_user_style(webkit_web_view_get_user_content_manager(c->webview),
+            *(gboolean*)value);
 
-    if (enabled) {
-        if (vb.files[FILES_SCRIPT]
-                && g_file_get_contents(vb.files[FILES_SCRIPT], &source, NULL, NULL)) {
+    return CMD_SUCCESS;
+}
+
+/**
+ * Replaces the scripts of the user content manager by the global scripts and
+ * the user scripts if enabled.
+ */
+static void attach_user_scripts(WebKitUserContentManager *ucm, gboolean enabled)
+{
+    static WebKitUserScript *global = NULL;
+    WebKitUserScript *script;
 
-            script = webkit_user_script_new(
-                source, WEBKIT_USER_CONTENT_INJECT_ALL_FRAMES,
-                WEBKIT_USER_SCRIPT_INJECT_AT_DOCUMENT_END, NULL, NULL
-            );
+    webkit_user_content_manager_remove_all_scripts(ucm);
 
-            webkit_user_content_manager_add_script(ucm, script);
-            webkit_user_script_unref(script);
-            g_free(source);
-        }
+    if (enabled && (script = user_content_get(&user_script))) {
+        webkit_user_content_manager_add_script(ucm, script);
     }
 
     /* Inject the global scripts. */
-    script = webkit_user_script_new(JS_HINTS " " JS_SCROLL,
-            WEBKIT_USER_CONTENT_INJECT_TOP_FRAME,
-            WEBKIT_USER_SCRIPT_INJECT_AT_DOCUMENT_END, NULL, NULL);
-    webkit_user_content_manager_add_script(ucm, script);
-    webkit_user_script_unref(script);
-
-    return CMD_SUCCESS;
+    if (!global) {
+        global = webkit_user_script_new(JS_HINTS,
+                WEBKIT_USER_CONTENT_INJECT_TOP_FRAME,
+                WEBKIT_USER_SCRIPT_INJECT_AT_DOCUMENT_END, NULL, NULL);
+    }
+    webkit_user_content_manager_add_script(ucm, global);
 }
 
-static int user_style(Client *c, const char *name, DataType type, void *value, void *data)
+/**
+ * Replaces the style sheets of the user content manager by the global styles
+ * and the user style if enabled.
+ */
+static void attach_user_style(WebKitUserContentManager *ucm, gboolean enabled)
 {
-    WebKitUserContentManager *ucm;
+    static WebKitUserStyleSheet *global = NULL;
     WebKitUserStyleSheet *style;
-    gchar *source;
-
-    gboolean enabled = *(gboolean*)value;
 
-    ucm = webkit_web_view_get_user_content_manager(c->webview);
+    /* Remove previous added styles also if enabled, else the styles would be
+     * added twice when the setting is applied to a prepared webview. */
+    webkit_user_content_manager_remove_all_style_sheets(ucm);
 
     if (enabled) {
-        if (g_file_get_contents(vb.files[FILES_USER_STYLE], &source, NULL, NULL)) {
-            style = webkit_user_style_sheet_new(
-                source, WEBKIT_USER_CONTENT_INJECT_ALL_FRAMES,
-                WEBKIT_USER_STYLE_LEVEL_USER, NULL, NULL
-            );
-
+        if ((style = user_content_get(&user_stylesheet))) {
             webkit_user_content_manager_add_style_sheet(ucm, style);
-            webkit_user_style_sheet_unref(style);
-            g_free(source);
         } else {
             g_message("Could not read style file: %s", vb.files[FILES_USER_STYLE]);
         }
-    } else {
-        webkit_user_content_manager_remove_all_style_sheets(ucm);
     }
 
     /* Inject the global styles with author level to allow restyling by user
      * style sheets. */
-    style = webkit_user_style_sheet_new(CSS_HINTS,
-            WEBKIT_USER_CONTENT_INJECT_ALL_FRAMES,
-            WEBKIT_USER_STYLE_LEVEL_AUTHOR, NULL, NULL);
-    webkit_user_content_manager_add_style_sheet(ucm, style);
-    webkit_user_style_sheet_unref(style);
+    if (!global) {
+        global = webkit_user_style_sheet_new(CSS_HINTS,
+                WEBKIT_USER_CONTENT_INJECT_ALL_FRAMES,
+                WEBKIT_USER_STYLE_LEVEL_AUTHOR, NULL, NULL);
+    }
+    webkit_user_content_manager_add_style_sheet(ucm, global);
+}
 
-    return CMD_SUCCESS;
+/**
+ * Returns the cached user script or style of given cache entry. The file is
+ * only read again if the file monitor reported a change or the inode or
+ * modification time of the file differs from the cached one.
+ */
+static gpointer user_content_get(UserContent *uc)
+{
+    const char *path = vb.files[uc->file];
+    struct stat st;
+    gchar *source;
+    GFile *file;
+
+    if (!path) {
+        return NULL;
+    }
+    if (stat(path, &st) == -1) {
+        /* File does not exist (anymore). */
+        g_clear_pointer(&uc->object, uc->unref);
+        uc->valid = FALSE;
+
+        return NULL;
+    }
+    if (uc->valid && uc->dev == st.st_dev && uc->ino == st.st_ino
+            && uc->mtime == st.st_mtime) {
+        return uc->object;
+    }
+
+    g_clear_pointer(&uc->object, uc->unref);
+    if (g_file_get_contents(path, &source, NULL, NULL)) {
+        uc->object = uc->create(source);
+        g_free(source);
+    }
+    uc->dev   = st.st_dev;
+    uc->ino   = st.st_ino;
+    uc->mtime = st.st_mtime;
+    uc->valid = TRUE;
+
+    /* Watch the file to drop the object as soon as the file changes, also
+     * for changes within the same second that keep the mtime. */
+    if (!uc->monitor) {
+        file        = g_file_new_for_path(path);
+        uc->monitor = g_file_monitor_file(file, G_FILE_MONITOR_NONE, NULL, NULL);
+        if (uc->monitor) {
+            g_signal_connect(uc->monitor, "changed",
+                    G_CALLBACK(on_user_content_file_changed), uc);
+        }
+        g_object_unref(file);
+    }
+
+    return uc->object;
+}
+
+static void on_user_content_file_changed(GFileMonitor *monitor, GFile *file,
+        GFile *other, GFileMonitorEvent event, UserContent *uc)
+{
+    switch (event) {
+        case G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT:
+        case G_FILE_MONITOR_EVENT_DELETED:
+        case G_FILE_MONITOR_EVENT_CREATED:
+        case G_FILE_MONITOR_EVENT_MOVED:
+            uc->valid = FALSE;
+            break;
+
+        default:
+            break;
+    }
+}
+
+static gpointer user_script_new(const char *source)
+{
+    return webkit_user_script_new(source, WEBKIT_USER_CONTENT_INJECT_ALL_FRAMES,
+            WEBKIT_USER_SCRIPT_INJECT_AT_DOCUMENT_END, NULL, NULL);
+}
+
+static gpointer user_style_new(const char *source)
+{
+    return webkit_user_style_sheet_new(source, WEBKIT_USER_CONTENT_INJECT_ALL_FRAMES,
+            WEBKIT_USER_STYLE_LEVEL_USER, NULL, NULL);
 }
 
 static int statusbar(Client *c, const char *name, DataType type, void *value, void *data)
 {
     gtk_widget_set_visible(GTK_WIDGET(c->statusbar.box), *(gboolean*)value);
+    if (*(gboolean*)value) {
+        /* render the changes made while the statusbar was hidden */
+        vb_statusbar_update(c);
+    }
 
     return CMD_SUCCESS;
 }
 
 static int gui_style(Client *c, const char *name, DataType type, void *value, void *data)
 {
-    vb_gui_style_update(c, name, (const char*)value);
+    if (batch.depth) {
+        batch.gui_style = TRUE;
+    } else {
+        vb_gui_style_update(c, name, (const char*)value);
+    }
 
     return CMD_SUCCESS;
 }
@@ -769,7 +1406,7 @@ static int tls_policy(Client *c, const char *name, DataType type, void *value, v
 static int webkit(Client *c, const char *name, DataType type, void *value, void *data)
 {
     const char *property = (const char*)data;
-    WebKitSettings *web_setting = webkit_web_view_get_settings(c->webview);
+    WebKitSettings *web_setting = setting_webkit_settings(c);
 
     switch (type) {
         case TYPE_BOOLEAN:
@@ -24,9 +24,22 @@
 
 #include "main.h"
 
+typedef struct SettingCmd SettingCmd;
+
 void setting_init(Client *c);
+gboolean setting_defaults_begin(void);
+void setting_defaults_end(void);
+void setting_batch_begin(void);
+void setting_batch_end(Client *c);
 void setting_cleanup(Client *c);
 VbCmdResult setting_run(Client *c, char *name, const char *param);
+SettingCmd *setting_cmd_new(Client *c, char *name, const char *param);
+VbCmdResult setting_cmd_run(Client *c, const SettingCmd *cmd);
+void setting_cmd_free(SettingCmd *cmd);
+VbCmdResult setting_site_add(Client *c, const char *pattern, char *name, const char *param);
+void setting_site_apply(Client *c, const char *uri);
 gboolean setting_fill_completion(Client *c, GtkListStore *store, const char *input);
+void setting_user_content_init(WebKitUserContentManager *ucm);
+WebKitSettings *setting_webkit_settings(Client *c);
 
 #endif /* end of include guard: _SETTING_H */
@@ -0,0 +1,278 @@
+/**
+ * vimb - a webkit based vim like browser.
+ *
+ * Copyright (C) 2012-2018 Daniel Carl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+#include <string.h>
+
+#include "site.h"
+
+/* Longest label of a host name allowed by RFC 1035. */
+#define LABEL_MAX 63
+
+typedef struct SiteNode SiteNode;
+struct SiteNode {
+    SiteNode    *parent;
+    GHashTable  *children;  /* SiteNode by lower case label */
+    GArray      *rules;     /* SiteRule of the pattern of this node */
+    GArray      *profile;   /* rules of the node and its parents by key */
+    guint       generation; /* trie generation the profile was merged for */
+};
+
+/* Rules of host patterns stored by their labels from the top level domain
+ * on, so that the rules of a host are found by walking its labels from right
+ * to left. */
+struct SiteTrie {
+    SiteNode        *root;
+    GDestroyNotify  value_free;
+    guint           generation; /* incremented by each added rule */
+};
+
+static SiteNode *node_new(SiteNode *parent);
+static void node_free(SiteTrie *trie, SiteNode *node);
+static SiteNode *get_child(SiteNode *node, const char *start, const char *end);
+static const GArray *get_profile(SiteTrie *trie, SiteNode *node);
+static int compare_rule(gconstpointer a, gconstpointer b);
+
+
+SiteTrie *site_trie_new(GDestroyNotify value_free)
+{
+    SiteTrie *trie = g_slice_new0(SiteTrie);
+
+    trie->root       = node_new(NULL);
+    trie->value_free = value_free;
+
+    return trie;
+}
+
+void site_trie_free(SiteTrie *trie)
+{
+    if (!trie) {
+        return;
+    }
+    node_free(trie, trie->root);
+    g_slice_free(SiteTrie, trie);
+}
+
+/**
+ * Adds a rule for the host pattern. The pattern 'example.com' applies to the
+ * host and all its subdomains, a leading '*.' or '.' is allowed but doesn't
+ * change this. If there is already a rule with the key for the pattern, its
+ * value is replaced. The trie takes the value also if FALSE is returned for
+ * an invalid pattern.
+ */
+gboolean site_trie_add(SiteTrie *trie, const char *pattern, guint key, gpointer value)
+{
+    SiteNode *node = trie->root, *child;
+    SiteRule rule = {key, value}, *r;
+    const char *start, *end;
+    guint i;
+
+    if (g_str_has_prefix(pattern, "*.")) {
+        pattern += 2;
+    } else if (*pattern == '.') {
+        pattern++;
+    }
+    /* A trailing dot is the root of the dns. */
+    end = pattern + strlen(pattern);
+    if (end > pattern && end[-1] == '.') {
+        end--;
+    }
+    if (end == pattern) {
+        if (trie->value_free) {
+            trie->value_free(value);
+        }
+        return FALSE;
+    }
+
+    /* Walk the labels from right to left and create missing nodes. */
+    while (end > pattern) {
+        for (start = end; start > pattern && start[-1] != '.'; start--);
+        if (start == end || end - start > LABEL_MAX) {
+            if (trie->value_free) {
+                trie->value_free(value);
+            }
+            return FALSE;
+        }
+        if (!(child = get_child(node, start, end))) {
+            child = node_new(node);
+            g_hash_table_insert(node->children, g_ascii_strdown(start, end - start), child);
+        }
+        node = child;
+        end  = start > pattern ? start - 1 : start;
+    }
+
+    if (!node->rules) {
+        node->rules = g_array_new(FALSE, FALSE, sizeof(SiteRule));
+    }
+    for (i = 0; i < node->rules->len; i++) {
+        r = &g_array_index(node->rules, SiteRule, i);
+        if (r->key == key) {
+            if (trie->value_free) {
+                trie->value_free(r->value);
+            }
+            r->value = value;
+            break;
+        }
+    }
+    if (i == node->rules->len) {
+        g_array_append_val(node->rules, rule);
+    }
+    trie->generation++;
+
+    return TRUE;
+}
+
+/**
+ * Returns the rules that apply to the host sorted by their key or NULL if
+ * there are none. Rules of longer patterns override those of shorter ones
+ * with the same key. The returned array is owned by the trie and is the
+ * same for all hosts with the same rules until a rule is added.
+ */
+const GArray *site_trie_lookup(SiteTrie *trie, const char *host)
+{
+    SiteNode *node = trie->root, *child, *match = NULL;
+    const char *start, *end;
+
+    if (!host || !*host) {
+        return NULL;
+    }
+
+    end = host + strlen(host);
+    if (end[-1] == '.') {
+        end--;
+    }
+    while (end > host) {
+        for (start = end; start > host && start[-1] != '.'; start--);
+        if (!(child = get_child(node, start, end))) {
+            break;
+        }
+        node = child;
+        if (node->rules) {
+            match = node;
+        }
+        end = start > host ? start - 1 : start;
+    }
+
+    return match ? get_profile(trie, match) : NULL;
+}
+
+/**
+ * Returns a number that changes each time a rule is added, so that users of
+ * the trie can tell if a looked up profile may be outdated.
+ */
+guint site_trie_get_generation(SiteTrie *trie)
+{
+    return trie->generation;
+}
+
+static SiteNode *node_new(SiteNode *parent)
+{
+    SiteNode *node = g_slice_new0(SiteNode);
+
+    node->parent   = parent;
+    node->children = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+
+    return node;
+}
+
+static void node_free(SiteTrie *trie, SiteNode *node)
+{
+    GHashTableIter iter;
+    gpointer child;
+    guint i;
+
+    g_hash_table_iter_init(&iter, node->children);
+    while (g_hash_table_iter_next(&iter, NULL, &child)) {
+        node_free(trie, child);
+    }
+    g_hash_table_destroy(node->children);
+    if (node->rules) {
+        for (i = 0; trie->value_free && i < node->rules->len; i++) {
+            trie->value_free(g_array_index(node->rules, SiteRule, i).value);
+        }
+        g_array_free(node->rules, TRUE);
+    }
+    if (node->profile) {
+        g_array_free(node->profile, TRUE);
+    }
+    g_slice_free(SiteNode, node);
+}
+
+/**
+ * Returns the child of the node for the label between start and end. The
+ * label is compared case insensitive without allocation.
+ */
+static SiteNode *get_child(SiteNode *node, const char *start, const char *end)
+{
+    char label[LABEL_MAX + 1];
+    gsize len = end - start, i;
+
+    if (len > LABEL_MAX) {
+        return NULL;
+    }
+    for (i = 0; i < len; i++) {
+        label[i] = g_ascii_tolower(start[i]);
+    }
+    label[len] = '\0';
+
+    return g_hash_table_lookup(node->children, label);
+}
+
+/**
+ * Returns the rules of the node merged with those of its parents. The merged
+ * rules are kept until a rule is added to the trie.
+ */
+static const GArray *get_profile(SiteTrie *trie, SiteNode *node)
+{
+    SiteNode *n;
+    SiteRule *rule;
+    GArray *profile;
+    guint i;
+
+    if (node->profile && node->generation == trie->generation) {
+        return node->profile;
+    }
+
+    /* Collect the rules from the node up to the root, so the first found
+     * rule of a key is the one of the longest pattern. */
+    profile = node->profile ? g_array_set_size(node->profile, 0)
+        : g_array_new(FALSE, FALSE, sizeof(SiteRule));
+    for (n = node; n; n = n->parent) {
+        if (!n->rules) {
+            continue;
+        }
+        for (i = 0; i < n->rules->len; i++) {
+            rule = &g_array_index(n->rules, SiteRule, i);
+            if (!bsearch(rule, profile->data, profile->len, sizeof(SiteRule), compare_rule)) {
+                g_array_append_val(profile, *rule);
+                g_array_sort(profile, compare_rule);
+            }
+        }
+    }
+    node->profile    = profile;
+    node->generation = trie->generation;
+
+    return profile;
+}
+
+static int compare_rule(gconstpointer a, gconstpointer b)
+{
+    guint ka = ((const SiteRule*)a)->key, kb = ((const SiteRule*)b)->key;
+
+    return ka < kb ? -1 : ka > kb;
+}
@@ -0,0 +1,39 @@
+/**
+ * vimb - a webkit based vim like browser.
+ *
+ * Copyright (C) 2012-2018 Daniel Carl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+#ifndef _SITE_H
+#define _SITE_H
+
+#include <glib.h>
+
+typedef struct SiteTrie SiteTrie;
+
+/* Value of a site rule, the key tells what the value is for. */
+typedef struct {
+    guint       key;
+    gpointer    value;
+} SiteRule;
+
+SiteTrie *site_trie_new(GDestroyNotify value_free);
+void site_trie_free(SiteTrie *trie);
+gboolean site_trie_add(SiteTrie *trie, const char *pattern, guint key, gpointer value);
+const GArray *site_trie_lookup(SiteTrie *trie, const char *host);
+guint site_trie_get_generation(SiteTrie *trie);
+
+#endif /* end of include guard: _SITE_H */
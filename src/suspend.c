@@ -0,0 +1,321 @@
+/**
+ * vimb - a webkit based vim like browser.
+ *
+ * Copyright (C) 2012-2018 Daniel Carl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+#include <fcntl.h>
+#include <glib-unix.h>
+#include <glib/gstdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "config.h"
+#include "ext-proxy.h"
+#include "main.h"
+#include "suspend.h"
+
+static gboolean on_suspend_timeout(gpointer data);
+static gboolean on_pressure(gint fd, GIOCondition condition, gpointer data);
+static int pressure_open(const char *path);
+static char *get_cgroup_pressure_path(void);
+static gsize get_process_memory(pid_t pid);
+static gsize read_proc_value(const char *file, const char *key);
+static gboolean is_suspendable(Client *c);
+
+extern struct Vimb vb;
+
+static struct {
+    int     fd;         /* memory pressure trigger or -1 */
+    guint   source_id;
+    gsize   reclaimed;  /* KiB freed by all suspensions */
+    guint   count;      /* number of suspensions */
+} suspend = {-1};
+
+
+/**
+ * Starts to watch the memory pressure of the cgroup vimb runs in or of the
+ * whole system. Under pressure the longest unused window is suspended.
+ */
+void suspend_init(void)
+{
+    char *path;
+
+    if (!*SUSPEND_PRESSURE_TRIGGER) {
+        return;
+    }
+
+    /* Setting a trigger may not be permitted, so this is best effort. */
+    if ((path = get_cgroup_pressure_path())) {
+        suspend.fd = pressure_open(path);
+        g_free(path);
+    }
+    if (suspend.fd == -1) {
+        suspend.fd = pressure_open("/proc/pressure/memory");
+    }
+    if (suspend.fd != -1) {
+        suspend.source_id = g_unix_fd_add(suspend.fd, G_IO_PRI | G_IO_ERR,
+                on_pressure, NULL);
+    }
+}
+
+/**
+ * Tracks the focus of the client window. Windows that lost the focus are
+ * suspended after the suspend-timeout.
+ */
+void suspend_client_focus(Client *c, gboolean focused)
+{
+    int timeout;
+
+    if (c->state.suspend.timeout_id) {
+        g_source_remove(c->state.suspend.timeout_id);
+        c->state.suspend.timeout_id = 0;
+    }
+    if (focused) {
+        c->state.suspend.inactive_since = 0;
+        return;
+    }
+
+    c->state.suspend.inactive_since = g_get_monotonic_time();
+    timeout = GET_INT(c, SID_SUSPEND_TIMEOUT);
+    if (timeout > 0) {
+        c->state.suspend.timeout_id = g_timeout_add_seconds(timeout,
+                on_suspend_timeout, c);
+    }
+}
+
+/**
+ * Terminates the web process of the client. The uri and scroll position are
+ * kept like those of a restored session, so that the page is loaded again
+ * when the window gets the focus. Returns TRUE if the client was suspended.
+ */
+gboolean suspend_client(Client *c)
+{
+#if WEBKIT_CHECK_VERSION(2, 34, 0)
+    pid_t pid;
+    gsize memory = 0;
+
+    if (!is_suspendable(c)) {
+        return FALSE;
+    }
+
+    /* Measure before the process is gone. */
+    if ((pid = ext_proxy_get_pid(c)) > 0) {
+        memory = get_process_memory(pid);
+    }
+
+    c->state.session.uri        = g_strdup(c->state.uri);
+    c->state.session.scroll_top = c->state.scroll_top;
+    webkit_web_view_terminate_web_process(c->webview);
+    ext_proxy_client_disconnect(c);
+
+    c->state.suspend.reclaimed = memory;
+    suspend.reclaimed         += memory;
+    suspend.count++;
+
+    return TRUE;
+#else
+    /* Without terminate_web_process the process could only be freed by
+     * destroying the webview. */
+    return FALSE;
+#endif
+}
+
+void suspend_client_cleanup(Client *c)
+{
+    if (c->state.suspend.timeout_id) {
+        g_source_remove(c->state.suspend.timeout_id);
+        c->state.suspend.timeout_id = 0;
+    }
+}
+
+/**
+ * Returns newly allocated text of the windows that wait to be loaded and of
+ * the memory freed by the suspensions.
+ */
+char *suspend_get_status(void)
+{
+    GString *str = g_string_new("-- Suspended --");
+    Client *c;
+    char *size;
+
+    for (c = vb.clients; c; c = c->next) {
+        if (!c->state.session.uri) {
+            continue;
+        }
+        /* Restored windows were never loaded so nothing was freed. */
+        size = c->state.suspend.reclaimed
+            ? g_format_size((guint64)c->state.suspend.reclaimed * 1024)
+            : g_strdup("-");
+        g_string_append_printf(str, "\n%10s  %s", size, c->state.session.uri);
+        g_free(size);
+    }
+
+    size = g_format_size((guint64)suspend.reclaimed * 1024);
+    g_string_append_printf(str, "\nreclaimed %s by %u suspensions", size,
+            suspend.count);
+    g_free(size);
+
+    return g_string_free(str, FALSE);
+}
+
+void suspend_cleanup(void)
+{
+    if (suspend.source_id) {
+        g_source_remove(suspend.source_id);
+        suspend.source_id = 0;
+    }
+    if (suspend.fd != -1) {
+        close(suspend.fd);
+        suspend.fd = -1;
+    }
+}
+
+static gboolean on_suspend_timeout(gpointer data)
+{
+    Client *c = (Client*)data;
+
+    c->state.suspend.timeout_id = 0;
+    suspend_client(c);
+
+    return G_SOURCE_REMOVE;
+}
+
+/**
+ * Suspends the window that has been unfocused for the longest time each
+ * time the memory pressure trigger fires.
+ */
+static gboolean on_pressure(gint fd, GIOCondition condition, gpointer data)
+{
+    Client *c, *oldest = NULL;
+
+    /* The pressure file is gone, e.g. the cgroup was removed. */
+    if (condition & G_IO_ERR) {
+        suspend.source_id = 0;
+        close(suspend.fd);
+        suspend.fd = -1;
+
+        return G_SOURCE_REMOVE;
+    }
+
+    for (c = vb.clients; c; c = c->next) {
+        if (is_suspendable(c) && (!oldest
+                || c->state.suspend.inactive_since < oldest->state.suspend.inactive_since)) {
+            oldest = c;
+        }
+    }
+    if (oldest) {
+        suspend_client(oldest);
+    }
+
+    return G_SOURCE_CONTINUE;
+}
+
+/**
+ * Opens the pressure file and registers the trigger. Returns the file
+ * descriptor to poll or -1 on error.
+ */
+static int pressure_open(const char *path)
+{
+    int fd;
+
+    fd = g_open(path, O_RDWR | O_NONBLOCK | O_CLOEXEC, 0);
+    if (fd == -1) {
+        return -1;
+    }
+    if (write(fd, SUSPEND_PRESSURE_TRIGGER, sizeof(SUSPEND_PRESSURE_TRIGGER)) == -1) {
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+/**
+ * Returns the newly allocated path of the memory.pressure file of the cgroup
+ * v2 of vimb or NULL if it's not known.
+ */
+static char *get_cgroup_pressure_path(void)
+{
+    char *content, *line, *path = NULL;
+
+    if (!g_file_get_contents("/proc/self/cgroup", &content, NULL, NULL)) {
+        return NULL;
+    }
+    /* The unified hierarchy is given as '0::/path'. */
+    if ((line = strstr(content, "0::/"))
+        && (line == content || line[-1] == '\n')) {
+        line += 3;
+        line[strcspn(line, "\n")] = '\0';
+        path = g_build_filename("/sys/fs/cgroup", line, "memory.pressure", NULL);
+    }
+    g_free(content);
+
+    return path;
+}
+
+/**
+ * Returns the memory in KiB of the process. The proportional set size
+ * counts shared pages only partially and is closer to what is freed when
+ * the process ends than the resident set size.
+ */
+static gsize get_process_memory(pid_t pid)
+{
+    char *file;
+    gsize memory;
+
+    file   = g_strdup_printf("/proc/%d/smaps_rollup", (int)pid);
+    memory = read_proc_value(file, "\nPss:");
+    g_free(file);
+    if (!memory) {
+        file   = g_strdup_printf("/proc/%d/status", (int)pid);
+        memory = read_proc_value(file, "\nVmRSS:");
+        g_free(file);
+    }
+
+    return memory;
+}
+
+static gsize read_proc_value(const char *file, const char *key)
+{
+    char *content, *value;
+    gsize result = 0;
+
+    if (!g_file_get_contents(file, &content, NULL, NULL)) {
+        return 0;
+    }
+    if ((value = strstr(content, key))) {
+        result = strtoul(value + strlen(key), NULL, 10);
+    }
+    g_free(content);
+
+    return result;
+}
+
+static gboolean is_suspendable(Client *c)
+{
+    return GET_INT(c, SID_SUSPEND_TIMEOUT) > 0
+        && c->state.suspend.inactive_since
+        /* not loaded yet or already suspended */
+        && !c->state.session.uri
+        && c->state.uri
+        && c->state.progress == 100
+        /* related windows share the web process */
+        && !c->state.suspend.shared
+        && !c->state.is_fullscreen
+        && !webkit_web_view_is_playing_audio(c->webview);
+}
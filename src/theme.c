@@ -0,0 +1,164 @@
+/**
+ * vimb - a webkit based vim like browser.
+ *
+ * Copyright (C) 2012-2018 Daniel Carl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+/* Applies the theme of the preferencerc file to all windows. The css of the
+ * theme is compiled once into a screen wide style provider and the webview
+ * background with the configured opacity is set on every client. */
+
+#include "config.h"
+#include <gtk/gtk.h>
+
+#include "main.h"
+#include "preference.h"
+#include "theme.h"
+
+static void on_preference_changed(Preference *preference, guint changed, void *args);
+static void compile_css(Preference *preference);
+static void swap_provider(void);
+
+extern struct Vimb vb;
+
+static struct {
+    PreferenceWatch *watch;
+    GtkCssProvider  *provider;      /* provider of the current theme */
+    GString         *css;           /* reused buffer for the compiled css */
+    GdkRGBA         background;     /* background of the webviews */
+} theme;
+
+
+/**
+ * Starts watching the preferencerc file and applies the theme to all
+ * existing clients.
+ */
+void theme_init(void)
+{
+    theme.css   = g_string_sized_new(1000);
+    theme.watch = preference_watch(on_preference_changed, NULL);
+}
+
+/**
+ * Applies the current theme to a newly created client. The css is already
+ * active for all widgets.
+ */
+void theme_client_init(Client *c)
+{
+    if (theme.watch) {
+        webkit_web_view_set_background_color(c->webview, &theme.background);
+    }
+}
+
+void theme_cleanup(void)
+{
+    if (theme.watch) {
+        preference_watch_free(theme.watch);
+        theme.watch = NULL;
+    }
+    if (theme.provider) {
+        gtk_style_context_remove_provider_for_screen(gdk_screen_get_default(),
+                GTK_STYLE_PROVIDER(theme.provider));
+        g_clear_object(&theme.provider);
+    }
+    if (theme.css) {
+        g_string_free(theme.css, TRUE);
+        theme.css = NULL;
+    }
+}
+
+static void on_preference_changed(Preference *preference, guint changed, void *args)
+{
+    Client *c;
+
+    theme.background       = preference->background;
+    theme.background.alpha = preference->opacity;
+
+    if (changed & PREFERENCE_CHANGED_CSS) {
+        compile_css(preference);
+        swap_provider();
+    }
+
+    if (changed & PREFERENCE_CHANGED_BACKGROUND) {
+        for (c = vb.clients; c; c = c->next) {
+            webkit_web_view_set_background_color(c->webview, &theme.background);
+        }
+    }
+}
+
+static void compile_css(Preference *preference)
+{
+    GdkRGBA ssl, unsecure;
+    char *bg, *bold, *fg, *ssl_bg, *unsecure_bg;
+
+    ssl         = preference->palette[2];
+    ssl.alpha   = preference->opacity;
+    unsecure       = preference->palette[1];
+    unsecure.alpha = preference->opacity;
+
+    bg          = gdk_rgba_to_string(&theme.background);
+    bold        = gdk_rgba_to_string(&preference->bold);
+    fg          = gdk_rgba_to_string(&preference->foreground);
+    ssl_bg      = gdk_rgba_to_string(&ssl);
+    unsecure_bg = gdk_rgba_to_string(&unsecure);
+
+    g_string_printf(theme.css,
+            "#statusbar {background-color: %s; color: %s; font-family: %s; font-size: %s;}\n"
+            "#statusbar.secure {background-color: %s;}\n"
+            "#statusbar.unsecure {background-color: %s;}\n"
+            "#input.view {background-color: %s; font-family: %s; font-size: %s;}"
+            "#input.view text {background-color: rgba(0,0,0,0); color: %s;}",
+            bg, bold, preference->font_family, preference->font_size,
+            ssl_bg, unsecure_bg,
+            bg, preference->font_family, preference->font_size, fg);
+
+    g_free(bg);
+    g_free(bold);
+    g_free(fg);
+    g_free(ssl_bg);
+    g_free(unsecure_bg);
+}
+
+/**
+ * Replaces the style provider of the theme by a new one with the compiled
+ * css. The new provider is added before the old one is removed so that the
+ * widgets never see a partial or missing theme.
+ */
+static void swap_provider(void)
+{
+    GtkCssProvider *provider;
+    GdkScreen *screen = gdk_screen_get_default();
+    GError *error = NULL;
+
+    provider = gtk_css_provider_new();
+    if (!gtk_css_provider_load_from_data(provider, theme.css->str, -1, &error)) {
+        g_warning("Could not load theme css: %s", error->message);
+        g_error_free(error);
+        g_object_unref(provider);
+        return;
+    }
+
+    /* The theme overrules the gui style settings like it did when it was
+     * loaded into the same provider after the config. */
+    gtk_style_context_add_provider_for_screen(screen, GTK_STYLE_PROVIDER(provider),
+            GTK_STYLE_PROVIDER_PRIORITY_APPLICATION + 1);
+    if (theme.provider) {
+        gtk_style_context_remove_provider_for_screen(screen,
+                GTK_STYLE_PROVIDER(theme.provider));
+        g_object_unref(theme.provider);
+    }
+    theme.provider = provider;
+}
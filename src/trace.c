@@ -0,0 +1,185 @@
+/**
+ * vimb - a webkit based vim like browser.
+ *
+ * Copyright (C) 2012-2018 Daniel Carl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+/* Records the startup phases given by --trace-startup. The events are
+ * written as chrome trace event json into the given file or as a short
+ * summary to stdout if the file is '-'. All functions are noops if tracing
+ * is not enabled or already finished. */
+
+#include <glib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "trace.h"
+
+typedef struct {
+    const char *name;   /* static string - not freed */
+    char       phase;   /* 'X' complete or 'i' instant event */
+    gint64     ts;      /* microseconds since start */
+    gint64     dur;     /* duration in microseconds, -1 if not ended yet */
+} TraceEvent;
+
+static void write_json(FILE *fp);
+static void write_summary(FILE *fp);
+static void add_event(const char *name, char phase, gint64 ts, gint64 dur);
+
+static struct {
+    char   *file;
+    gint64 start;
+    GArray *events;
+} trace;
+
+
+/**
+ * Enables the tracing. The given start time from g_get_monotonic_time() is
+ * used as reference for all events.
+ */
+void trace_init(const char *file, gint64 start)
+{
+    trace.file   = g_strdup(file);
+    trace.start  = start;
+    trace.events = g_array_new(FALSE, FALSE, sizeof(TraceEvent));
+}
+
+/**
+ * Adds a complete event for given start and end time.
+ */
+void trace_add(const char *name, gint64 start, gint64 end)
+{
+    if (trace.events) {
+        add_event(name, 'X', start - trace.start, end - start);
+    }
+}
+
+/**
+ * Starts a new phase. The name must be a static string.
+ */
+void trace_begin(const char *name)
+{
+    if (trace.events) {
+        add_event(name, 'X', g_get_monotonic_time() - trace.start, -1);
+    }
+}
+
+/**
+ * Ends the last started phase of given name.
+ */
+void trace_end(const char *name)
+{
+    TraceEvent *e;
+    gint64 now;
+    guint i;
+
+    if (!trace.events) {
+        return;
+    }
+    now = g_get_monotonic_time() - trace.start;
+    for (i = trace.events->len; i > 0; i--) {
+        e = &g_array_index(trace.events, TraceEvent, i - 1);
+        if (e->dur < 0 && !strcmp(e->name, name)) {
+            e->dur = now - e->ts;
+            break;
+        }
+    }
+}
+
+/**
+ * Marks a point in time like the first load commit.
+ */
+void trace_instant(const char *name)
+{
+    if (trace.events) {
+        add_event(name, 'i', g_get_monotonic_time() - trace.start, 0);
+    }
+}
+
+/**
+ * Writes the collected events and stops tracing.
+ */
+void trace_finish(void)
+{
+    FILE *fp;
+
+    if (!trace.events) {
+        return;
+    }
+
+    /* Add the whole startup as outer phase. */
+    add_event("startup", 'X', 0, g_get_monotonic_time() - trace.start);
+
+    if (!strcmp(trace.file, "-")) {
+        write_summary(stdout);
+        fflush(stdout);
+    } else if ((fp = fopen(trace.file, "w"))) {
+        write_json(fp);
+        fclose(fp);
+    } else {
+        g_warning("Could not write trace file %s", trace.file);
+    }
+
+    g_array_free(trace.events, TRUE);
+    trace.events = NULL;
+    g_free(trace.file);
+    trace.file = NULL;
+}
+
+static void write_json(FILE *fp)
+{
+    TraceEvent *e;
+    guint i;
+    int pid = (int)getpid();
+
+    fputs("{\"traceEvents\":[", fp);
+    for (i = 0; i < trace.events->len; i++) {
+        e = &g_array_index(trace.events, TraceEvent, i);
+        fprintf(fp, "%s\n{\"name\":\"%s\",\"cat\":\"startup\",\"ph\":\"%c\",\"ts\":%" G_GINT64_FORMAT ",",
+                i ? "," : "", e->name, e->phase, e->ts);
+        if (e->phase == 'X') {
+            fprintf(fp, "\"dur\":%" G_GINT64_FORMAT ",", MAX(e->dur, 0));
+        } else {
+            fputs("\"s\":\"p\",", fp);
+        }
+        fprintf(fp, "\"pid\":%d,\"tid\":%d}", pid, pid);
+    }
+    fputs("\n],\"displayTimeUnit\":\"ms\"}\n", fp);
+}
+
+static void write_summary(FILE *fp)
+{
+    TraceEvent *e;
+    guint i;
+
+    for (i = 0; i < trace.events->len; i++) {
+        e = &g_array_index(trace.events, TraceEvent, i);
+        if (e->phase == 'X') {
+            fprintf(fp, "%-24s at %9.3f ms took %9.3f ms\n", e->name,
+                    e->ts / 1000.0, MAX(e->dur, 0) / 1000.0);
+        } else {
+            fprintf(fp, "%-24s at %9.3f ms\n", e->name, e->ts / 1000.0);
+        }
+    }
+}
+
+static void add_event(const char *name, char phase, gint64 ts, gint64 dur)
+{
+    TraceEvent e = {name, phase, ts, dur};
+
+    g_array_append_val(trace.events, e);
+}
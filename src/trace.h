@@ -0,0 +1,32 @@
+/**
+ * vimb - a webkit based vim like browser.
+ *
+ * Copyright (C) 2012-2018 Daniel Carl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+#ifndef _TRACE_H
+#define _TRACE_H
+
+#include <glib.h>
+
+void trace_init(const char *file, gint64 start);
+void trace_add(const char *name, gint64 start, gint64 end);
+void trace_begin(const char *name);
+void trace_end(const char *name);
+void trace_instant(const char *name);
+void trace_finish(void);
+
+#endif /* end of include guard: _TRACE_H */
@@ -576,59 +576,6 @@ gboolean util_fill_completion(GtkListStore *store, const char *input, GList *src
     return found;
 }
 
-/**
- * Fills file path completion entries into given list store for also given
- * input.
- */
-gboolean util_filename_fill_completion(GtkListStore *store, const char *input)
-{
-    gboolean found = FALSE;
-    GError *error  = NULL;
-    char *input_dirname, *real_dirname;
-    const char *last_slash, *input_basename;
-    GDir *dir;
-
-    last_slash     = strrchr(input, '/');
-    input_basename = last_slash ? last_slash + 1 : input;
-    input_dirname  = g_strndup(input, input_basename - input);
-    real_dirname   = util_expand(
-        *input_dirname ? input_dirname : ".",
-        UTIL_EXP_TILDE|UTIL_EXP_DOLLAR
-    );
-
-    dir = g_dir_open(real_dirname, 0, &error);
-    if (error) {
-        /* Can't open directory, likely bad user input */
-        g_error_free(error);
-    } else {
-        GtkTreeIter iter;
-        const char *filename;
-        char *fullpath, *result;
-
-        while ((filename = g_dir_read_name(dir))) {
-            if (g_str_has_prefix(filename, input_basename)) {
-                fullpath = g_build_filename(real_dirname, filename, NULL);
-                if (g_file_test(fullpath, G_FILE_TEST_IS_DIR)) {
-                    result = g_strconcat(input_dirname, filename, "/", NULL);
-                } else {
-                    result = g_strconcat(input_dirname, filename, NULL);
-                }
-                g_free(fullpath);
-                gtk_list_store_append(store, &iter);
-                gtk_list_store_set(store, &iter, COMPLETION_STORE_FIRST, result, -1);
-                g_free(result);
-                found = TRUE;
-            }
-        }
-        g_dir_close(dir);
-    }
-
-    g_free(input_dirname);
-    g_free(real_dirname);
-
-    return found;
-}
-
 /**
  * Returns the script result as string.
  * Returned string must be freed by g_free.
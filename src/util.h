@@ -48,7 +48,6 @@ char **util_get_lines(const char *filename);
 GList *util_strv_to_unique_list(char **lines, Util_Content_Func func,
         guint max_items);
 gboolean util_fill_completion(GtkListStore *store, const char *input, GList *src);
-gboolean util_filename_fill_completion(GtkListStore *store, const char *input);
 char *util_js_result_as_string(WebKitJavascriptResult *result);
 double util_js_result_as_number(WebKitJavascriptResult *result);
 gboolean util_parse_expansion(const char **input, GString *str, int flags,
@@ -18,61 +18,54 @@
  */
 
 #include <glib.h>
+#include <stdlib.h>
 #include <webkitdom/webkitdom.h>
 
 #include "ext-main.h"
 #include "ext-dom.h"
 
+#define INPUT_CACHE_KEY "vimb-input-cache"
+
+/* Candidates of ext_dom_focus_input() of a document in document order. */
+typedef struct {
+    GPtrArray *elements;    /* input and textarea elements */
+    GPtrArray *frames;      /* iframe elements */
+} InputCache;
+
+static gboolean is_editable_input(WebKitDOMElement *element);
+static int compare_type(const void *a, const void *b);
+static InputCache *get_input_cache(WebKitDOMDocument *doc);
+static void input_cache_free(gpointer data);
+static void on_dom_changed(WebKitDOMEventTarget *target, WebKitDOMEvent *event,
+        gpointer data);
 static gboolean is_element_visible(WebKitDOMHTMLElement *element);
 
+/* Types of input elements that take text, sorted for bsearch(). Input
+ * elements without type attribute are rendered and behave like type = text
+ * and there are a lot of pages in the wild using input field without type
+ * attribute. */
+static const char *editable_types[] = {
+    "", "color", "date", "datetime", "datetime-local", "email", "month",
+    "number", "password", "search", "tel", "text", "time", "url", "week"
+};
+
 
 /**
  * Checks if given dom element is an editable element.
  */
 gboolean ext_dom_is_editable(WebKitDOMElement *element)
 {
-    char *type;
-    gboolean result = FALSE;
-
     if (!element) {
         return FALSE;
     }
 
-    /* element is editable if it's a text area or input with no type, text or
-     * password */
-    if (webkit_dom_html_element_get_is_content_editable(WEBKIT_DOM_HTML_ELEMENT(element))
-            || WEBKIT_DOM_IS_HTML_TEXT_AREA_ELEMENT(element)) {
+    /* element is editable if it's content editable, a text area or an input
+     * that takes text */
+    if (webkit_dom_html_element_get_is_content_editable(WEBKIT_DOM_HTML_ELEMENT(element))) {
         return TRUE;
     }
 
-    if (WEBKIT_DOM_IS_HTML_INPUT_ELEMENT(element)) {
-        type = webkit_dom_html_input_element_get_input_type(WEBKIT_DOM_HTML_INPUT_ELEMENT(element));
-        /* Input element without type attribute are rendered and behave like
-         * type = text and there are a lot of pages in the wild using input
-         * field without type attribute. */
-        if (!*type
-            || !g_ascii_strcasecmp(type, "text")
-            || !g_ascii_strcasecmp(type, "password")
-            || !g_ascii_strcasecmp(type, "color")
-            || !g_ascii_strcasecmp(type, "date")
-            || !g_ascii_strcasecmp(type, "datetime")
-            || !g_ascii_strcasecmp(type, "datetime-local")
-            || !g_ascii_strcasecmp(type, "email")
-            || !g_ascii_strcasecmp(type, "month")
-            || !g_ascii_strcasecmp(type, "number")
-            || !g_ascii_strcasecmp(type, "search")
-            || !g_ascii_strcasecmp(type, "tel")
-            || !g_ascii_strcasecmp(type, "time")
-            || !g_ascii_strcasecmp(type, "url")
-            || !g_ascii_strcasecmp(type, "week"))
-        {
-            result = TRUE;
-        }
-
-        g_free(type);
-    }
-
-    return result;
+    return is_editable_input(element);
 }
 
 /**
@@ -82,71 +75,33 @@ gboolean ext_dom_is_editable(WebKitDOMElement *element)
  */
 gboolean ext_dom_focus_input(WebKitDOMDocument *doc)
 {
-    WebKitDOMNode *html, *node;
-    WebKitDOMHTMLCollection *collection;
-    WebKitDOMXPathNSResolver *resolver;
-    WebKitDOMXPathResult* result;
+    InputCache *cache;
+    WebKitDOMElement *elem;
     WebKitDOMDocument *frame_doc;
-    guint i, len;
+    guint i;
 
-    collection = webkit_dom_document_get_elements_by_tag_name_as_html_collection(doc, "html");
-    if (!collection) {
+    if (!doc || !(cache = get_input_cache(doc))) {
         return FALSE;
     }
 
-    html = webkit_dom_html_collection_item(collection, 0);
-    g_object_unref(collection);
-
-    resolver = webkit_dom_document_create_ns_resolver(doc, html);
-    if (!resolver) {
-        return FALSE;
-    }
-
-    /* Use translate to match xpath expression case insensitive so that also
-     * intput filed of type="TEXT" are matched. */
-    result = webkit_dom_document_evaluate(
-        doc, "//input[not(@type) "
-        "or translate(@type,'ETX','etx')='text' "
-        "or translate(@type,'ADOPRSW','adoprsw')='password' "
-        "or translate(@type,'CLOR','clor')='color' "
-        "or translate(@type,'ADET','adet')='date' "
-        "or translate(@type,'ADEIMT','adeimt')='datetime' "
-        "or translate(@type,'ACDEILMOT','acdeilmot')='datetime-local' "
-        "or translate(@type,'AEILM','aeilm')='email' "
-        "or translate(@type,'HMNOT','hmnot')='month' "
-        "or translate(@type,'BEMNRU','bemnru')='number' "
-        "or translate(@type,'ACEHRS','acehrs')='search' "
-        "or translate(@type,'ELT','elt')='tel' "
-        "or translate(@type,'EIMT','eimt')='time' "
-        "or translate(@type,'LRU','lru')='url' "
-        "or translate(@type,'EKW','ekw')='week' "
-        "]|//textarea",
-        html, resolver, 5, NULL, NULL
-    );
-    if (!result) {
-        return FALSE;
-    }
-    while ((node = webkit_dom_xpath_result_iterate_next(result, NULL))) {
-        if (is_element_visible(WEBKIT_DOM_HTML_ELEMENT(node))) {
-            webkit_dom_element_focus(WEBKIT_DOM_ELEMENT(node));
+    /* The type of the cached elements may have changed since. */
+    for (i = 0; i < cache->elements->len; i++) {
+        elem = cache->elements->pdata[i];
+        if (is_editable_input(elem) && is_element_visible(WEBKIT_DOM_HTML_ELEMENT(elem))) {
+            webkit_dom_element_focus(elem);
             return TRUE;
         }
     }
 
     /* Look for editable elements in frames too. */
-    collection = webkit_dom_document_get_elements_by_tag_name_as_html_collection(doc, "iframe");
-    len        = webkit_dom_html_collection_get_length(collection);
-
-    for (i = 0; i < len; i++) {
-        node      = webkit_dom_html_collection_item(collection, i);
-        frame_doc = webkit_dom_html_iframe_element_get_content_document(WEBKIT_DOM_HTML_IFRAME_ELEMENT(node));
+    for (i = 0; i < cache->frames->len; i++) {
+        frame_doc = webkit_dom_html_iframe_element_get_content_document(
+                WEBKIT_DOM_HTML_IFRAME_ELEMENT(cache->frames->pdata[i]));
         /* Stop on first frame with focused element. */
         if (ext_dom_focus_input(frame_doc)) {
-            g_object_unref(collection);
             return TRUE;
         }
     }
-    g_object_unref(collection);
 
     return FALSE;
 }
@@ -170,32 +125,243 @@ char *ext_dom_editable_get_value(WebKitDOMElement *element)
     return value;
 }
 
-void ext_dom_lock_input(WebKitDOMDocument *parent, char *element_id)
+/**
+ * Sets the content of given editable element.
+ */
+void ext_dom_editable_set_value(WebKitDOMElement *element, const char *value)
+{
+    if (webkit_dom_html_element_get_is_content_editable(WEBKIT_DOM_HTML_ELEMENT(element))) {
+        webkit_dom_html_element_set_inner_text(WEBKIT_DOM_HTML_ELEMENT(element), value, NULL);
+    } else if (WEBKIT_DOM_IS_HTML_INPUT_ELEMENT(element)) {
+        webkit_dom_html_input_element_set_value(WEBKIT_DOM_HTML_INPUT_ELEMENT(element), value);
+    } else if (WEBKIT_DOM_IS_HTML_TEXT_AREA_ELEMENT(element)) {
+        webkit_dom_html_text_area_element_set_value(WEBKIT_DOM_HTML_TEXT_AREA_ELEMENT(element), value);
+    }
+}
+
+/**
+ * Returns the focused element of the document. If the focus is within an
+ * iframe, the focused element of the frame is returned.
+ */
+WebKitDOMElement *ext_dom_get_active_element(WebKitDOMDocument *doc)
 {
     WebKitDOMElement *elem;
+    WebKitDOMDocument *frame_doc;
 
-    elem = webkit_dom_document_get_element_by_id(parent, element_id);
-    if (elem != NULL) {
-        webkit_dom_element_set_attribute(elem, "disabled", "true", NULL);
+    elem = webkit_dom_document_get_active_element(doc);
+    while (elem && WEBKIT_DOM_IS_HTML_IFRAME_ELEMENT(elem)) {
+        frame_doc = webkit_dom_html_iframe_element_get_content_document(WEBKIT_DOM_HTML_IFRAME_ELEMENT(elem));
+        if (!frame_doc) {
+            break;
+        }
+        elem = webkit_dom_document_get_active_element(frame_doc);
     }
+
+    return elem;
 }
 
-void ext_dom_unlock_input(WebKitDOMDocument *parent, char *element_id)
+void ext_dom_lock_input(WebKitDOMElement *element)
 {
-    WebKitDOMElement *elem;
+    webkit_dom_element_set_attribute(element, "disabled", "true", NULL);
+}
+
+void ext_dom_unlock_input(WebKitDOMElement *element)
+{
+    webkit_dom_element_remove_attribute(element, "disabled");
+    webkit_dom_element_focus(element);
+}
+
+/**
+ * Scrolls the document like the normal mode scroll commands given by the key
+ * of the command in mode. Returns FALSE if the mode is not known.
+ */
+gboolean ext_dom_scroll(WebKitDOMDocument *doc, char mode, int step, int count)
+{
+    WebKitDOMDOMWindow *win;
+    WebKitDOMElement *de;
+    WebKitDOMHTMLElement *body;
+    gdouble x = 0, y = 0, ph;
+    int c = count ? count : 1;
+    gboolean rel = TRUE;
+
+    if (!(win = webkit_dom_document_get_default_view(doc))) {
+        return FALSE;
+    }
+    ph = webkit_dom_dom_window_get_inner_height(win);
+
+    switch (mode) {
+        case 'j':
+            y = c * step;
+            break;
+        case 'h':
+            x = -c * step;
+            break;
+        case 'k':
+            y = -c * step;
+            break;
+        case 'l':
+            x = c * step;
+            break;
+        case 0x04: /* ^D */
+            y = c * ph / 2;
+            break;
+        case 0x15: /* ^U */
+            y = -c * ph / 2;
+            break;
+        case 0x06: /* ^F */
+            y = c * ph;
+            break;
+        case 0x02: /* ^B */
+            y = -c * ph;
+            break;
+        case 'G': /* fall through - gg and G differ only in y value when no count is given */
+        case 'g':
+            x = webkit_dom_dom_window_get_scroll_x(win);
+            if (count) {
+                if ((de = webkit_dom_document_get_document_element(doc))) {
+                    y = c * ((webkit_dom_element_get_scroll_height(de) - ph) / 100);
+                }
+            } else if ('G' == mode && (body = webkit_dom_document_get_body(doc))) {
+                y = webkit_dom_element_get_scroll_height(WEBKIT_DOM_ELEMENT(body));
+            }
+            rel = FALSE;
+            break;
+        case '0':
+            y   = webkit_dom_dom_window_get_scroll_y(win);
+            rel = FALSE;
+            break;
+        case '\'': /* jump to the vertical position given by step */
+            x   = webkit_dom_dom_window_get_scroll_x(win);
+            y   = step;
+            rel = FALSE;
+            break;
+        case '$':
+            if ((body = webkit_dom_document_get_body(doc))) {
+                x = webkit_dom_element_get_scroll_width(WEBKIT_DOM_ELEMENT(body));
+            }
+            y   = webkit_dom_dom_window_get_scroll_y(win);
+            rel = FALSE;
+            break;
+        default:
+            g_object_unref(win);
+            return FALSE;
+    }
+
+    if (rel) {
+        webkit_dom_dom_window_scroll_by(win, x, y);
+    } else {
+        webkit_dom_dom_window_scroll_to(win, x, y);
+    }
+    g_object_unref(win);
+
+    return TRUE;
+}
+
+/**
+ * Checks if the element is an input or textarea that takes text.
+ */
+static gboolean is_editable_input(WebKitDOMElement *element)
+{
+    char *type;
+    gboolean result;
 
-    elem = webkit_dom_document_get_element_by_id(parent, element_id);
-    if (elem != NULL) {
-        webkit_dom_element_remove_attribute(elem, "disabled");
-        webkit_dom_element_focus(elem);
+    if (WEBKIT_DOM_IS_HTML_TEXT_AREA_ELEMENT(element)) {
+        return TRUE;
+    }
+    if (!WEBKIT_DOM_IS_HTML_INPUT_ELEMENT(element)) {
+        return FALSE;
     }
+
+    type   = webkit_dom_html_input_element_get_input_type(WEBKIT_DOM_HTML_INPUT_ELEMENT(element));
+    result = bsearch(type ? type : "", editable_types, G_N_ELEMENTS(editable_types),
+            sizeof(editable_types[0]), compare_type) != NULL;
+    g_free(type);
+
+    return result;
+}
+
+static int compare_type(const void *a, const void *b)
+{
+    return g_ascii_strcasecmp((const char *)a, *(const char **)b);
 }
 
 /**
- * Indicates if the give nelement is visible.
+ * Returns the input, textarea and iframe elements of the document. They are
+ * collected in a single walk over the document and kept until nodes are
+ * inserted or removed.
+ */
+static InputCache *get_input_cache(WebKitDOMDocument *doc)
+{
+    InputCache *cache;
+    WebKitDOMTreeWalker *walker;
+    WebKitDOMNode *node;
+
+    if ((cache = g_object_get_data(G_OBJECT(doc), INPUT_CACHE_KEY))) {
+        return cache;
+    }
+
+    walker = webkit_dom_document_create_tree_walker(doc, WEBKIT_DOM_NODE(doc),
+            WEBKIT_DOM_NODE_FILTER_SHOW_ELEMENT, NULL, FALSE, NULL);
+    if (!walker) {
+        return NULL;
+    }
+
+    cache           = g_slice_new(InputCache);
+    cache->elements = g_ptr_array_new_with_free_func(g_object_unref);
+    cache->frames   = g_ptr_array_new_with_free_func(g_object_unref);
+
+    while ((node = webkit_dom_tree_walker_next_node(walker))) {
+        if (WEBKIT_DOM_IS_HTML_INPUT_ELEMENT(node) || WEBKIT_DOM_IS_HTML_TEXT_AREA_ELEMENT(node)) {
+            g_ptr_array_add(cache->elements, g_object_ref(node));
+        } else if (WEBKIT_DOM_IS_HTML_IFRAME_ELEMENT(node)) {
+            g_ptr_array_add(cache->frames, g_object_ref(node));
+        }
+    }
+    g_object_unref(walker);
+
+    g_object_set_data_full(G_OBJECT(doc), INPUT_CACHE_KEY, cache, input_cache_free);
+
+    /* Mutation events are only observed while there is a cache. Changes of
+     * the type attribute are not observed, the type is checked on use. */
+    webkit_dom_event_target_add_event_listener(WEBKIT_DOM_EVENT_TARGET(doc),
+            "DOMNodeInserted", G_CALLBACK(on_dom_changed), TRUE, NULL);
+    webkit_dom_event_target_add_event_listener(WEBKIT_DOM_EVENT_TARGET(doc),
+            "DOMNodeRemoved", G_CALLBACK(on_dom_changed), TRUE, NULL);
+
+    return cache;
+}
+
+static void input_cache_free(gpointer data)
+{
+    InputCache *cache = (InputCache *)data;
+
+    g_ptr_array_free(cache->elements, TRUE);
+    g_ptr_array_free(cache->frames, TRUE);
+    g_slice_free(InputCache, cache);
+}
+
+/**
+ * Drops the input cache of the document the listener was added to.
+ */
+static void on_dom_changed(WebKitDOMEventTarget *target, WebKitDOMEvent *event,
+        gpointer data)
+{
+    webkit_dom_event_target_remove_event_listener(target, "DOMNodeInserted",
+            G_CALLBACK(on_dom_changed), TRUE);
+    webkit_dom_event_target_remove_event_listener(target, "DOMNodeRemoved",
+            G_CALLBACK(on_dom_changed), TRUE);
+    g_object_set_data(G_OBJECT(target), INPUT_CACHE_KEY, NULL);
+}
+
+/**
+ * Indicates if the given element is visible. Elements that are not rendered,
+ * like those with display none or within a hidden parent, have no size.
  */
 static gboolean is_element_visible(WebKitDOMHTMLElement *element)
 {
-    return TRUE;
+    WebKitDOMElement *elem = WEBKIT_DOM_ELEMENT(element);
+
+    return webkit_dom_element_get_offset_width(elem) > 0
+        || webkit_dom_element_get_offset_height(elem) > 0;
 }
 
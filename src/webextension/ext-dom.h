@@ -26,7 +26,10 @@
 gboolean ext_dom_is_editable(WebKitDOMElement *element);
 gboolean ext_dom_focus_input(WebKitDOMDocument *doc);
 char *ext_dom_editable_get_value(WebKitDOMElement *element);
-void ext_dom_lock_input(WebKitDOMDocument *parent, char *element_id);
-void ext_dom_unlock_input(WebKitDOMDocument *parent, char *element_id);
+void ext_dom_editable_set_value(WebKitDOMElement *element, const char *value);
+WebKitDOMElement *ext_dom_get_active_element(WebKitDOMDocument *doc);
+void ext_dom_lock_input(WebKitDOMElement *element);
+void ext_dom_unlock_input(WebKitDOMElement *element);
+gboolean ext_dom_scroll(WebKitDOMDocument *doc, char mode, int step, int count);
 
 #endif /* end of include guard: _EXT-DOM_H */
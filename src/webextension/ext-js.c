@@ -0,0 +1,225 @@
+/**
+ * vimb - a webkit based vim like browser.
+ *
+ * Copyright (C) 2012-2018 Daniel Carl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+#include <glib.h>
+#include <JavaScriptCore/JavaScript.h>
+#include <webkit2/webkit-web-extension.h>
+
+#include "../scripts/scripts.h"
+#include "ext-js.h"
+
+#define JS_FUNCTIONS_KEY "vimb-js-functions"
+#define JS_MAX_PARAMS    6
+
+static JSObjectRef get_function(WebKitWebPage *page, JSGlobalContextRef ctx,
+        ExtJsFunction func, JSValueRef *exc);
+static JSValueRef variant_to_ref(JSContextRef ctx, GVariant *value);
+static void on_window_object_cleared(WebKitScriptWorld *world,
+        WebKitWebPage *page, WebKitFrame *frame, gpointer data);
+
+/* Compiled functions of a page. They belong to the global object of the main
+ * frame and are dropped when this is cleared. */
+typedef struct {
+    JSGlobalContextRef ctx;
+    JSObjectRef        functions[EXT_JS_LAST];
+} JsFunctions;
+
+static const struct {
+    const char *params[JS_MAX_PARAMS + 1];
+    const char *body;
+} registry[EXT_JS_LAST] = {
+    [EXT_JS_HINTS_INIT] = {
+        {"mode", "keepOpen", "maxHints", "hintKeys", "followLast", "keysSameLength"},
+        "return hints.init(mode,keepOpen,maxHints,hintKeys,followLast,keysSameLength);"
+    },
+    [EXT_JS_HINTS_FILTER]             = {{"text"}, "return hints.filter(text);"},
+    [EXT_JS_HINTS_UPDATE]             = {{"n"}, "return hints.update(n);"},
+    [EXT_JS_HINTS_FOCUS]              = {{"back"}, "return hints.focus(back);"},
+    [EXT_JS_HINTS_FIRE]               = {{NULL}, "return hints.fire();"},
+    [EXT_JS_HINTS_CLEAR]              = {{"keepOpen"}, "return hints.clear(keepOpen);"},
+    [EXT_JS_INCREMENT_URI_NUMBER]     = {{"c"}, JS_INCREMENT_URI_NUMBER},
+};
+
+
+/**
+ * Drops the compiled functions of a page when its main frame gets a new
+ * global object.
+ */
+void ext_js_init(void)
+{
+    g_signal_connect(webkit_script_world_get_default(), "window-object-cleared",
+            G_CALLBACK(on_window_object_cleared), NULL);
+}
+
+/**
+ * Calls the registered function with the values of the args tuple as
+ * arguments. The function is compiled on the first call for the page. Returns
+ * FALSE if the function threw an exception which is put into result in this
+ * case.
+ */
+gboolean ext_js_call(WebKitWebPage *page, ExtJsFunction func, GVariant *args,
+        JSGlobalContextRef *ctx, JSValueRef *result)
+{
+    JSObjectRef function;
+    JSValueRef argv[JS_MAX_PARAMS], exc = NULL, res;
+    gsize argc, i;
+
+    *ctx = webkit_frame_get_javascript_context_for_script_world(
+        webkit_web_page_get_main_frame(page),
+        webkit_script_world_get_default()
+    );
+
+    function = get_function(page, *ctx, func, &exc);
+    if (!function) {
+        *result = exc ? exc : JSValueMakeUndefined(*ctx);
+        return FALSE;
+    }
+
+    argc = MIN(g_variant_n_children(args), JS_MAX_PARAMS);
+    for (i = 0; i < argc; i++) {
+        GVariant *value = g_variant_get_child_value(args, i);
+        argv[i] = variant_to_ref(*ctx, value);
+        g_variant_unref(value);
+    }
+
+    res = JSObjectCallAsFunction(*ctx, function, NULL, argc, argv, &exc);
+    if (exc) {
+        *result = exc;
+        return FALSE;
+    }
+
+    *result = res;
+    return TRUE;
+}
+
+/**
+ * Returns the compiled function of the page or NULL if the function could not
+ * be compiled.
+ */
+static JSObjectRef get_function(WebKitWebPage *page, JSGlobalContextRef ctx,
+        ExtJsFunction func, JSValueRef *exc)
+{
+    JsFunctions *fns;
+    JSStringRef names[JS_MAX_PARAMS], body;
+    unsigned int n;
+
+    if ((guint)func >= EXT_JS_LAST) {
+        return NULL;
+    }
+
+    fns = g_object_get_data(G_OBJECT(page), JS_FUNCTIONS_KEY);
+    if (!fns || fns->ctx != ctx) {
+        /* The functions of another context must not be unprotected here,
+         * this context may be gone already. */
+        fns      = g_new0(JsFunctions, 1);
+        fns->ctx = ctx;
+        g_object_set_data_full(G_OBJECT(page), JS_FUNCTIONS_KEY, fns, g_free);
+    }
+    if (fns->functions[func]) {
+        return fns->functions[func];
+    }
+
+    for (n = 0; registry[func].params[n]; n++) {
+        names[n] = JSStringCreateWithUTF8CString(registry[func].params[n]);
+    }
+    body = JSStringCreateWithUTF8CString(registry[func].body);
+
+    fns->functions[func] = JSObjectMakeFunction(ctx, NULL, n, names, body, NULL, 1, exc);
+
+    JSStringRelease(body);
+    while (n--) {
+        JSStringRelease(names[n]);
+    }
+
+    /* Keep the function alive as long as it is cached. */
+    if (fns->functions[func]) {
+        JSValueProtect(ctx, fns->functions[func]);
+    }
+
+    return fns->functions[func];
+}
+
+/**
+ * Converts the basic GVariant value into a JavaScript value. Nothing of maybe
+ * types becomes null.
+ */
+static JSValueRef variant_to_ref(JSContextRef ctx, GVariant *value)
+{
+    JSStringRef str;
+    JSValueRef ref;
+    GVariant *inner;
+
+    if (g_variant_is_of_type(value, G_VARIANT_TYPE_MAYBE)) {
+        if (!(inner = g_variant_get_maybe(value))) {
+            return JSValueMakeNull(ctx);
+        }
+        ref = variant_to_ref(ctx, inner);
+        g_variant_unref(inner);
+
+        return ref;
+    }
+
+    switch (g_variant_classify(value)) {
+        case G_VARIANT_CLASS_BOOLEAN:
+            return JSValueMakeBoolean(ctx, g_variant_get_boolean(value));
+
+        case G_VARIANT_CLASS_INT32:
+            return JSValueMakeNumber(ctx, g_variant_get_int32(value));
+
+        case G_VARIANT_CLASS_UINT32:
+            return JSValueMakeNumber(ctx, g_variant_get_uint32(value));
+
+        case G_VARIANT_CLASS_UINT64:
+            return JSValueMakeNumber(ctx, g_variant_get_uint64(value));
+
+        case G_VARIANT_CLASS_DOUBLE:
+            return JSValueMakeNumber(ctx, g_variant_get_double(value));
+
+        case G_VARIANT_CLASS_STRING:
+            str = JSStringCreateWithUTF8CString(g_variant_get_string(value, NULL));
+            ref = JSValueMakeString(ctx, str);
+            JSStringRelease(str);
+
+            return ref;
+
+        default:
+            return JSValueMakeUndefined(ctx);
+    }
+}
+
+static void on_window_object_cleared(WebKitScriptWorld *world,
+        WebKitWebPage *page, WebKitFrame *frame, gpointer data)
+{
+    JsFunctions *fns;
+    int i;
+
+    if (!webkit_frame_is_main_frame(frame)) {
+        return;
+    }
+    fns = g_object_get_data(G_OBJECT(page), JS_FUNCTIONS_KEY);
+    if (!fns) {
+        return;
+    }
+    for (i = 0; i < EXT_JS_LAST; i++) {
+        if (fns->functions[i]) {
+            JSValueUnprotect(fns->ctx, fns->functions[i]);
+        }
+    }
+    g_object_set_data(G_OBJECT(page), JS_FUNCTIONS_KEY, NULL);
+}
@@ -18,13 +18,21 @@
  */
 
 #include <JavaScriptCore/JavaScript.h>
+#include <fcntl.h>
 #include <gio/gio.h>
+#include <gio/gunixfdlist.h>
+#include <gio/gunixinputstream.h>
+#include <gio/gunixoutputstream.h>
 #include <glib.h>
+#include <glib-unix.h>
+#include <string.h>
 #include <libsoup/soup.h>
 #include <webkit2/webkit-web-extension.h>
 
 #include "ext-main.h"
 #include "ext-dom.h"
+#include "ext-js.h"
+#include "ext-search.h"
 #include "ext-util.h"
 
 static gboolean on_authorize_authenticated_peer(GDBusAuthObserver *observer,
@@ -44,6 +52,14 @@ static WebKitWebPage *get_web_page_or_return_dbus_error(GDBusMethodInvocation *i
 static void dbus_handle_method_call(GDBusConnection *conn, const char *sender,
         const char *object_path, const char *interface_name, const char *method,
         GVariant *parameters, GDBusMethodInvocation *invocation, gpointer data);
+static void get_editable_state(GDBusMethodInvocation *invocation,
+        WebKitWebPage *page);
+static void on_editable_value_written(GObject *stream, GAsyncResult *result,
+        gpointer value);
+static void set_editable_value(GDBusMethodInvocation *invocation, guint key,
+        gint32 handle);
+static void on_editable_value_read(GObject *stream, GAsyncResult *result,
+        gpointer element);
 static void on_editable_change_focus(WebKitDOMEventTarget *target,
         WebKitDOMEvent *event, WebKitWebPage *page);
 static void on_page_created(WebKitWebExtension *ext, WebKitWebPage *webpage, gpointer data);
@@ -70,9 +86,34 @@ static const char introspection_xml[] =
     "   <arg type='t' name='page_id' direction='in'/>"
     "   <arg type='s' name='js' direction='in'/>"
     "  </method>"
+    "  <method name='CallJs'>"
+    "   <arg type='t' name='page_id' direction='in'/>"
+    "   <arg type='u' name='function' direction='in'/>"
+    "   <arg type='v' name='args' direction='in'/>"
+    "   <arg type='b' name='success' direction='out'/>"
+    "   <arg type='s' name='result' direction='out'/>"
+    "  </method>"
+    "  <method name='CallJsNoResult'>"
+    "   <arg type='t' name='page_id' direction='in'/>"
+    "   <arg type='u' name='function' direction='in'/>"
+    "   <arg type='v' name='args' direction='in'/>"
+    "  </method>"
     "  <method name='FocusInput'>"
     "   <arg type='t' name='page_id' direction='in'/>"
     "  </method>"
+    "  <method name='Scroll'>"
+    "   <arg type='t' name='page_id' direction='in'/>"
+    "   <arg type='y' name='mode' direction='in'/>"
+    "   <arg type='i' name='step' direction='in'/>"
+    "   <arg type='i' name='count' direction='in'/>"
+    "  </method>"
+    "  <method name='Search'>"
+    "   <arg type='t' name='page_id' direction='in'/>"
+    "   <arg type='s' name='query' direction='in'/>"
+    "   <arg type='u' name='flags' direction='in'/>"
+    "   <arg type='i' name='step' direction='in'/>"
+    "   <arg type='u' name='count' direction='out'/>"
+    "  </method>"
     "  <signal name='PageCreated'>"
     "   <arg type='t' name='page_id' direction='out'/>"
     "  </signal>"
@@ -85,13 +126,14 @@ static const char introspection_xml[] =
     "  <method name='SetHeaderSetting'>"
     "   <arg type='s' name='headers' direction='in'/>"
     "  </method>"
-    "  <method name='LockInput'>"
+    "  <method name='GetEditableState'>"
     "   <arg type='t' name='page_id' direction='in'/>"
-    "   <arg type='s' name='elemend_id' direction='in'/>"
+    "   <arg type='u' name='key' direction='out'/>"
+    "   <arg type='h' name='value' direction='out'/>"
     "  </method>"
-    "  <method name='UnlockInput'>"
-    "   <arg type='t' name='page_id' direction='in'/>"
-    "   <arg type='s' name='elemend_id' direction='in'/>"
+    "  <method name='SetEditableValue'>"
+    "   <arg type='u' name='key' direction='in'/>"
+    "   <arg type='h' name='value' direction='in'/>"
     "  </method>"
     " </interface>"
     "</node>";
@@ -103,6 +145,8 @@ struct Ext {
     GHashTable          *headers;
     GHashTable          *documents;
     GArray              *page_created_signals;
+    GHashTable          *editables;     /* elements opened in the editor by key */
+    guint               editable_key;
 };
 struct Ext ext = {0};
 
@@ -123,6 +167,7 @@ void webkit_web_extension_initialize_with_user_data(WebKitWebExtension *extensio
     }
 
     g_signal_connect(extension, "page-created", G_CALLBACK(on_page_created), NULL);
+    ext_js_init();
 
     observer = g_dbus_auth_observer_new();
     g_signal_connect(observer, "authorize-authenticated-peer",
@@ -413,6 +458,31 @@ static void dbus_handle_method_call(GDBusConnection *conn, const char *sender,
             g_dbus_method_invocation_return_value(invocation, g_variant_new("(bs)", success, result));
             g_free(result);
         }
+    } else if (g_str_has_prefix(method, "CallJs")) {
+        char *result = NULL;
+        gboolean success;
+        guint32 func;
+        GVariant *args;
+        JSValueRef ref = NULL;
+        JSGlobalContextRef jsContext;
+
+        g_variant_get(parameters, "(tuv)", &pageid, &func, &args);
+        page = get_web_page_or_return_dbus_error(invocation, WEBKIT_WEB_EXTENSION(extension), pageid);
+        if (!page) {
+            g_variant_unref(args);
+            return;
+        }
+
+        success = ext_js_call(page, func, args, &jsContext, &ref);
+        g_variant_unref(args);
+
+        if (!g_strcmp0(method, "CallJsNoResult")) {
+            g_dbus_method_invocation_return_value(invocation, NULL);
+        } else {
+            result = ext_util_js_ref_to_string(jsContext, ref);
+            g_dbus_method_invocation_return_value(invocation, g_variant_new("(bs)", success, result));
+            g_free(result);
+        }
     } else if (!g_strcmp0(method, "FocusInput")) {
         g_variant_get(parameters, "(t)", &pageid);
         page = get_web_page_or_return_dbus_error(invocation, WEBKIT_WEB_EXTENSION(extension), pageid);
@@ -421,6 +491,29 @@ static void dbus_handle_method_call(GDBusConnection *conn, const char *sender,
         }
         ext_dom_focus_input(webkit_web_page_get_dom_document(page));
         g_dbus_method_invocation_return_value(invocation, NULL);
+    } else if (!g_strcmp0(method, "Scroll")) {
+        guchar mode;
+        gint32 step, count;
+
+        g_variant_get(parameters, "(tyii)", &pageid, &mode, &step, &count);
+        page = get_web_page_or_return_dbus_error(invocation, WEBKIT_WEB_EXTENSION(extension), pageid);
+        if (!page) {
+            return;
+        }
+        ext_dom_scroll(webkit_web_page_get_dom_document(page), mode, step, count);
+        g_dbus_method_invocation_return_value(invocation, NULL);
+    } else if (!g_strcmp0(method, "Search")) {
+        const char *query;
+        guint32 flags;
+        gint32 step;
+
+        g_variant_get(parameters, "(t&sui)", &pageid, &query, &flags, &step);
+        page = get_web_page_or_return_dbus_error(invocation, WEBKIT_WEB_EXTENSION(extension), pageid);
+        if (!page) {
+            return;
+        }
+        g_dbus_method_invocation_return_value(invocation, g_variant_new("(u)",
+                ext_search(webkit_web_page_get_dom_document(page), query, flags, step)));
     } else if (!g_strcmp0(method, "SetHeaderSetting")) {
         g_variant_get(parameters, "(s)", &value);
 
@@ -430,23 +523,145 @@ static void dbus_handle_method_call(GDBusConnection *conn, const char *sender,
         }
         ext.headers = soup_header_parse_param_list(value);
         g_dbus_method_invocation_return_value(invocation, NULL);
-    } else if (!g_strcmp0(method, "LockInput")) {
-        g_variant_get(parameters, "(ts)", &pageid, &value);
+    } else if (!g_strcmp0(method, "GetEditableState")) {
+        g_variant_get(parameters, "(t)", &pageid);
         page = get_web_page_or_return_dbus_error(invocation, WEBKIT_WEB_EXTENSION(extension), pageid);
         if (!page) {
             return;
         }
-        ext_dom_lock_input(webkit_web_page_get_dom_document(page), value);
-        g_dbus_method_invocation_return_value(invocation, NULL);
-    } else if (!g_strcmp0(method, "UnlockInput")) {
-        g_variant_get(parameters, "(ts)", &pageid, &value);
-        page = get_web_page_or_return_dbus_error(invocation, WEBKIT_WEB_EXTENSION(extension), pageid);
-        if (!page) {
-            return;
+        get_editable_state(invocation, page);
+    } else if (!g_strcmp0(method, "SetEditableValue")) {
+        guint32 key;
+        gint32 handle;
+
+        g_variant_get(parameters, "(uh)", &key, &handle);
+        set_editable_value(invocation, key, handle);
+    }
+}
+
+/**
+ * Returns the key of the focused editable element and the read end of a pipe
+ * its value is written to. The element is disabled until SetEditableValue is
+ * called with the key.
+ */
+static void get_editable_state(GDBusMethodInvocation *invocation,
+        WebKitWebPage *page)
+{
+    WebKitDOMElement *element;
+    GUnixFDList *fdlist;
+    GOutputStream *stream;
+    GError *error = NULL;
+    char *value;
+    int fds[2];
+
+    element = ext_dom_get_active_element(webkit_web_page_get_dom_document(page));
+    if (!element || !ext_dom_is_editable(element)) {
+        g_dbus_method_invocation_return_error(invocation, G_DBUS_ERROR,
+                G_DBUS_ERROR_FAILED, "No editable element focused");
+        return;
+    }
+    if (!g_unix_open_pipe(fds, FD_CLOEXEC, &error)
+            || !g_unix_set_fd_nonblocking(fds[1], TRUE, &error)) {
+        g_dbus_method_invocation_return_gerror(invocation, error);
+        g_error_free(error);
+        return;
+    }
+
+    if (!ext.editables) {
+        ext.editables = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+                NULL, g_object_unref);
+    }
+    g_hash_table_insert(ext.editables, GUINT_TO_POINTER(++ext.editable_key),
+            g_object_ref(element));
+    ext_dom_lock_input(element);
+
+    /* The value is written while the UI reads it, so that large texts don't
+     * block any of the processes. */
+    value  = ext_dom_editable_get_value(element);
+    stream = g_unix_output_stream_new(fds[1], TRUE);
+    g_output_stream_write_all_async(stream, value, value ? strlen(value) : 0,
+            G_PRIORITY_DEFAULT, NULL, on_editable_value_written, value);
+
+    /* The fd list takes the ownership of the read end. */
+    fdlist = g_unix_fd_list_new_from_array(&fds[0], 1);
+    g_dbus_method_invocation_return_value_with_unix_fd_list(invocation,
+            g_variant_new("(uh)", ext.editable_key, 0), fdlist);
+    g_object_unref(fdlist);
+}
+
+static void on_editable_value_written(GObject *stream, GAsyncResult *result,
+        gpointer value)
+{
+    g_output_stream_write_all_finish(G_OUTPUT_STREAM(stream), result, NULL, NULL);
+    g_object_unref(stream);
+    g_free(value);
+}
+
+/**
+ * Reads the new value of the element from the passed pipe and enables the
+ * element again. If handle is -1 the element is only enabled.
+ */
+static void set_editable_value(GDBusMethodInvocation *invocation, guint key,
+        gint32 handle)
+{
+    WebKitDOMElement *element;
+    GUnixFDList *fdlist;
+    GInputStream *in;
+    GOutputStream *out;
+    GError *error = NULL;
+    int fd;
+
+    element = ext.editables ? g_hash_table_lookup(ext.editables, GUINT_TO_POINTER(key)) : NULL;
+    if (!element) {
+        g_dbus_method_invocation_return_error(invocation, G_DBUS_ERROR,
+                G_DBUS_ERROR_INVALID_ARGS, "Invalid editable key: %u", key);
+        return;
+    }
+    g_object_ref(element);
+    g_hash_table_remove(ext.editables, GUINT_TO_POINTER(key));
+
+    fdlist = g_dbus_message_get_unix_fd_list(g_dbus_method_invocation_get_message(invocation));
+    if (handle < 0 || !fdlist || (fd = g_unix_fd_list_get(fdlist, handle, &error)) == -1) {
+        if (error) {
+            g_warning("Could not get editable value: %s", error->message);
+            g_error_free(error);
         }
-        ext_dom_unlock_input(webkit_web_page_get_dom_document(page), value);
+        ext_dom_unlock_input(element);
+        g_object_unref(element);
         g_dbus_method_invocation_return_value(invocation, NULL);
+        return;
     }
+
+    in  = g_unix_input_stream_new(fd, TRUE);
+    out = g_memory_output_stream_new_resizable();
+    g_output_stream_splice_async(out, in, G_OUTPUT_STREAM_SPLICE_CLOSE_SOURCE,
+            G_PRIORITY_DEFAULT, NULL, on_editable_value_read, element);
+    g_object_unref(in);
+
+    g_dbus_method_invocation_return_value(invocation, NULL);
+}
+
+static void on_editable_value_read(GObject *stream, GAsyncResult *result,
+        gpointer element)
+{
+    GError *error = NULL;
+    char *value;
+
+    if (g_output_stream_splice_finish(G_OUTPUT_STREAM(stream), result, &error) == -1) {
+        g_warning("Could not read editable value: %s", error->message);
+        g_error_free(error);
+    } else {
+        /* Terminate the received text to use it as string. */
+        g_output_stream_write_all(G_OUTPUT_STREAM(stream), "", 1, NULL, NULL, NULL);
+        g_output_stream_close(G_OUTPUT_STREAM(stream), NULL, NULL);
+        value = g_memory_output_stream_steal_data(G_MEMORY_OUTPUT_STREAM(stream));
+        ext_dom_editable_set_value(WEBKIT_DOM_ELEMENT(element), value);
+        g_free(value);
+    }
+
+    ext_dom_unlock_input(WEBKIT_DOM_ELEMENT(element));
+    g_object_unref(element);
+    g_object_unref(stream);
 }
 
 /**
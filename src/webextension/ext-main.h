@@ -24,4 +24,24 @@
 #define VB_WEBEXTENSION_OBJECT_PATH  "/org/vimb/browser/WebExtension"
 #define VB_WEBEXTENSION_INTERFACE    "org.vimb.browser.WebExtension"
 
+/* Script functions that are compiled once per page by the web extension and
+ * called by their id with the CallJs method. */
+typedef enum {
+    EXT_JS_HINTS_INIT,
+    EXT_JS_HINTS_FILTER,
+    EXT_JS_HINTS_UPDATE,
+    EXT_JS_HINTS_FOCUS,
+    EXT_JS_HINTS_FIRE,
+    EXT_JS_HINTS_CLEAR,
+    EXT_JS_INCREMENT_URI_NUMBER,
+    EXT_JS_LAST
+} ExtJsFunction;
+
+/* How the query of the Search method is matched. Without flags it's matched
+ * literally. */
+typedef enum {
+    EXT_SEARCH_REGEX = (1<<0),  /* the query is a perl compatible pattern */
+    EXT_SEARCH_WORD  = (1<<1),  /* the query matches only whole words */
+} ExtSearchFlags;
+
 #endif /* end of include guard: _EXT_MAIN_H */
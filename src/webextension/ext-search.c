@@ -0,0 +1,548 @@
+/**
+ * vimb - a webkit based vim like browser.
+ *
+ * Copyright (C) 2012-2018 Daniel Carl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+#include <glib.h>
+#include <stdlib.h>
+#include <string.h>
+#include <webkitdom/webkitdom.h>
+
+#include "ext-main.h"
+#include "ext-search.h"
+
+#define TEXT_INDEX_KEY "vimb-text-index"
+
+/* A text node that contributes to the text of the index. */
+typedef struct {
+    WebKitDOMNode   *node;
+    gsize           start;      /* offset of the node's text in the index */
+    gboolean        space;      /* leading white space of the node is collapsed */
+} TextRun;
+
+typedef struct {
+    gsize           start;
+    gsize           end;
+} TextMatch;
+
+/* Visible text of a document with the matches of the last query. */
+typedef struct {
+    GString         *text;      /* text with collapsed white space */
+    GArray          *runs;      /* TextRun in document order */
+    char            *query;     /* query of the matches */
+    guint           flags;      /* ExtSearchFlags of the query */
+    GArray          *matches;   /* TextMatch at each position, may overlap for
+                                   literal queries */
+    int             current;    /* selected match or -1 */
+} TextIndex;
+
+static TextIndex *get_text_index(WebKitDOMDocument *doc);
+static void text_index_free(gpointer data);
+static void clear_run(gpointer data);
+static void on_dom_changed(WebKitDOMEventTarget *target, WebKitDOMEvent *event,
+        gpointer data);
+static gboolean is_tag(const char *tag, const char * const *tags, gsize len);
+static int compare_tag(const void *a, const void *b);
+static WebKitDOMElement *get_block(WebKitDOMElement *elem, char *tag);
+static void append_collapsed(GString *text, const char *data, gboolean *space);
+static char *collapse_query(const char *query);
+static GRegex *compile_query(const char *query, guint flags);
+static void find_matches(TextIndex *index, const char *query, guint flags);
+static void clear_matches(WebKitDOMDocument *doc, TextIndex *index);
+static guint count_matches(TextIndex *index);
+static void select_match(WebKitDOMDocument *doc, TextIndex *index, int step);
+static WebKitDOMNode *get_node_offset(TextIndex *index, gsize offset,
+        gboolean end, glong *node_offset);
+
+/* Elements whose text is not rendered as part of the page, sorted. */
+static const char *hidden_tags[] = {
+    "head", "noscript", "option", "script", "select", "style", "template",
+    "textarea", "title"
+};
+/* Elements that don't break the text flow, sorted. Text of different block
+ * elements is separated by white space. */
+static const char *inline_tags[] = {
+    "a", "abbr", "b", "bdi", "bdo", "big", "cite", "code", "data", "del",
+    "dfn", "em", "font", "i", "ins", "kbd", "label", "mark", "q", "s", "samp",
+    "small", "span", "strike", "strong", "sub", "sup", "time", "tt", "u", "var"
+};
+
+
+/**
+ * Searches the visible text of the document and returns the number of
+ * matches. Like the find controller of WebKit, the matching is case
+ * insensitive, white space of a literal query matches any white space and
+ * matches don't overlap.
+ *
+ * If step is not 0 the match step matches after the selected one is selected
+ * and scrolled into view, a negative step goes backwards. On a new query the
+ * steps start before the first or after the last match. An empty query ends
+ * the search and removes the selection made by it.
+ */
+guint ext_search(WebKitDOMDocument *doc, const char *query, guint flags, int step)
+{
+    TextIndex *index;
+
+    if (!doc || !query) {
+        return 0;
+    }
+    if (!*query) {
+        if ((index = g_object_get_data(G_OBJECT(doc), TEXT_INDEX_KEY))) {
+            clear_matches(doc, index);
+        }
+        return 0;
+    }
+    if (!(index = get_text_index(doc))) {
+        return 0;
+    }
+    find_matches(index, query, flags);
+    if (step) {
+        select_match(doc, index, step);
+    }
+
+    return count_matches(index);
+}
+
+/**
+ * Returns the text index of the document. It's built on first use after the
+ * document was loaded and dropped when the document is changed.
+ */
+static TextIndex *get_text_index(WebKitDOMDocument *doc)
+{
+    TextIndex *index;
+    TextRun run;
+    WebKitDOMTreeWalker *walker;
+    WebKitDOMNode *node;
+    WebKitDOMElement *parent, *last_parent = NULL, *block = NULL, *last_block = NULL;
+    gboolean visible = FALSE, space = TRUE;
+    char *tag, *data;
+
+    if ((index = g_object_get_data(G_OBJECT(doc), TEXT_INDEX_KEY))) {
+        return index;
+    }
+
+    walker = webkit_dom_document_create_tree_walker(doc, WEBKIT_DOM_NODE(doc),
+            WEBKIT_DOM_NODE_FILTER_SHOW_TEXT, NULL, FALSE, NULL);
+    if (!walker) {
+        return NULL;
+    }
+
+    index       = g_slice_new0(TextIndex);
+    index->text = g_string_sized_new(4096);
+    index->runs = g_array_new(FALSE, FALSE, sizeof(TextRun));
+    index->current = -1;
+    g_array_set_clear_func(index->runs, clear_run);
+
+    while ((node = webkit_dom_tree_walker_next_node(walker))) {
+        parent = webkit_dom_node_get_parent_element(node);
+        if (!parent) {
+            continue;
+        }
+        /* Consecutive text nodes mostly share the parent. */
+        if (parent != last_parent) {
+            last_parent = parent;
+            tag         = webkit_dom_element_get_tag_name(parent);
+            visible     = !is_tag(tag, hidden_tags, G_N_ELEMENTS(hidden_tags))
+                && (webkit_dom_element_get_offset_width(parent) > 0
+                    || webkit_dom_element_get_offset_height(parent) > 0);
+            block       = visible ? get_block(parent, tag) : NULL;
+            g_free(tag);
+        }
+        if (!visible) {
+            continue;
+        }
+
+        if (block != last_block) {
+            last_block = block;
+            if (!space) {
+                g_string_append_c(index->text, ' ');
+                space = TRUE;
+            }
+        }
+
+        run.start = index->text->len;
+        run.space = space;
+        data      = webkit_dom_character_data_get_data(WEBKIT_DOM_CHARACTER_DATA(node));
+        append_collapsed(index->text, data, &space);
+        g_free(data);
+
+        if (index->text->len > run.start) {
+            run.node = g_object_ref(node);
+            g_array_append_val(index->runs, run);
+        }
+    }
+    g_object_unref(walker);
+
+    g_object_set_data_full(G_OBJECT(doc), TEXT_INDEX_KEY, index, text_index_free);
+
+    /* The index is rebuilt on next use after any change of the document. */
+    webkit_dom_event_target_add_event_listener(WEBKIT_DOM_EVENT_TARGET(doc),
+            "DOMNodeInserted", G_CALLBACK(on_dom_changed), TRUE, NULL);
+    webkit_dom_event_target_add_event_listener(WEBKIT_DOM_EVENT_TARGET(doc),
+            "DOMNodeRemoved", G_CALLBACK(on_dom_changed), TRUE, NULL);
+    webkit_dom_event_target_add_event_listener(WEBKIT_DOM_EVENT_TARGET(doc),
+            "DOMCharacterDataModified", G_CALLBACK(on_dom_changed), TRUE, NULL);
+
+    return index;
+}
+
+static void text_index_free(gpointer data)
+{
+    TextIndex *index = (TextIndex *)data;
+
+    g_string_free(index->text, TRUE);
+    g_array_unref(index->runs);
+    if (index->matches) {
+        g_array_unref(index->matches);
+    }
+    g_free(index->query);
+    g_slice_free(TextIndex, index);
+}
+
+static void clear_run(gpointer data)
+{
+    g_object_unref(((TextRun *)data)->node);
+}
+
+static void on_dom_changed(WebKitDOMEventTarget *target, WebKitDOMEvent *event,
+        gpointer data)
+{
+    webkit_dom_event_target_remove_event_listener(target, "DOMNodeInserted",
+            G_CALLBACK(on_dom_changed), TRUE);
+    webkit_dom_event_target_remove_event_listener(target, "DOMNodeRemoved",
+            G_CALLBACK(on_dom_changed), TRUE);
+    webkit_dom_event_target_remove_event_listener(target, "DOMCharacterDataModified",
+            G_CALLBACK(on_dom_changed), TRUE);
+    g_object_set_data(G_OBJECT(target), TEXT_INDEX_KEY, NULL);
+}
+
+static gboolean is_tag(const char *tag, const char * const *tags, gsize len)
+{
+    return tag && bsearch(tag, tags, len, sizeof(tags[0]), compare_tag) != NULL;
+}
+
+static int compare_tag(const void *a, const void *b)
+{
+    /* Tag names of HTML documents are upper case. */
+    return g_ascii_strcasecmp((const char *)a, *(const char **)b);
+}
+
+/**
+ * Returns the nearest element that breaks the text flow starting with elem
+ * whose tag is given.
+ */
+static WebKitDOMElement *get_block(WebKitDOMElement *elem, char *tag)
+{
+    gboolean is_inline = is_tag(tag, inline_tags, G_N_ELEMENTS(inline_tags));
+
+    while (is_inline) {
+        elem = webkit_dom_node_get_parent_element(WEBKIT_DOM_NODE(elem));
+        if (!elem) {
+            return NULL;
+        }
+        tag       = webkit_dom_element_get_tag_name(elem);
+        is_inline = is_tag(tag, inline_tags, G_N_ELEMENTS(inline_tags));
+        g_free(tag);
+    }
+
+    return elem;
+}
+
+/**
+ * Appends data to text with each sequence of white space replaced by a single
+ * space. The space flag tells if text ends with a space.
+ */
+static void append_collapsed(GString *text, const char *data, gboolean *space)
+{
+    const char *p;
+
+    for (p = data; *p; p++) {
+        if (g_ascii_isspace(*p)) {
+            if (!*space) {
+                g_string_append_c(text, ' ');
+                *space = TRUE;
+            }
+        } else {
+            g_string_append_c(text, *p);
+            *space = FALSE;
+        }
+    }
+}
+
+/**
+ * Returns the query with collapsed white space as it's done for the text.
+ */
+static char *collapse_query(const char *query)
+{
+    GString *str = g_string_sized_new(strlen(query));
+    gboolean space = FALSE;
+
+    append_collapsed(str, query, &space);
+
+    return g_string_free(str, FALSE);
+}
+
+/**
+ * Returns the compiled query or NULL if the query is no valid pattern.
+ * Literal queries are matched in a lookahead, so that each position of a
+ * match is found, not only those after the end of the previous match.
+ */
+static GRegex *compile_query(const char *query, guint flags)
+{
+    GRegex *regex;
+    char *escaped, *pattern;
+
+    if (flags & EXT_SEARCH_REGEX) {
+        return g_regex_new(query, G_REGEX_CASELESS | G_REGEX_OPTIMIZE, 0, NULL);
+    }
+
+    escaped = g_regex_escape_string(query, -1);
+    if (flags & EXT_SEARCH_WORD) {
+        /* Unlike \b this works also for queries that start or end with
+         * other chars than those of words. UCP lets \w match all letters
+         * and not only the ASCII ones. */
+        pattern = g_strdup_printf("(*UCP)(?<!\\w)(%s)(?!\\w)", escaped);
+    } else {
+        pattern = g_strdup_printf("(?=(%s))", escaped);
+    }
+    regex = g_regex_new(pattern, G_REGEX_CASELESS | G_REGEX_OPTIMIZE, 0, NULL);
+    g_free(pattern);
+    g_free(escaped);
+
+    return regex;
+}
+
+/**
+ * Fills the matches of the index with those of query. If a literal query
+ * extends the query of the current matches, only the positions of these
+ * matches are checked instead of the whole text.
+ */
+static void find_matches(TextIndex *index, const char *query, guint flags)
+{
+    GRegex *regex;
+    GMatchInfo *info;
+    GArray *matches;
+    TextMatch match, *prev;
+    char *collapsed;
+    gsize i, len, limit;
+    int start, end;
+
+    /* White space of a pattern may be meant as is like in '[ ]{2}'. */
+    collapsed = flags & EXT_SEARCH_REGEX ? g_strdup(query) : collapse_query(query);
+    if (index->query && index->flags == flags && !strcmp(index->query, collapsed)) {
+        g_free(collapsed);
+        return;
+    }
+
+    matches = g_array_new(FALSE, FALSE, sizeof(TextMatch));
+    if (!(regex = compile_query(collapsed, flags))) {
+        /* Incomplete patterns are common while the query is typed, so this
+         * is no error but just nothing found. */
+    } else if (!flags && !index->flags && index->matches
+            && g_str_has_prefix(collapsed, index->query)) {
+        /* A match of the extended query is also a match of the previous
+         * query. A candidate is checked only against the few bytes a match
+         * can be long, to not check the whole remaining text for valid
+         * UTF-8 on each call. */
+        len = strlen(collapsed) * 3 + 16;
+        for (i = 0; i < index->matches->len; i++) {
+            prev  = &g_array_index(index->matches, TextMatch, i);
+            limit = MIN(index->text->len, prev->start + len);
+            while (limit < index->text->len && (index->text->str[limit] & 0xC0) == 0x80) {
+                limit--;
+            }
+            if (g_regex_match_full(regex, index->text->str + prev->start,
+                        limit - prev->start, 0, G_REGEX_MATCH_ANCHORED, &info, NULL)) {
+                g_match_info_fetch_pos(info, 1, &start, &end);
+                match.start = prev->start + start;
+                match.end   = prev->start + end;
+                g_array_append_val(matches, match);
+            }
+            g_match_info_free(info);
+        }
+    } else {
+        g_regex_match_full(regex, index->text->str, index->text->len, 0, 0, &info, NULL);
+        while (g_match_info_matches(info)) {
+            /* Literal and word queries have the match in the first group. */
+            g_match_info_fetch_pos(info, flags & EXT_SEARCH_REGEX ? 0 : 1, &start, &end);
+            /* Empty matches of patterns like 'x*' can't be selected. */
+            if (end > start) {
+                match.start = start;
+                match.end   = end;
+                g_array_append_val(matches, match);
+            }
+            g_match_info_next(info, NULL);
+        }
+        g_match_info_free(info);
+    }
+    if (regex) {
+        g_regex_unref(regex);
+    }
+
+    if (index->matches) {
+        g_array_unref(index->matches);
+    }
+    index->matches = matches;
+    index->current = -1;
+    index->flags   = flags;
+    g_free(index->query);
+    index->query = collapsed;
+}
+
+/**
+ * Drops the matches of the index and removes the selection of the current
+ * match if there is one.
+ */
+static void clear_matches(WebKitDOMDocument *doc, TextIndex *index)
+{
+    WebKitDOMDOMSelection *selection;
+
+    if (index->current >= 0
+            && (selection = webkit_dom_dom_window_get_selection(
+                    webkit_dom_document_get_default_view(doc)))) {
+        webkit_dom_dom_selection_remove_all_ranges(selection);
+        g_object_unref(selection);
+    }
+    if (index->matches) {
+        g_array_unref(index->matches);
+        index->matches = NULL;
+    }
+    g_free(index->query);
+    index->query   = NULL;
+    index->flags   = 0;
+    index->current = -1;
+}
+
+/**
+ * Returns the number of matches that don't overlap a previous match.
+ */
+static guint count_matches(TextIndex *index)
+{
+    TextMatch *match;
+    gsize i, end = 0;
+    guint count = 0;
+
+    for (i = 0; index->matches && i < index->matches->len; i++) {
+        match = &g_array_index(index->matches, TextMatch, i);
+        if (!count || match->start >= end) {
+            end = match->end;
+            count++;
+        }
+    }
+
+    return count;
+}
+
+/**
+ * Selects the match step matches after the current one and scrolls it into
+ * view. The selection wraps around at the start and end of the page.
+ */
+static void select_match(WebKitDOMDocument *doc, TextIndex *index, int step)
+{
+    TextMatch *match;
+    WebKitDOMNode *start, *end;
+    WebKitDOMRange *range;
+    WebKitDOMDOMSelection *selection;
+    WebKitDOMElement *parent;
+    GError *error = NULL;
+    glong start_offset, end_offset;
+    int len;
+
+    if (!index->matches || !(len = index->matches->len)) {
+        return;
+    }
+    if (index->current < 0) {
+        index->current = step > 0 ? -1 : len;
+    }
+    index->current = ((index->current + step) % len + len) % len;
+    match          = &g_array_index(index->matches, TextMatch, index->current);
+
+    start = get_node_offset(index, match->start, FALSE, &start_offset);
+    end   = get_node_offset(index, match->end, TRUE, &end_offset);
+    range = webkit_dom_document_create_range(doc);
+    webkit_dom_range_set_start(range, start, start_offset, &error);
+    if (!error) {
+        webkit_dom_range_set_end(range, end, end_offset, &error);
+    }
+    if (error) {
+        g_error_free(error);
+        g_object_unref(range);
+        return;
+    }
+
+    selection = webkit_dom_dom_window_get_selection(webkit_dom_document_get_default_view(doc));
+    if (selection) {
+        webkit_dom_dom_selection_remove_all_ranges(selection);
+        webkit_dom_dom_selection_add_range(selection, range);
+        g_object_unref(selection);
+    }
+    if ((parent = webkit_dom_node_get_parent_element(start))) {
+        webkit_dom_element_scroll_into_view_if_needed(parent, TRUE);
+    }
+    g_object_unref(range);
+}
+
+/**
+ * Returns the text node at the offset of the index text and the offset
+ * within the node in UTF-16 code units as used by DOM ranges. The end offset
+ * of a match is looked up in the node of the last matched char.
+ */
+static WebKitDOMNode *get_node_offset(TextIndex *index, gsize offset,
+        gboolean end, glong *node_offset)
+{
+    TextRun *run;
+    gsize key, lo = 0, hi = index->runs->len, mid, pos;
+    gboolean space;
+    char *data;
+    const char *p;
+    glong units = 0;
+
+    /* Find the last run that starts before the char at the offset. */
+    key = end && offset ? offset - 1 : offset;
+    while (lo + 1 < hi) {
+        mid = (lo + hi) / 2;
+        if (g_array_index(index->runs, TextRun, mid).start <= key) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+    run = &g_array_index(index->runs, TextRun, lo);
+
+    /* Walk the node text the way it was collapsed into the index. */
+    data  = webkit_dom_character_data_get_data(WEBKIT_DOM_CHARACTER_DATA(run->node));
+    space = run->space;
+    pos   = run->start;
+    for (p = data; *p && pos < offset; p = g_utf8_next_char(p)) {
+        if (g_ascii_isspace(*p)) {
+            if (!space) {
+                pos++;
+                space = TRUE;
+            }
+        } else {
+            pos  += g_utf8_next_char(p) - p;
+            space = FALSE;
+        }
+        /* Chars of 4 bytes need a surrogate pair in UTF-16. */
+        units += (guchar)*p >= 0xF0 ? 2 : 1;
+    }
+    g_free(data);
+
+    *node_offset = units;
+
+    return run->node;
+}
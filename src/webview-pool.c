@@ -0,0 +1,147 @@
+/**
+ * vimb - a webkit based vim like browser.
+ *
+ * Copyright (C) 2012-2018 Daniel Carl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+/* The pool holds webviews that are created in idle time before they are
+ * needed. Constructing a webview spawns its web process which loads the web
+ * extension and connects to the dbus server, so a new window taking a view
+ * from the pool skips this on its first navigation. */
+
+#include "config.h"
+#include <glib.h>
+
+#include "ext-proxy.h"
+#include "main.h"
+#include "setting.h"
+#include "webview-pool.h"
+
+static void schedule_refill(void);
+static gboolean refill(gpointer data);
+static void on_view_destroy(GtkWidget *widget, gpointer data);
+
+extern struct Vimb vb;
+
+static struct {
+    GQueue *views;
+    guint  size;
+    guint  refill_id;
+} pool;
+
+
+/**
+ * Starts filling the pool with given number of webviews in idle time. A size
+ * of 0 disables the pool.
+ */
+void webview_pool_init(guint size)
+{
+    pool.size  = size;
+    pool.views = g_queue_new();
+    schedule_refill();
+}
+
+/**
+ * Returns a prepared webview from the pool or NULL if the pool is empty. The
+ * returned webview has a floating reference like a newly created widget.
+ */
+WebKitWebView *webview_pool_take(void)
+{
+    WebKitWebView *view;
+
+    if (!pool.views || !(view = g_queue_pop_head(pool.views))) {
+        return NULL;
+    }
+
+    /* The client connects the page of the view from now on. */
+    g_signal_handlers_disconnect_by_func(view, on_view_destroy, NULL);
+
+    /* Hand over our reference as floating one so that the caller can treat
+     * the view like a new created widget. */
+    g_object_force_floating(G_OBJECT(view));
+    schedule_refill();
+
+    return view;
+}
+
+void webview_pool_cleanup(void)
+{
+    WebKitWebView *view;
+
+    if (pool.refill_id) {
+        g_source_remove(pool.refill_id);
+        pool.refill_id = 0;
+    }
+    if (!pool.views) {
+        return;
+    }
+    while ((view = g_queue_pop_head(pool.views))) {
+        gtk_widget_destroy(GTK_WIDGET(view));
+        g_object_unref(view);
+    }
+    g_queue_free(pool.views);
+    pool.views = NULL;
+}
+
+static void schedule_refill(void)
+{
+    if (!pool.refill_id && g_queue_get_length(pool.views) < pool.size) {
+        pool.refill_id = g_idle_add_full(G_PRIORITY_LOW, refill, NULL, NULL);
+    }
+}
+
+/**
+ * Idle callback that creates one webview per call to not block the main loop
+ * for too long.
+ */
+static gboolean refill(gpointer data)
+{
+    WebKitUserContentManager *ucm;
+    WebKitWebView *view;
+
+    if (g_queue_get_length(pool.views) >= pool.size) {
+        pool.refill_id = 0;
+        return G_SOURCE_REMOVE;
+    }
+
+    /* Attach the user scripts and styles like the default settings do. */
+    ucm = webkit_user_content_manager_new();
+    setting_user_content_init(ucm);
+
+    view = WEBKIT_WEB_VIEW(g_object_new(WEBKIT_TYPE_WEB_VIEW,
+                "user-content-manager", ucm,
+                "web-context", vb.webcontext, NULL));
+    g_object_unref(ucm);
+    g_signal_connect(view, "destroy", G_CALLBACK(on_view_destroy), NULL);
+
+    g_queue_push_tail(pool.views, g_object_ref_sink(view));
+
+    if (g_queue_get_length(pool.views) < pool.size) {
+        return G_SOURCE_CONTINUE;
+    }
+    pool.refill_id = 0;
+
+    return G_SOURCE_REMOVE;
+}
+
+/**
+ * Removes the web extension proxy of the page that was announced by the view
+ * that never got a client.
+ */
+static void on_view_destroy(GtkWidget *widget, gpointer data)
+{
+    ext_proxy_page_destroyed(webkit_web_view_get_page_id(WEBKIT_WEB_VIEW(widget)));
+}
@@ -0,0 +1,134 @@
+/**
+ * vimb - a webkit based vim like browser.
+ *
+ * Copyright (C) 2012-2018 Daniel Carl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+#include <gtk/gtk.h>
+#include <src/config.h>
+#include <src/download-tracker.h>
+
+/* one sample interval of the speed measurement in microseconds */
+#define STEP (DOWNLOAD_SPEED_INTERVAL * 1000)
+
+static void test_count(void)
+{
+    DownloadTracker t = {0};
+    DownloadStat a = {0}, b = {0};
+
+    download_tracker_add(&t, &a, 100, 0, 0);
+    download_tracker_add(&t, &b, -1, 0, 0);
+    g_assert_cmpuint(t.active, ==, 2);
+
+    download_tracker_remove(&a);
+    g_assert_cmpuint(t.active, ==, 1);
+    /* removing twice must not change the count */
+    download_tracker_remove(&a);
+    g_assert_cmpuint(t.active, ==, 1);
+
+    download_tracker_remove(&b);
+    g_assert_cmpuint(t.active, ==, 0);
+    g_assert_cmpint(t.remaining, ==, 0);
+    g_assert_cmpfloat(t.speed, ==, 0);
+}
+
+static void test_speed(void)
+{
+    DownloadTracker t = {0};
+    DownloadStat a = {0};
+    gdouble rate = (gdouble)G_USEC_PER_SEC / STEP;
+
+    download_tracker_add(&t, &a, 10000, 0, 0);
+
+    /* no speed before the first sample is complete */
+    download_tracker_update(&a, 100, STEP / 2);
+    g_assert_cmpfloat(a.speed, ==, 0);
+
+    /* the first sample is taken as is */
+    download_tracker_update(&a, 100, STEP);
+    g_assert_cmpfloat_with_epsilon(a.speed, 200 * rate, 0.001);
+
+    /* later samples are smoothed */
+    download_tracker_update(&a, 400, 2 * STEP);
+    g_assert_cmpfloat_with_epsilon(a.speed,
+            200 * rate + DOWNLOAD_SPEED_SMOOTHING * 200 * rate, 0.001);
+    g_assert_cmpfloat_with_epsilon(t.speed, a.speed, 0.001);
+    g_assert_cmpint(t.remaining, ==, 10000 - 600);
+
+    download_tracker_remove(&a);
+}
+
+static void test_eta(void)
+{
+    DownloadTracker t = {0};
+    DownloadStat a = {0}, b = {0}, c = {0};
+
+    download_tracker_add(&t, &a, 4 * G_USEC_PER_SEC, 0, 0);
+    download_tracker_add(&t, &b, 2 * G_USEC_PER_SEC, G_USEC_PER_SEC, 0);
+    download_tracker_add(&t, &c, -1, 0, 0);
+    g_assert_cmpuint(download_tracker_get_eta(&t), ==, 0);
+
+    /* a and b get 1 byte per microsecond together */
+    download_tracker_update(&a, STEP / 2, STEP);
+    download_tracker_update(&b, STEP / 2, STEP);
+    /* downloads of unknown size are not part of the ETA */
+    download_tracker_update(&c, STEP, STEP);
+
+    g_assert_cmpfloat_with_epsilon(t.sized_speed, G_USEC_PER_SEC, 0.001);
+    g_assert_cmpfloat_with_epsilon(t.speed, 2 * G_USEC_PER_SEC, 0.001);
+    g_assert_cmpint(t.remaining, ==, 5 * G_USEC_PER_SEC - STEP);
+    g_assert_cmpuint(download_tracker_get_eta(&t), ==,
+            (guint)((5.0 * G_USEC_PER_SEC - STEP) / G_USEC_PER_SEC));
+
+    /* the size becomes known later */
+    download_tracker_reset(&c, 2 * STEP, c.received, 2 * STEP);
+    g_assert_cmpint(t.remaining, ==, 5 * G_USEC_PER_SEC);
+    g_assert_cmpfloat_with_epsilon(t.speed, G_USEC_PER_SEC, 0.001);
+
+    download_tracker_remove(&a);
+    download_tracker_remove(&b);
+    download_tracker_remove(&c);
+}
+
+static void test_notify(void)
+{
+    DownloadTracker t = {0};
+    DownloadStat a = {0}, b = {0};
+
+    download_tracker_add(&t, &a, 1000, 0, 0);
+    download_tracker_add(&t, &b, 1000, 0, 0);
+
+    /* the rate limit is shared by all downloads of the tracker */
+    g_assert_true(download_tracker_update(&a, 1, 0));
+    g_assert_false(download_tracker_update(&b, 1, 1));
+    g_assert_false(download_tracker_update(&a, 1, G_USEC_PER_SEC - 1));
+    g_assert_true(download_tracker_update(&b, 1, G_USEC_PER_SEC));
+
+    download_tracker_remove(&a);
+    download_tracker_remove(&b);
+}
+
+int main(int argc, char *argv[])
+{
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/test-download-tracker/count", test_count);
+    g_test_add_func("/test-download-tracker/speed", test_speed);
+    g_test_add_func("/test-download-tracker/eta", test_eta);
+    g_test_add_func("/test-download-tracker/notify", test_notify);
+
+    return g_test_run();
+}
@@ -0,0 +1,176 @@
+/**
+ * vimb - a webkit based vim like browser.
+ *
+ * Copyright (C) 2012-2018 Daniel Carl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+/* The download engine is included to drive the segments without a client.
+ * The functions that need a window are replaced by the stubs below. */
+#include <src/download.c>
+
+#define SIZE (256 * 1024)
+
+static struct {
+    GMainLoop *loop;
+    char      *body;
+    int       requests;   /* number of requests received */
+    int       ranges;     /* number of requests with Range header */
+    int       result;     /* message type of the last vb_echo() or -1 */
+} test;
+
+void vb_echo(Client *c, MessageType type, gboolean hide, const char *error, ...)
+{
+    /* The download engine reports the end of a download this way. */
+    test.result = type;
+    g_main_loop_quit(test.loop);
+}
+
+void vb_statusbar_invalidate(Client *c, guint fields)
+{
+}
+
+#ifdef FEATURE_AUTOCMD
+gboolean autocmd_run(Client *c, AuEvent event, const char *uri, const char *group)
+{
+    return TRUE;
+}
+#endif
+
+/**
+ * Serves the body without support for ranges. The first response is cut
+ * off in the middle to force a retry of the download.
+ */
+static gboolean on_server_run(GThreadedSocketService *service,
+        GSocketConnection *connection, GObject *source, gpointer data)
+{
+    GDataInputStream *in;
+    GOutputStream *out;
+    char *line, *header;
+    gsize len;
+    int request;
+
+    in = g_data_input_stream_new(g_io_stream_get_input_stream(G_IO_STREAM(connection)));
+    while ((line = g_data_input_stream_read_line(in, &len, NULL, NULL))) {
+        g_strchomp(line);
+        if (!*line) {
+            g_free(line);
+            break;
+        }
+        if (!g_ascii_strncasecmp(line, "Range:", 6)) {
+            g_atomic_int_inc(&test.ranges);
+        }
+        g_free(line);
+    }
+    g_object_unref(in);
+
+    request = g_atomic_int_add(&test.requests, 1);
+    out     = g_io_stream_get_output_stream(G_IO_STREAM(connection));
+    header  = g_strdup_printf("HTTP/1.1 200 OK\r\n"
+            "Content-Length: %d\r\n"
+            "Connection: close\r\n\r\n", SIZE);
+    g_output_stream_write_all(out, header, strlen(header), NULL, NULL, NULL);
+    g_output_stream_write_all(out, test.body, request ? SIZE : SIZE / 2, NULL, NULL, NULL);
+    g_io_stream_close(G_IO_STREAM(connection), NULL, NULL);
+    g_free(header);
+
+    return TRUE;
+}
+
+static gboolean on_timeout(gpointer data)
+{
+    g_main_loop_quit(test.loop);
+
+    return G_SOURCE_REMOVE;
+}
+
+static void test_retry_without_ranges(void)
+{
+    GSocketService *service;
+    DownloadTracker tracker = {0};
+    Download *dl;
+    char *dir, *path, *content = NULL;
+    gsize len = 0;
+    guint16 port;
+    int i;
+
+    test.loop     = g_main_loop_new(NULL, FALSE);
+    test.body     = g_malloc(SIZE);
+    test.requests = 0;
+    test.ranges   = 0;
+    test.result   = -1;
+    for (i = 0; i < SIZE; i++) {
+        test.body[i] = 'a' + i % 26;
+    }
+
+    service = g_threaded_socket_service_new(1);
+    port    = g_socket_listener_add_any_inet_port(G_SOCKET_LISTENER(service), NULL, NULL);
+    g_assert_cmpuint(port, >, 0);
+    g_signal_connect(service, "run", G_CALLBACK(on_server_run), NULL);
+    g_socket_service_start(service);
+
+    dir = g_dir_make_tmp("vimb-test-XXXXXX", NULL);
+    g_assert_nonnull(dir);
+    path = g_build_filename(dir, "file", NULL);
+
+    dl           = g_slice_new0(Download);
+    dl->uri      = g_strdup_printf("http://127.0.0.1:%u/file", port);
+    dl->path     = g_strdup(path);
+    dl->part     = g_strconcat(dl->path, ".part", NULL);
+    dl->resume   = g_strconcat(dl->path, ".resume", NULL);
+    dl->size     = SIZE;
+    dl->ranges   = FALSE;
+    dl->segments = g_ptr_array_new();
+    dl->fd       = g_open(dl->part, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    g_assert_cmpint(dl->fd, !=, -1);
+
+    engine.downloads = g_list_append(engine.downloads, dl);
+    download_tracker_add(&tracker, &dl->stat, dl->size, 0, g_get_monotonic_time());
+    create_segments(dl, 1);
+    segment_request(g_ptr_array_index(dl->segments, 0));
+
+    g_timeout_add_seconds(20, on_timeout, NULL);
+    g_main_loop_run(test.loop);
+
+    /* The retry must fetch the whole file again and write it from the
+     * start instead of appending it to the data of the first try. */
+    g_assert_cmpint(test.result, ==, MSG_NORMAL);
+    g_assert_cmpint(test.requests, ==, 2);
+    g_assert_cmpint(test.ranges, ==, 0);
+    g_assert_true(g_file_get_contents(path, &content, &len, NULL));
+    g_assert_cmpuint(len, ==, SIZE);
+    g_assert_true(memcmp(content, test.body, SIZE) == 0);
+
+    download_cleanup();
+    g_socket_service_stop(service);
+    g_object_unref(service);
+    g_main_loop_unref(test.loop);
+
+    g_unlink(path);
+    g_rmdir(dir);
+    g_free(content);
+    g_free(test.body);
+    g_free(path);
+    g_free(dir);
+}
+
+int main(int argc, char *argv[])
+{
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/test-download/retry-without-ranges", test_retry_without_ranges);
+
+    return g_test_run();
+}
@@ -0,0 +1,119 @@
+/**
+ * vimb - a webkit based vim like browser.
+ *
+ * Copyright (C) 2012-2018 Daniel Carl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+#include <gtk/gtk.h>
+#include <src/site.h>
+
+static guint get_value(const GArray *profile, guint key)
+{
+    guint i;
+
+    for (i = 0; profile && i < profile->len; i++) {
+        if (g_array_index(profile, SiteRule, i).key == key) {
+            return GPOINTER_TO_UINT(g_array_index(profile, SiteRule, i).value);
+        }
+    }
+    return 0;
+}
+
+static void test_lookup(void)
+{
+    SiteTrie *t = site_trie_new(NULL);
+
+    g_assert_true(site_trie_add(t, "example.com", 1, GUINT_TO_POINTER(10)));
+    g_assert_true(site_trie_add(t, "*.other.org", 1, GUINT_TO_POINTER(20)));
+
+    g_assert_cmpuint(get_value(site_trie_lookup(t, "example.com"), 1), ==, 10);
+    g_assert_cmpuint(get_value(site_trie_lookup(t, "www.example.com"), 1), ==, 10);
+    g_assert_cmpuint(get_value(site_trie_lookup(t, "WWW.Example.COM."), 1), ==, 10);
+    g_assert_cmpuint(get_value(site_trie_lookup(t, "other.org"), 1), ==, 20);
+
+    /* only whole labels match */
+    g_assert_null(site_trie_lookup(t, "badexample.com"));
+    g_assert_null(site_trie_lookup(t, "com"));
+    g_assert_null(site_trie_lookup(t, "example.net"));
+    g_assert_null(site_trie_lookup(t, ""));
+    g_assert_null(site_trie_lookup(t, NULL));
+
+    /* invalid patterns */
+    g_assert_false(site_trie_add(t, "", 1, NULL));
+    g_assert_false(site_trie_add(t, "*.", 1, NULL));
+    g_assert_false(site_trie_add(t, "a..b", 1, NULL));
+
+    site_trie_free(t);
+}
+
+static void test_override(void)
+{
+    SiteTrie *t = site_trie_new(NULL);
+    const GArray *profile;
+
+    site_trie_add(t, "example.com", 1, GUINT_TO_POINTER(10));
+    site_trie_add(t, "example.com", 2, GUINT_TO_POINTER(20));
+    site_trie_add(t, "www.example.com", 2, GUINT_TO_POINTER(30));
+    site_trie_add(t, "www.example.com", 0, GUINT_TO_POINTER(40));
+
+    /* the longer pattern wins and the rules are sorted by key */
+    profile = site_trie_lookup(t, "a.www.example.com");
+    g_assert_cmpuint(profile->len, ==, 3);
+    g_assert_cmpuint(g_array_index(profile, SiteRule, 0).key, ==, 0);
+    g_assert_cmpuint(g_array_index(profile, SiteRule, 1).key, ==, 1);
+    g_assert_cmpuint(g_array_index(profile, SiteRule, 2).key, ==, 2);
+    g_assert_cmpuint(get_value(profile, 2), ==, 30);
+
+    profile = site_trie_lookup(t, "example.com");
+    g_assert_cmpuint(profile->len, ==, 2);
+    g_assert_cmpuint(get_value(profile, 2), ==, 20);
+
+    /* a rule of the same key replaces the former value */
+    site_trie_add(t, "example.com", 1, GUINT_TO_POINTER(11));
+    g_assert_cmpuint(get_value(site_trie_lookup(t, "www.example.com"), 1), ==, 11);
+
+    site_trie_free(t);
+}
+
+static void test_generation(void)
+{
+    SiteTrie *t = site_trie_new(g_free);
+    guint generation;
+
+    site_trie_add(t, "example.com", 1, g_strdup("a"));
+    generation = site_trie_get_generation(t);
+
+    /* hosts with the same rules share the profile */
+    g_assert_true(site_trie_lookup(t, "a.example.com") == site_trie_lookup(t, "b.example.com"));
+    g_assert_cmpuint(site_trie_get_generation(t), ==, generation);
+
+    site_trie_add(t, "example.com", 1, g_strdup("b"));
+    g_assert_cmpuint(site_trie_get_generation(t), !=, generation);
+    g_assert_cmpstr(g_array_index(site_trie_lookup(t, "example.com"), SiteRule, 0).value, ==, "b");
+
+    site_trie_free(t);
+}
+
+int main(int argc, char *argv[])
+{
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/test-site/lookup", test_lookup);
+    g_test_add_func("/test-site/override", test_override);
+    g_test_add_func("/test-site/generation", test_generation);
+
+    return g_test_run();
+}